@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
@@ -8,6 +9,32 @@
 #include "SDLstuff.h"
 #include "game.h"
 #include "otherstuff.h"
+#include "assetpack.h"
+#include "sdffont.h"
+#include "settings.h"
+#include "calibration.h"
+#include "pacing.h"
+#include "simd.h"
+#include "softrender.h"
+#include "renderqueue.h"
+#include "stretch.h"
+#include "audio.h"
+#include "notes.h"
+#include "scoring.h"
+#include "workpool.h"
+#include "difficulty.h"
+#include "telemetry.h"
+#include "replayformat.h"
+#include "replay.h"
+#include "hud.h"
+#include "debug.h"
+#include "lyrics.h"
+#include "practice.h"
+#include "players.h"
+#include "scorejournal.h"
+#include "hotreload.h"
+#include "particles.h"
+#include "capture.h"
 
 enum screenType
 {
@@ -39,46 +66,63 @@ const SDL_Color textColor = {255, 255, 255}; // white
 SDL_Rect noteClips[5];
 SDL_Rect holdNoteClips[5];
 SDL_Rect pressedButtonsClips[5];
-TTF_Font* RalewayLightFont;
 
 Mix_Music *levelOneSong;
 Mix_Music *levelTwoSong;
 Mix_Music *levelThreeSong;
 
+// one per level in levelPick order, rated once at startup
+chartRating levelRatings[3];
+
 void loadMedia(SDL_Renderer* &renderer);
 
+void previewSong(const int &levelPick, Uint32 &startMusicLoopTime);
+
 void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer);
 
 void pause(bool &isQuit, bool &isLevelEnd, bool &isPause, SDL_Renderer* &renderer, Uint32 &pausedTime);
 
-void loadChart(gameNote (&levelChart)[2000], Uint32 &musicStart, char* file, int &noteCount, Uint32 &noMultiplierScore, int &speed);
-
-void loadLyrics(gameLyrics (&levelLyrics)[150], char* file);
+void calibrate(bool &isQuit, SDL_Renderer* &renderer);
 
-void notePressHandle(const int &lane, gameNote (&onScreenNotes)[200], Uint32 &score, int &numberOfOnScreenNotes,
-                     const int &keyRepeat, const int &keyState, const Uint32 &passedTime, int &streak, const int &multiplier, int &accuracy);
+void loadChart(gameNote (&levelChart)[2000], Uint32 &musicStart, char* file, int &noteCount, Uint32 &noMultiplierScore, int &speed,
+               Uint64 &chartHash);
 
-void getHighScore(int (&highStar)[10], int (&highAccuracy)[10], Uint32 (&highScore)[10], char* file);
-
-void setHighScore(int &highStar, int &highAccuracy, Uint32 &highScore, char* file);
+void loadLyrics(gameLyrics (&levelLyrics)[150], char* file, int &lyricCount);
 
 int main(int argc, char* argv[])
 {
     SDL_Window* window;
     SDL_Renderer* renderer;
-    initSDL(window, renderer);
+    startAllocationCounter();
+    loadSettings(settings, "assets/Settings.txt");
+    initSDL(window, renderer, settings.audioFrequency, settings.audioBufferSize, settings.presentMode,
+            settings.softwareRender);
 
+    // one mapped file instead of loose assets when tools/packassets has been run
+    openAssetPack(gamePack, "assets.pack");
     loadMedia(renderer);
+    if (settings.hitSounds) loadHitSounds(hitSounds);
+    // charts that have not changed since the last launch are not analysed again
+    const char* chartPaths[3] = {"assets/LevelOne/Chart.txt", "assets/LevelTwo/Chart.txt", "assets/LevelThree/Chart.txt"};
+    rateCatalog(chartPaths, 3, levelRatings, "ratings.cache");
+    // every play ever finished, the old top ten tables come in once
+    openScoreJournal(levelScores, "scores.db", "scores.journal");
+    const char* highscorePaths[3] = {"assets/LevelOne/Highscore.txt", "assets/LevelTwo/Highscore.txt",
+                                     "assets/LevelThree/Highscore.txt"};
+    for (int i = 0; i < 3; i++) importHighScores(levelScores, chartPaths[i], highscorePaths[i]);
 
     bool isQuit = false;
     SDL_Event e;
     bool isChoosingScreen = false;
     int levelPick = levelChoose1;
     Uint32 startMusicLoopTime = 0;
+    bool isDirty = true;
 
     while (!isQuit)
     {
-        while (SDL_PollEvent(&e) != 0)
+        // the menu only changes on input, sleep until some arrives or the song preview needs a look
+        bool isEvent = SDL_WaitEventTimeout(&e, idleWaitTime) != 0;
+        while (isEvent)
         {
             //User requests quit
             if( e.type == SDL_QUIT )
@@ -87,8 +131,10 @@ int main(int argc, char* argv[])
             }
             else
             {
+                if (e.type == SDL_WINDOWEVENT) isDirty = true;
                 if( e.type == SDL_KEYDOWN )
                 {
+                    isDirty = true;
                     switch( e.key.keysym.sym )
                     {
                         case SDLK_ESCAPE:
@@ -134,10 +180,49 @@ int main(int argc, char* argv[])
                                 if (levelPick > levelChoose3) levelPick = levelChoose1;
                             }
                             break;
+                        case SDLK_c:
+                            if (isChoosingScreen)
+                            {
+                                Mix_HaltMusic();
+                                calibrate(isQuit, renderer);
+                            }
+                            break;
+                        case SDLK_MINUS:
+                        case SDLK_EQUALS:
+                            // practice speed in steps of 10%, kept for next time
+                            if (isChoosingScreen)
+                            {
+                                settings.playbackRate += e.key.keysym.sym == SDLK_MINUS ? -10 : 10;
+                                if (settings.playbackRate < minPlaybackRate) settings.playbackRate = minPlaybackRate;
+                                if (settings.playbackRate > maxPlaybackRate) settings.playbackRate = maxPlaybackRate;
+                                saveSettings(settings, "assets/Settings.txt");
+                            }
+                            break;
+                        case SDLK_p:
+                            // players on the one keyboard, round from 1 to maxPlayers
+                            if (isChoosingScreen)
+                            {
+                                settings.players = settings.players % maxPlayers + 1;
+                                saveSettings(settings, "assets/Settings.txt");
+                            }
+                            break;
+                        case SDLK_F3:
+                            isResourceOverlayShown = !isResourceOverlayShown;
+                            break;
+                        case SDLK_F4:
+                            dumpResources("resources.txt");
+                            break;
                     }
                 }
             }
+            isEvent = SDL_PollEvent(&e) != 0;
         }
+
+        if (isChoosingScreen) previewSong(levelPick, startMusicLoopTime);
+        if (!isDirty || isQuit) continue;
+        isDirty = false;
+        countResourceFrame();
+
         SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( renderer );
 
@@ -154,7 +239,6 @@ int main(int argc, char* argv[])
             std::string releaseYear;
             std::string songLength;
             bool isLyricsAvailble;
-            char* highscoreFilePath;
             backgroundTexture.render(renderer);
             bigBlackRectangleTexture.render(renderer);
             switch (levelPick)
@@ -166,17 +250,7 @@ int main(int argc, char* argv[])
                     releaseYear = "2020";
                     songLength  = "03:53";
                     isLyricsAvailble = true;
-                    highscoreFilePath = "assets/LevelOne/Highscore.txt";
                     levelOneAlbum.render(renderer);
-                    if (Mix_PlayingMusic() == 0)
-                    {
-                        startMusicLoopTime = SDL_GetTicks();
-                        Mix_FadeInMusicPos(levelOneSong, 1, 1000, 74.7);
-                    }
-                    if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (103 - 74.7) * 1000))
-                    {
-                        Mix_FadeOutMusic(1000);
-                    }
                     break;
                 case levelChoose2:
                     songTitle = "Me, Myself and Hyde";
@@ -186,16 +260,6 @@ int main(int argc, char* argv[])
                     songLength  = "04:04";
                     isLyricsAvailble = false;
                     levelTwoAlbum.render(renderer);
-                    highscoreFilePath = "assets/LevelTwo/Highscore.txt";
-                    if (Mix_PlayingMusic() == 0)
-                    {
-                        startMusicLoopTime = SDL_GetTicks();
-                        Mix_FadeInMusicPos(levelTwoSong, 1, 1000, 82);
-                    }
-                    if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (105.5 - 82) * 1000))
-                    {
-                        Mix_FadeOutMusic(1000);
-                    }
                     break;
                 case levelChoose3:
                     songTitle = "Gone With The Wind";
@@ -205,41 +269,53 @@ int main(int argc, char* argv[])
                     songLength  = "03:49";
                     isLyricsAvailble = true;
                     levelThreeAlbum.render(renderer);
-                    highscoreFilePath = "assets/LevelThree/Highscore.txt";
-                    if (Mix_PlayingMusic() == 0)
-                    {
-                        startMusicLoopTime = SDL_GetTicks();
-                        Mix_FadeInMusicPos(levelThreeSong, 1, 1000, 71);
-                    }
-                    if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (90 - 71) * 1000))
-                    {
-                        Mix_FadeOutMusic(1000);
-                    }
                     break;
             }
-            changeFontSize(RalewayLightFont, 40, "assets/Raleway-Light.ttf");
-            renderText("Highscores", textColor, RalewayLightFont, renderer, textTexture, 300, 50);
-            changeFontSize(RalewayLightFont, 28, "assets/Raleway-Light.ttf");
-            renderText(songTitle, textColor, RalewayLightFont, renderer, textTexture, 775, 362);
-            changeFontSize(RalewayLightFont, 20, "assets/Raleway-Light.ttf");
-            renderText(artist, textColor, RalewayLightFont, renderer, textTexture, 785, 420);
-            renderText(genre, textColor, RalewayLightFont, renderer, textTexture, 785, 480);
-            renderText(releaseYear, textColor, RalewayLightFont, renderer, textTexture, 785, 540);
-            renderText(songLength, textColor, RalewayLightFont, renderer, textTexture, 935, 420);
-            if (isLyricsAvailble) renderText("Lyrics: Yes", textColor, RalewayLightFont, renderer, textTexture, 935, 480);
-            else renderText("Lyrics: No", textColor, RalewayLightFont, renderer, textTexture, 935, 480);
-
-            int highStar[10];
-            int highAccuracy[10];
-            Uint32 highScore[10];
-            getHighScore(highStar, highAccuracy, highScore, highscoreFilePath);
-            for (int i = 0; i < 10; i++)
+            renderSdfText("Highscores", textColor, ralewayLight, 40, renderer, textTexture, 300, 50);
+            renderSdfText(songTitle, textColor, ralewayLight, 28, renderer, textTexture, 775, 362);
+            renderSdfText(artist, textColor, ralewayLight, 20, renderer, textTexture, 785, 420);
+            renderSdfText(genre, textColor, ralewayLight, 20, renderer, textTexture, 785, 480);
+            renderSdfText(releaseYear, textColor, ralewayLight, 20, renderer, textTexture, 785, 540);
+            renderSdfText(songLength, textColor, ralewayLight, 20, renderer, textTexture, 935, 420);
+            if (isLyricsAvailble) renderSdfText("Lyrics: Yes", textColor, ralewayLight, 20, renderer, textTexture, 935, 480);
+            else renderSdfText("Lyrics: No", textColor, ralewayLight, 20, renderer, textTexture, 935, 480);
+            const chartRating &rating = levelRatings[levelPick];
+            renderSdfText(rating.ratingText, textColor, ralewayLight, 20, renderer, textTexture, 935, 540);
+            if (rating.isRated)
             {
-                renderText(numberToString(i+1) + ".", textColor, RalewayLightFont, renderer, textTexture, 70, 120 + i * 47);
-                renderText(numberToString(highStar[i]) + " Stars", textColor, RalewayLightFont, renderer, textTexture, 100, 120 + i * 47);
-                renderText(numberToString(highAccuracy[i]) + '%', textColor, RalewayLightFont, renderer, textTexture, 200, 120 + i * 47);
-                renderText(numberToString(highScore[i]), textColor, RalewayLightFont, renderer, textTexture, 300, 120 + i * 47);
+                renderSdfText(rating.densityText, textColor, ralewayLight, 16, renderer, textTexture, 785, 578);
+                renderSdfText(rating.patternText, textColor, ralewayLight, 16, renderer, textTexture, 785, 600);
             }
+
+            // straight from the journal's index, empty places show zeros like the old tables
+            const journalRecord* highScores[maxHighScores];
+            int highScoreCount = topScores(levelScores, songKey(chartPaths[levelPick]), highScores, maxHighScores);
+            for (int i = 0; i < maxHighScores; i++)
+            {
+                int highStar = 0;
+                int highAccuracy = 0;
+                Uint32 highScore = 0;
+                if (i < highScoreCount)
+                {
+                    highStar = highScores[i]->star;
+                    highAccuracy = highScores[i]->noteCount > 0 ? highScores[i]->hits * 100 / highScores[i]->noteCount : 0;
+                    highScore = highScores[i]->score;
+                }
+                renderSdfText(numberToString(i+1) + ".", textColor, ralewayLight, 20, renderer, textTexture, 70, 120 + i * 47);
+                renderSdfText(numberToString(highStar) + " Stars", textColor, ralewayLight, 20, renderer, textTexture, 100, 120 + i * 47);
+                renderSdfText(numberToString(highAccuracy) + '%', textColor, ralewayLight, 20, renderer, textTexture, 200, 120 + i * 47);
+                renderSdfText(numberToString(highScore), textColor, ralewayLight, 20, renderer, textTexture, 300, 120 + i * 47);
+            }
+            renderSdfText("C: calibrate latency", textColor, ralewayLight, 20, renderer, textTexture, 70, 590);
+            renderSdfText("-/=: speed " + numberToString(settings.playbackRate) + '%', textColor, ralewayLight, 20, renderer, textTexture, 300, 590);
+            renderSdfText("P: " + numberToString(settings.players) + (settings.players == 1 ? " player" : " players"),
+                          textColor, ralewayLight, 20, renderer, textTexture, 500, 590);
+        }
+        if (isResourceOverlayShown)
+        {
+            char totals[160];
+            formatResourceTotals(totals, sizeof(totals));
+            renderSdfText(totals, textColor, ralewayLight, 16, renderer, textTexture, 8, 4);
         }
         //Update screen
         SDL_RenderPresent(renderer);
@@ -251,47 +327,42 @@ int main(int argc, char* argv[])
     levelOneAlbum.free();
     levelTwoAlbum.free();
     levelThreeAlbum.free();
-    Mix_FreeMusic(levelOneSong);
-    Mix_FreeMusic(levelTwoSong);
-    Mix_FreeMusic(levelThreeSong);
+    freeMusic(levelOneSong);
+    freeMusic(levelTwoSong);
+    freeMusic(levelThreeSong);
     gameNoteTexture.free();
     holdNotesTexture.free();
     pressedButtonsTexture.free();
     textTexture.free();
-    TTF_CloseFont(RalewayLightFont);
+    freeHitSounds(hitSounds);
+    freeSdfFont(ralewayLight);
+    closeAssetPack(gamePack);
+    closeScoreJournal(levelScores);
     quitSDL(window, renderer);
     return 0;
 }
 
 void loadMedia(SDL_Renderer* &renderer)
 {
-    RalewayLightFont = TTF_OpenFont("assets/Raleway-Light.ttf", 28);
-    if (RalewayLightFont == NULL)
-    {
-        logSDLError(std::cout, "Failed to load Raleway-Light.ttf!", true, TTF_Err);
-    }
-    else
+    // every text size is drawn from one distance field atlas, built on the first launch
+    if (!loadSdfFont(ralewayLight, "assets/Raleway-Light.ttf", "assets/Raleway-Light.sdf"))
     {
-        textTexture.loadFromRenderedText(" ", textColor, RalewayLightFont, renderer);
-        if (textTexture.texture == NULL)
-        {
-            logSDLError(std::cout, "Failed to load textTexture!", true, none);
-        }
+        logSDLError(std::cout, "Failed to load Raleway-Light.ttf!", true, none);
     }
 
-    scoreAndStarTexture.loadTexture("assets/scoreAndStar.png", renderer, true);
+    loadAssetTexture(scoreAndStarTexture, "assets/scoreAndStar.png", renderer, true);
     if (scoreAndStarTexture.texture == NULL)
     {
         logSDLError(std::cout, "Failed to load scoreAndStar.png!", false, SDL_Err);
     }
 
-    comingSoonTexture.loadTexture("assets/comingSoon.png", renderer, false);
+    loadAssetTexture(comingSoonTexture, "assets/comingSoon.png", renderer, false);
     if (comingSoonTexture.texture == NULL)
     {
         logSDLError(std::cout, "Failed to load comingSoon.png!", false, SDL_Err);
     }
 
-    bigBlackRectangleTexture.loadTexture("assets/bigBlackRectangle.png", renderer, true);
+    loadAssetTexture(bigBlackRectangleTexture, "assets/bigBlackRectangle.png", renderer, true);
     if (bigBlackRectangleTexture.texture == NULL)
     {
         logSDLError(std::cout, "Failed to load bigBlackRectangle.png!", false, SDL_Err);
@@ -302,7 +373,7 @@ void loadMedia(SDL_Renderer* &renderer)
         SDL_SetTextureAlphaMod(bigBlackRectangleTexture.texture, 100);
     }
 
-    bigBlackRectangle2Texture.loadTexture("assets/bigBlackRectangle2.png", renderer, true);
+    loadAssetTexture(bigBlackRectangle2Texture, "assets/bigBlackRectangle2.png", renderer, true);
     if (bigBlackRectangle2Texture.texture == NULL)
     {
         logSDLError(std::cout, "Failed to load bigBlackRectangle2.png!", false, SDL_Err);
@@ -313,79 +384,79 @@ void loadMedia(SDL_Renderer* &renderer)
         SDL_SetTextureAlphaMod(bigBlackRectangle2Texture.texture, 100);
     }
 
-    backgroundTexture.loadTexture("assets/background.png", renderer, false);
+    loadAssetTexture(backgroundTexture, "assets/background.png", renderer, false);
     if (backgroundTexture.texture == NULL)
     {
         logSDLError(std::cout, "Failed to load background.png!", false, SDL_Err);
     }
 
-    playScreenTexture.loadTexture("assets/playScreen.png", renderer, false);
+    loadAssetTexture(playScreenTexture, "assets/playScreen.png", renderer, false);
     if( playScreenTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load playScreen.png!", false, SDL_Err);
     }
 
-    pauseTexture.loadTexture("assets/pause.png", renderer, false);
+    loadAssetTexture(pauseTexture, "assets/pause.png", renderer, false);
     if( pauseTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load pause.png!", false, SDL_Err);
     }
 
-    guitarTexture.loadTexture("assets/guitar.png", renderer, true);
+    loadAssetTexture(guitarTexture, "assets/guitar.png", renderer, true);
     if( guitarTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load guitar.png!", false, SDL_Err);
     }
 
-    levelOneAlbum.loadTexture("assets/LevelOne/album.png", renderer, false);
+    loadAssetTexture(levelOneAlbum, "assets/LevelOne/album.png", renderer, false);
     if( levelOneAlbum.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelOne/album.png!", false, SDL_Err);
     }
 
-    levelOneSong = Mix_LoadMUS("assets/LevelOne/song.mp3");
+    levelOneSong = loadMusic("assets/LevelOne/song.mp3");
     if( levelOneSong == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelOne/song.mp3!", false, MIX_Err);
     }
 
-    levelTwoAlbum.loadTexture("assets/LevelTwo/album.png", renderer, false);
+    loadAssetTexture(levelTwoAlbum, "assets/LevelTwo/album.png", renderer, false);
     if( levelTwoAlbum.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelTwo/album.png!", false, SDL_Err);
     }
 
-    levelTwoSong = Mix_LoadMUS("assets/LevelTwo/song.mp3");
+    levelTwoSong = loadMusic("assets/LevelTwo/song.mp3");
     if( levelTwoSong == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelTwo/song.mp3!", false, MIX_Err);
     }
 
-    levelThreeAlbum.loadTexture("assets/LevelThree/album.png", renderer, false);
+    loadAssetTexture(levelThreeAlbum, "assets/LevelThree/album.png", renderer, false);
     if( levelThreeAlbum.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelThree/album.png!", false, SDL_Err);
     }
 
-    levelThreeSong = Mix_LoadMUS("assets/LevelThree/song.mp3");
+    levelThreeSong = loadMusic("assets/LevelThree/song.mp3");
     if( levelThreeSong == NULL )
     {
         logSDLError(std::cout, "Failed to load LevelThree/song.mp3!", false, MIX_Err);
     }
 
-    gameNoteTexture.loadTexture("assets/note.png", renderer, true);
+    loadAssetTexture(gameNoteTexture, "assets/note.png", renderer, true);
     if( gameNoteTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load note.png!", false, SDL_Err);
     }
 
-    holdNotesTexture.loadTexture("assets/holdNotes.png", renderer, true);
+    loadAssetTexture(holdNotesTexture, "assets/holdNotes.png", renderer, true);
     if( holdNotesTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load holdNotes.png!", false, SDL_Err);
     }
 
-    pressedButtonsTexture.loadTexture("assets/pressedButton.png", renderer, true);
+    loadAssetTexture(pressedButtonsTexture, "assets/pressedButton.png", renderer, true);
     if( pressedButtonsTexture.texture == NULL )
     {
         logSDLError(std::cout, "Failed to load pressedButton.png!", false, SDL_Err);
@@ -467,6 +538,50 @@ void loadMedia(SDL_Renderer* &renderer)
     pressedButtonsClips[orange].h = 53;
 }
 
+// loop the chorus of the picked song on the level select screen
+void previewSong(const int &levelPick, Uint32 &startMusicLoopTime)
+{
+    switch (levelPick)
+    {
+        case levelChoose1:
+            if (Mix_PlayingMusic() == 0)
+            {
+                startMusicLoopTime = SDL_GetTicks();
+                Mix_FadeInMusicPos(levelOneSong, 1, 1000, 74.7);
+                touchMusic(levelOneSong);
+            }
+            if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (103 - 74.7) * 1000))
+            {
+                Mix_FadeOutMusic(1000);
+            }
+            break;
+        case levelChoose2:
+            if (Mix_PlayingMusic() == 0)
+            {
+                startMusicLoopTime = SDL_GetTicks();
+                Mix_FadeInMusicPos(levelTwoSong, 1, 1000, 82);
+                touchMusic(levelTwoSong);
+            }
+            if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (105.5 - 82) * 1000))
+            {
+                Mix_FadeOutMusic(1000);
+            }
+            break;
+        case levelChoose3:
+            if (Mix_PlayingMusic() == 0)
+            {
+                startMusicLoopTime = SDL_GetTicks();
+                Mix_FadeInMusicPos(levelThreeSong, 1, 1000, 71);
+                touchMusic(levelThreeSong);
+            }
+            if (SDL_TICKS_PASSED(SDL_GetTicks() - startMusicLoopTime, (90 - 71) * 1000))
+            {
+                Mix_FadeOutMusic(1000);
+            }
+            break;
+    }
+}
+
 void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
 {
     if (level == levelChoose2)
@@ -479,168 +594,224 @@ void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
         SDL_Delay(5000);
         return;
     }
-    changeFontSize(RalewayLightFont, 28, "assets/Raleway-Light.ttf");
     bool isPause = false;
     bool isLevelEnd = false;
     bool isPlayingMusic = false;
     bool isSongEnd = false;
-    bool isButtonPressed[5];
     SDL_Event e;
     Uint32 beginningTime = SDL_GetTicks();
+    Uint64 beginningCounter = SDL_GetPerformanceCounter();
+    double counterToMs = 1000.0 / SDL_GetPerformanceFrequency();
     Uint32 passedTime = 0;
     Uint32 pausedTime = 0;
     Uint32 musicStart = 0;
     gameNote levelChart[2000];
     gameLyrics levelLyrics[150];
-    gameNote onScreenNotes[200];
-    int currentNote = 0;
-    int numberOfOnScreenNotes = 0;
     int currentLyric = 0;
-    int streak = 0;
     int noteCount = 0;
-    int accuracy = 0;
-    int highestStreak = 0;
     Uint32 noMultiplierScore = 0;
-    int multiplier = 1;
-    int notePressedCount = 0;
-    int star = 0;
     int speed = 0;
 
-    Uint32 score = 0;
-    for (int i = 0; i < 5; i++)
-    {
-        isButtonPressed[i] = false;
-    }
+    // every player reads the one chart, each with their own cursor, notes and score
+    int playerCount = settings.players;
+    for (int p = 0; p < playerCount; p++) resetPlayer(levelPlayers[p], p, playerCount);
+    playerState &soloPlayer = levelPlayers[0];
 
     char* chartPath;
     char* lyricsPath;
+    char* songPath;
+    Mix_Music* levelSong = NULL;
     switch (level)
     {
         case levelChoose1:
             chartPath = "assets/LevelOne/Chart.txt";
             lyricsPath = "assets/LevelOne/Lyrics.txt";
+            songPath = "assets/LevelOne/song.mp3";
+            levelSong = levelOneSong;
             break;
         case levelChoose3:
             chartPath = "assets/LevelThree/Chart.txt";
             lyricsPath = "assets/LevelThree/Lyrics.txt";
+            songPath = "assets/LevelThree/song.mp3";
+            levelSong = levelThreeSong;
             break;
     }
-    loadChart(levelChart, musicStart, chartPath, noteCount, noMultiplierScore, speed);
-    loadLyrics(levelLyrics, lyricsPath);
+    Uint64 chartHash = 0;
+    loadChart(levelChart, musicStart, chartPath, noteCount, noMultiplierScore, speed, chartHash);
+    // players only read the chart, a hot reload replaces it between frames
+    const gameNote* chart = levelChart;
+    int lyricCount = 0;
+    loadLyrics(levelLyrics, lyricsPath, lyricCount);
+    // upcoming lines are rasterized off the render thread, same font and size as the HUD
+    lyricPipeline lyricLines;
+    startLyricPipeline(lyricLines, levelLyrics, lyricCount, ralewayLight, 28, textColor);
+    // authoring mode, saved edits to the chart and lyrics are played from where the song is
+    if (settings.hotReload) startHotReload(levelReload, chartPath, lyricsPath, speed, chartHash);
 
     Mix_HaltMusic();
+    // slowed practice needs the decoded song to stretch, everything else runs on the scaled clock
+    int playbackRate = settings.playbackRate;
+    // decode the song during the pre-roll, it is scheduled as soon as it is ready
+    bool isPcmPlayback = settings.pcmPlayback || playbackRate < 100;
+    bool isPcmScheduled = false;
+
+    // [ marks the loop start, ] the loop end, backspace restarts the section, \ stops looping
+    practiceLoop practice;
+    practice.isUsed = playbackRate < 100;
+    bool isSeekRequested = false;
+    if (isPcmPlayback)
+    {
+        startPcmDecode(gameplaySong, songPath);
+        if (!setPcmRate(gameplaySong, playbackRate)) playbackRate = 100;
+    }
+
+    // with vsync presenting paces the loop, capped mode (or vsync that could not be had) uses the limiter
+    frameLimiter limiter;
+    frameStats stats;
+    frameProfile profile;
+    allocationStats allocations;
+    // effects move in real time, also when the song is slowed
+    Uint64 lastEffectCounter = SDL_GetPerformanceCounter();
+    clearParticles(hitParticles);
+    clearTelemetry(levelTiming);
+    // everything the scoring code is fed from here on goes into the replay
+    startReplay(levelReplay, settings.visualOffset > 0);
+    // HUD text is only rendered again when its value or lyric changes
+    cachedText scoreText(642, 435);
+    cachedText streakText(715, 492);
+    cachedText multiplierText(480, 330, "x ");
+    cachedText starText(907, 441);
+    cachedText resourceText(8, 4);
+    if (settings.presentMode == presentCapped || (settings.presentMode == presentVsync && !isVsyncOn(renderer)))
+    {
+        startFrameLimiter(limiter, settings.frameCap);
+    }
+    // four highways are drawn on a scaled field
+    float fieldScale;
+    int fieldX;
+    int fieldY;
+    playfieldScale(playerCount, fieldScale, fieldX, fieldY);
+    setRenderQueueScale(gameplayQueue, fieldScale, fieldX, fieldY);
+    // software renderers get the dirty rectangle blitters, the frame stays inactive otherwise. The
+    // blitters only copy unscaled
+    if (fieldScale == 1) startSoftwareFrame(gameplayFrame, renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (settings.capture) startCapture(gameplayCapture, renderer, settings.captureFps, "capture.y4m", "capture.wav");
+    // chart notes entering at or after this time are not on the highway yet, a seek or a reloaded
+    // chart puts the cursor back here
+    Uint32 nextNoteTime = 0;
     // start level rendering
     while (!isLevelEnd && !isQuit && !isSongEnd)
     {
+        // frames spent in the pause menu are not counted
+        bool isPausedFrame = isPause;
+        beginFrameAllocations(allocations);
+        countResourceFrame();
         if (isPause)
         {
             pause(isQuit, isLevelEnd, isPause, renderer, pausedTime);
+            recordReplayPause(levelReplay);
         }
         else
         {
-            passedTime = SDL_GetTicks() - pausedTime - beginningTime;
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
-            SDL_RenderClear(renderer);
-            guitarTexture.render(renderer);
-            scoreAndStarTexture.render(renderer);
-
-            while (SDL_TICKS_PASSED(passedTime, levelChart[currentNote].entryTime))
+            Uint32 realTime = SDL_GetTicks() - pausedTime - beginningTime;
+            passedTime = scaleTime(realTime, playbackRate);
+            // judged behind by the audio latency, drawn ahead by the visual latency, both real ms
+            Uint32 judgeTime = scaleTime(realTime - settings.audioOffset, playbackRate);
+            Uint32 renderTime = scaleTime(realTime - settings.audioOffset + settings.visualOffset, playbackRate);
+            Uint32 noteLeadTime = settings.visualOffset > 0 ? renderTime : judgeTime;
+            nextNoteTime = noteLeadTime + 1;
+            // whole ms make notes judder on high refresh displays, draw them from the performance counter
+            double preciseRenderTime = ((SDL_GetPerformanceCounter() - beginningCounter) * counterToMs - pausedTime
+                                        - settings.audioOffset + settings.visualOffset) * playbackRate / 100.0;
+            recordReplayFrame(levelReplay, judgeTime, renderTime, preciseRenderTime);
+            if (gameplayFrame.isActive) beginSoftwareFrame(gameplayFrame);
+            else
             {
-                onScreenNotes[numberOfOnScreenNotes] = levelChart[currentNote];
-                currentNote++;
-                numberOfOnScreenNotes++;
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
+                SDL_RenderClear(renderer);
             }
-
-            for (int i = 0; i < numberOfOnScreenNotes; i++)
+            // sprites are sorted by layer and texture and drawn in batches before presenting
+            beginRenderQueue(gameplayQueue);
+            if (playerCount == 1)
             {
-                // assign texture
-                SDL_Rect noteClip, holdNoteClip;
-                switch (onScreenNotes[i].lane)
+                guitarTexture.posX = highwayX;
+                queueSprite(gameplayQueue, layerBackground, renderer, guitarTexture);
+                queueSprite(gameplayQueue, layerBackground, renderer, scoreAndStarTexture);
+            }
+            else
+            {
+                // just the lanes, the multiplier dial would run into the next highway
+                SDL_Rect highwayClip = {0, 0, highwayWidth, guitarTexture.height};
+                for (int p = 0; p < playerCount; p++)
                 {
-                    case green:
-                        gameNoteTexture.posX = 150;
-                        holdNotesTexture.posX = 150 + 21;
-                        noteClip = noteClips[green];
-                        holdNoteClip = holdNoteClips[green];
-                        break;
-                    case red:
-                        gameNoteTexture.posX = 210;
-                        holdNotesTexture.posX = 210 + 21;
-                        noteClip = noteClips[red];
-                        holdNoteClip = holdNoteClips[red];
-                        break;
-                    case yellow:
-                        gameNoteTexture.posX = 270;
-                        holdNotesTexture.posX = 270 + 21;
-                        noteClip = noteClips[yellow];
-                        holdNoteClip = holdNoteClips[yellow];
-                        break;
-                    case blue:
-                        gameNoteTexture.posX = 330;
-                        holdNotesTexture.posX = 330 + 21;
-                        noteClip = noteClips[blue];
-                        holdNoteClip = holdNoteClips[blue];
-                        break;
-                    case orange:
-                        gameNoteTexture.posX = 390;
-                        holdNotesTexture.posX = 390 + 21;
-                        noteClip = noteClips[orange];
-                        holdNoteClip = holdNoteClips[orange];
-                        break;
+                    guitarTexture.posX = highwayX + levelPlayers[p].offsetX;
+                    queueSprite(gameplayQueue, layerBackground, renderer, guitarTexture, &highwayClip);
                 }
+                guitarTexture.posX = highwayX;
+            }
 
-                // posY calculation
-                onScreenNotes[i].currentPosY = (passedTime - onScreenNotes[i].entryTime) * noteSpeed[speed] - 99;
-                gameNoteTexture.posY = onScreenNotes[i].currentPosY;
-
-                // render gem
-                if (!onScreenNotes[i].isHeld || (onScreenNotes[i].isHeld && !onScreenNotes[i].pressed) )
+            startSection(profile);
+            for (int p = 0; p < playerCount; p++)
+            {
+                playerState &player = levelPlayers[p];
+                activeNotes &onScreenNotes = player.notes;
+                while (SDL_TICKS_PASSED(noteLeadTime, chart[player.currentNote].entryTime))
                 {
-                    gameNoteTexture.render(renderer, &noteClip);
+                    if (!addNote(onScreenNotes, chart[player.currentNote], speed))
+                    {
+                        logSDLError(std::cout, "Too many notes on screen, note dropped", false, none);
+                    }
+                    player.currentNote++;
                 }
 
-                // render trail if it is a hold note
-                if (onScreenNotes[i].isHeld)
+                // positions, trail ends, misses and notes leaving the screen, all in one batch before drawing
+                bool isMissed;
+                updateNotes(onScreenNotes, preciseRenderTime, renderTime, judgeTime, speed, isMissed);
+                //reset streak if missed note
+                if (isMissed) player.streak = 0;
+
+                for (int i = 0; i < onScreenNotes.count; i++)
                 {
-                    if (SDL_TICKS_PASSED(passedTime, onScreenNotes[i].entryTime + onScreenNotes[i].heldTime) && !onScreenNotes[i].heldEndCheck)
+                    // assign texture
+                    int lane = onScreenNotes.lane[i];
+                    SDL_Rect noteClip = noteClips[lane];
+                    SDL_Rect holdNoteClip = holdNoteClips[lane];
+                    gameNoteTexture.posX = player.offsetX + 150 + 60 * lane;
+                    holdNotesTexture.posX = player.offsetX + 150 + 60 * lane + 21;
+                    gameNoteTexture.posY = onScreenNotes.posY[i];
+
+                    // render gem
+                    if (!onScreenNotes.isHeld[i] || !onScreenNotes.pressed[i])
                     {
-                        onScreenNotes[i].heldLength = gameNoteTexture.posY;
-                        onScreenNotes[i].heldEndCheck = true;
+                        queueSprite(gameplayQueue, layerGems, renderer, gameNoteTexture, &noteClip);
                     }
-                    int endY;
-                    if (0 == onScreenNotes[i].heldLength) endY = -4;
-                    else endY = gameNoteTexture.posY - onScreenNotes[i].heldLength - 44;
-                    if (!onScreenNotes[i].pressed)
+
+                    // render trail if it is a hold note
+                    if (onScreenNotes.isHeld[i])
                     {
-                        for (int j = gameNoteTexture.posY; j >= endY; j -= 3)
+                        int endY;
+                        if (0 == onScreenNotes.heldLength[i]) endY = -4;
+                        else endY = gameNoteTexture.posY - onScreenNotes.heldLength[i] - 44;
+                        if (!onScreenNotes.pressed[i])
                         {
-                            holdNotesTexture.posY = j;
-                            holdNotesTexture.render(renderer, &holdNoteClip);
+                            for (int j = gameNoteTexture.posY; j >= endY; j -= 3)
+                            {
+                                holdNotesTexture.posY = j;
+                                queueSprite(gameplayQueue, layerTrails, renderer, holdNotesTexture, &holdNoteClip);
+                            }
                         }
-                    }
-                    else
-                    {
-                        for (int j = 594; j >= endY; j -= 3)
+                        else
                         {
-                            holdNotesTexture.posY = j;
-                            holdNotesTexture.render(renderer, &holdNoteClip);
+                            for (int j = 594; j >= endY; j -= 3)
+                            {
+                                holdNotesTexture.posY = j;
+                                queueSprite(gameplayQueue, layerTrails, renderer, holdNotesTexture, &holdNoteClip);
+                            }
                         }
                     }
                 }
-
-                //reset streak if missed note
-                if (onScreenNotes[i].currentPosY > 594 && !onScreenNotes[i].pressed) streak = 0;
-            }
-
-            while ( (!onScreenNotes[0].isHeld && onScreenNotes[0].currentPosY > SCREEN_HEIGHT) ||
-                   (onScreenNotes[0].isHeld && (onScreenNotes[0].currentPosY - onScreenNotes[0].heldLength) > SCREEN_HEIGHT) )
-            {
-                for (int i = 0; i < numberOfOnScreenNotes; i++)
-                {
-                    onScreenNotes[i] = onScreenNotes[i + 1];
-                }
-                numberOfOnScreenNotes--;
             }
+            endSection(profile, profileNotes);
 
             if (SDL_TICKS_PASSED(passedTime, levelLyrics[currentLyric].entryTime + musicStart))
             {
@@ -648,44 +819,86 @@ void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
             }
 
             //render lyric
+            startSection(profile);
             if (currentLyric - 1 >= 0)
             {
-                renderText(levelLyrics[currentLyric - 1].lyricOne, textColor, RalewayLightFont, renderer, textTexture, 480, 100);
-                if (levelLyrics[currentLyric - 1].lyricTwo != " ")
+                showLyric(lyricLines, currentLyric - 1, renderer);
+                renderLyric(lyricLines, renderer);
+            }
+
+            if (playerCount == 1)
+            {
+                // render score
+                renderCounter(scoreText, soloPlayer.score, textColor, ralewayLight, 28, renderer);
+                // render streak
+                renderCounter(streakText, soloPlayer.streak, textColor, ralewayLight, 28, renderer);
+                // render multiplier
+                renderCounter(multiplierText, soloPlayer.multiplier, textColor, ralewayLight, 28, renderer);
+                // render star
+                renderCounter(starText, soloPlayer.star, textColor, ralewayLight, 28, renderer);
+            }
+            else
+            {
+                // score, streak and multiplier at the top of each highway
+                for (int p = 0; p < playerCount; p++)
                 {
-                    renderText(levelLyrics[currentLyric - 1].lyricTwo, textColor, RalewayLightFont, renderer, textTexture, 480, 150);
+                    playerState &player = levelPlayers[p];
+                    renderCounter(player.scoreText, player.score, textColor, ralewayLight, 24, renderer);
+                    renderCounter(player.streakText, player.streak, textColor, ralewayLight, 20, renderer);
+                    renderCounter(player.multiplierText, player.multiplier, textColor, ralewayLight, 24, renderer);
                 }
             }
-
-            // render score
-            renderText(numberToString(score), textColor, RalewayLightFont, renderer, textTexture, 642, 435);
-            // render streak
-            renderText(numberToString(streak), textColor, RalewayLightFont, renderer, textTexture, 715, 492);
-            // render multiplier
-            renderText("x " + numberToString(multiplier), textColor, RalewayLightFont, renderer, textTexture, 480, 330);
-            // render star
-            renderText(numberToString(star), textColor, RalewayLightFont, renderer, textTexture, 907, 441);
+            // texture, font and audio memory, F3
+            if (isResourceOverlayShown) renderResourceTotals(resourceText, textColor, ralewayLight, 16, renderer);
+            endSection(profile, profileText);
 
             // light up button if pressed
-            for (int i = 0; i < 5; i++)
+            for (int p = 0; p < playerCount; p++)
             {
-                if (isButtonPressed[i])
+                for (int i = 0; i < 5; i++)
                 {
-                    SDL_Rect pressedButtonClip;
-                    pressedButtonsTexture.posX = 148 + 60 * i;
-                    pressedButtonClip = pressedButtonsClips[i];
-                    pressedButtonsTexture.render(renderer, &pressedButtonClip);
+                    if (levelPlayers[p].isButtonPressed[i])
+                    {
+                        SDL_Rect pressedButtonClip;
+                        pressedButtonsTexture.posX = levelPlayers[p].offsetX + 148 + 60 * i;
+                        pressedButtonClip = pressedButtonsClips[i];
+                        queueSprite(gameplayQueue, layerButtons, renderer, pressedButtonsTexture, &pressedButtonClip);
+                    }
                 }
             }
+
+            submitRenderQueue(gameplayQueue, renderer);
+            finishSoftwareFrame(gameplayFrame, renderer);
+
+            // hit and miss bursts on top of everything
+            startSection(profile);
+            Uint64 effectCounter = SDL_GetPerformanceCounter();
+            updateParticles(hitParticles, float((effectCounter - lastEffectCounter) * counterToMs));
+            lastEffectCounter = effectCounter;
+            renderParticles(hitParticles, renderer);
+            endSection(profile, profileEffects);
+
+            // the read back copies into the ring, encoding happens on the capture thread
+            captureFrame(gameplayCapture, renderer);
             SDL_RenderPresent(renderer);
+            countFrame(stats);
+            countProfileFrame(profile);
+            // idle time goes between presenting and reading input, so the next frame shows the newest keys
+            waitForNextFrame(limiter);
+        }
+        for (int p = 0; p < playerCount; p++)
+        {
+            playerState &player = levelPlayers[p];
+            scoreFrame(player.streak, player.multiplier, player.star, player.score, noMultiplierScore);
         }
-        if (streak <= 10) multiplier = 1;
-        else if (streak <= 20) multiplier = 2;
-        else if (streak <= 30) multiplier = 3;
-        else multiplier = 4;
-        if (score >= noMultiplierScore * starMultiplier[star]) star++;
         while (SDL_PollEvent(&e) != 0)
         {
+            int result = noJudgement;
+            // player and lane of the key handled, -1 for other keys
+            int resultPlayer = -1;
+            int resultLane = -1;
+            Sint32 offset = noTimingOffset;
+            Uint32 eventTime = scaleTime(e.key.timestamp - pausedTime - beginningTime - settings.audioOffset, playbackRate);
             //User requests quit
             if( e.type == SDL_QUIT )
             {
@@ -700,120 +913,283 @@ void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
                         case SDLK_ESCAPE:
                             isPause = true;
                             break;
-                        case SDLK_a:
-                            notePressHandle(green, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYDOWN, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[green] = true;
+                        case SDLK_LEFTBRACKET:
+                            practice.start = SDL_TICKS_PASSED(passedTime, musicStart) ? passedTime - musicStart : 0;
+                            practice.hasStart = true;
+                            practice.isLooping = false;
+                            break;
+                        case SDLK_RIGHTBRACKET:
+                            if (practice.hasStart && SDL_TICKS_PASSED(passedTime, practice.start + musicStart + 1))
+                            {
+                                practice.end = passedTime - musicStart;
+                                practice.isLooping = true;
+                                isSeekRequested = true;
+                            }
                             break;
-                        case SDLK_w:
-                            notePressHandle(red, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYDOWN, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[red] = true;
+                        case SDLK_BACKSLASH:
+                            practice.isLooping = false;
                             break;
-                        case SDLK_e:
-                            notePressHandle(yellow, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYDOWN, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[yellow] = true;
+                        case SDLK_BACKSPACE:
+                            if (e.key.repeat == 0) isSeekRequested = true;
                             break;
-                        case SDLK_r:
-                            notePressHandle(blue, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYDOWN, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[blue] = true;
+                        case SDLK_F3:
+                            isResourceOverlayShown = !isResourceOverlayShown;
                             break;
-                        case SDLK_t:
-                            notePressHandle(orange, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYDOWN, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[orange] = true;
+                        case SDLK_F4:
+                            dumpResources("resources.txt");
                             break;
                     }
                 }
-                else if (e.type == SDL_KEYUP)
+                // lane keys of every player, judged against that player's notes
+                if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+                    && findPlayerKey(e.key.keysym.sym, playerCount, resultPlayer, resultLane))
                 {
-                    switch( e.key.keysym.sym )
-                    {
-                        case SDLK_a:
-                            notePressHandle(green, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYUP, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[green] = false;
-                            break;
-                        case SDLK_w:
-                            notePressHandle(red, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYUP, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[red] = false;
-                            break;
-                        case SDLK_e:
-                            notePressHandle(yellow, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYUP, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[yellow] = false;
-                            break;
-                        case SDLK_r:
-                            notePressHandle(blue, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYUP, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[blue] = false;
-                            break;
-                        case SDLK_t:
-                            notePressHandle(orange, onScreenNotes, score, numberOfOnScreenNotes, e.key.repeat, SDL_KEYUP, passedTime, streak, multiplier, accuracy);
-                            isButtonPressed[orange] = false;
-                            break;
-                    }
+                    playerState &player = levelPlayers[resultPlayer];
+                    int keyState = e.type;
+                    result = notePressHandle(resultLane, player.notes, player.score, e.key.repeat, keyState, eventTime, player.streak,
+                                             player.multiplier, player.accuracy, speed, offset);
+                    player.isButtonPressed[resultLane] = e.type == SDL_KEYDOWN;
                 }
             }
+            // replays and timing telemetry follow the player of a solo run
+            if (playerCount == 1 && resultLane != -1 && e.key.repeat == 0) recordReplayKey(levelReplay, eventTime, resultLane, e.type);
+            if (playerCount == 1 && e.type == SDL_KEYDOWN && (result == noteHit || result == noteMiss)) recordTiming(levelTiming, resultLane, result, offset);
+            if (settings.hitSounds) playHitSound(hitSounds, result);
+            if (resultPlayer != -1) spawnBurst(hitParticles, resultLane, result, levelPlayers[resultPlayer].offsetX);
         }
-        if (streak > highestStreak) highestStreak = streak;
-        if (!isPlayingMusic && SDL_TICKS_PASSED(passedTime, musicStart))
+        for (int p = 0; p < playerCount; p++)
         {
-            switch (level)
+            playerState &player = levelPlayers[p];
+            if (player.streak > player.highestStreak) player.highestStreak = player.streak;
+        }
+        if (practice.isLooping && !isPause && SDL_TICKS_PASSED(passedTime, practice.end + musicStart)) isSeekRequested = true;
+        if (isSeekRequested && !isPause && !isLevelEnd && !isQuit)
+        {
+            isSeekRequested = false;
+            practice.isUsed = true;
+            // notes reaching the buttons from the loop start on fall in from the top, so the clock
+            // restarts one note fall before it, both cursors jump there by binary search
+            Uint32 seekTime = practice.hasStart ? practice.start : 0;
+            passedTime = seekTime;
+            anchorClock(beginningTime, beginningCounter, pausedTime, passedTime, playbackRate, counterToMs);
+            // every pass starts from zero, so the results show the last pass only
+            for (int p = 0; p < playerCount; p++)
             {
-                case levelChoose1:
-                    Mix_PlayMusic(levelOneSong, 1);
-                    break;
-                case levelChoose3:
-                    Mix_PlayMusic(levelThreeSong, 1);
-                    break;
+                playerState &player = levelPlayers[p];
+                resetPlayer(player, p, playerCount);
+                player.currentNote = noteIndexAt(levelChart, noteCount, seekTime);
+            }
+            nextNoteTime = seekTime;
+            clearTelemetry(levelTiming);
+            currentLyric = SDL_TICKS_PASSED(seekTime, musicStart) ? lyricIndexAt(levelLyrics, lyricCount, seekTime - musicStart) : 0;
+            seekLyricPipeline(lyricLines, currentLyric - 1);
+
+            Sint32 songPosition = Sint32(passedTime - musicStart);
+            if (isPcmPlayback)
+            {
+                // not scheduled yet means still decoding, it is scheduled from the new clock below
+                if (isPcmScheduled) seekPcm(gameplaySong, songPosition);
+            }
+            else if (songPosition < 0) Mix_HaltMusic();
+            else
+            {
+                if (Mix_PlayingMusic() == 0) Mix_PlayMusic(levelSong, 1);
+                if (Mix_SetMusicPosition(songPosition / 1000.0) != 0)
+                {
+                    logSDLError(std::cout, "Could not seek the song", false, MIX_Err);
+                }
+            }
+            isPlayingMusic = songPosition >= 0;
+        }
+        if (settings.hotReload && !isPause && !isLevelEnd && !isQuit)
+        {
+            if (takeReloadedChart(levelReload, levelChart, noteCount, noMultiplierScore))
+            {
+                // a run that played an edited chart is not a full play either
+                practice.isUsed = true;
+                // notes already on the highway keep their hits and holds, the new chart takes over
+                // from the first note that has not fallen in yet
+                for (int p = 0; p < playerCount; p++)
+                {
+                    levelPlayers[p].currentNote = noteIndexAt(levelChart, noteCount, nextNoteTime);
+                }
             }
+            if (hasReloadedLyrics(levelReload))
+            {
+                // the lyric worker reads the lines being replaced, so it stops before they are and
+                // starts again on the new ones. If the take misses them it starts on the old ones
+                stopLyricPipeline(lyricLines);
+                takeReloadedLyrics(levelReload, levelLyrics, lyricCount);
+                startLyricPipeline(lyricLines, levelLyrics, lyricCount, ralewayLight, 28, textColor);
+                currentLyric = SDL_TICKS_PASSED(passedTime, musicStart) ? lyricIndexAt(levelLyrics, lyricCount, passedTime - musicStart) : 0;
+                seekLyricPipeline(lyricLines, currentLyric - 1);
+            }
+        }
+        if (isPcmPlayback && !isPcmScheduled && !isPause)
+        {
+            if (isPcmDecoded(gameplaySong))
+            {
+                passedTime = scaleTime(SDL_GetTicks() - pausedTime - beginningTime, playbackRate);
+                // negative until the song starts, so this also covers a seek made while decoding
+                seekPcm(gameplaySong, Sint32(passedTime - musicStart));
+                isPcmScheduled = true;
+            }
+            else if (isPcmFailed(gameplaySong) || SDL_TICKS_PASSED(passedTime, musicStart))
+            {
+                // not ready in time, stream the song like before
+                logSDLError(std::cout, "PCM decode not ready, falling back to streaming", false, none);
+                unhookPcm(gameplaySong);
+                isPcmPlayback = false;
+                if (playbackRate != 100)
+                {
+                    // a streamed song can not be slowed, carry on at full speed from the same song time
+                    playbackRate = 100;
+                    anchorClock(beginningTime, beginningCounter, pausedTime, passedTime, playbackRate, counterToMs);
+                }
+            }
+        }
+        if (!isPcmPlayback && !isPlayingMusic && SDL_TICKS_PASSED(passedTime, musicStart))
+        {
+            Mix_PlayMusic(levelSong, 1);
+            touchMusic(levelSong);
             isPlayingMusic = true;
         }
+        if (isPcmPlayback && !isPlayingMusic && SDL_TICKS_PASSED(passedTime, musicStart)) isPlayingMusic = true;
 
-        if (isPlayingMusic && Mix_PlayingMusic() == 0)
+        if (isPlayingMusic && !isPcmPlayback && Mix_PlayingMusic() == 0)
         {
             isSongEnd = true;
         }
+        if (isPlayingMusic && isPcmPlayback && isPcmFinished(gameplaySong))
+        {
+            isSongEnd = true;
+        }
+        if (!isPausedFrame) endFrameAllocations(allocations);
+    }
+    stopCapture(gameplayCapture);
+    stopSoftwareFrame(gameplayFrame);
+    stopPcm(gameplaySong);
+    logFrameStats(stats);
+    logFrameProfile(profile);
+    logRenderQueue(gameplayQueue);
+    logAllocationStats(allocations);
+    freeCachedText(scoreText);
+    freeCachedText(streakText);
+    freeCachedText(multiplierText);
+    freeCachedText(starText);
+    freeCachedText(resourceText);
+    for (int p = 0; p < playerCount; p++)
+    {
+        freeCachedText(levelPlayers[p].scoreText);
+        freeCachedText(levelPlayers[p].streakText);
+        freeCachedText(levelPlayers[p].multiplierText);
     }
+    setRenderQueueScale(gameplayQueue, 1, 0, 0);
+    stopLyricPipeline(lyricLines);
+    stopHotReload(levelReload);
 
     if (isSongEnd)
     {
-        char *highscoreFilePath;
+        // a solo run's result, multiplayer shows every player's below instead
+        Uint32 score = soloPlayer.score;
+        int star = soloPlayer.star;
+        int accuracy = soloPlayer.accuracy;
+        int highestStreak = soloPlayer.highestStreak;
         std::string scoreDisplay = "Score: " + numberToString(score);
-        switch (level)
+        int accuracyPercent = double(accuracy)/noteCount * 100;
+        Uint64 song = songKey(chartPath);
+        const journalRecord* highScore;
+        bool isHighScore = topScores(levelScores, song, &highScore, 1) == 0 ? score > 0 : score > highScore->score;
+        bool isPersonalBest[maxPlayers];
+        // a run that used the practice loop is not a full play and does not go on the board
+        if (practice.isUsed)
         {
-            case levelChoose1:
-                highscoreFilePath = "assets/LevelOne/Highscore.txt";
-                break;
-            case levelChoose2:
-                highscoreFilePath = "assets/LevelTwo/Highscore.txt";
-                break;
-            case levelChoose3:
-                highscoreFilePath = "assets/LevelThree/Highscore.txt";
-                break;
+            scoreDisplay += "   (practice)";
         }
-        int highStar[10];
-        int highAccuracy[10];
-        Uint32 highScore[10];
-        int accuracyPercent = double(accuracy)/noteCount * 100;
-        getHighScore(highStar, highAccuracy, highScore, highscoreFilePath);
-        if (score > highScore[0])
+        else
         {
-            scoreDisplay += "   New high score!";
+            // every player's play goes into their history, under their player slot
+            for (int p = 0; p < playerCount; p++)
+            {
+                const playerState &player = levelPlayers[p];
+                const journalRecord* best = personalBest(levelScores, song, p);
+                isPersonalBest[p] = best == NULL ? player.score > 0 : player.score > best->score;
+                addScore(levelScores, song, p, player.score, player.star, player.accuracy, noteCount, player.highestStreak);
+            }
+            // replays are a single player's
+            if (playerCount == 1)
+            {
+                if (isHighScore)
+                {
+                    scoreDisplay += "   New high score!";
+                }
+                saveReplay(levelReplay, chartPath, chartHash, score, star, accuracy, highestStreak, noteCount);
+            }
         }
-        setHighScore(star, accuracyPercent, score, highscoreFilePath);
+        timingSummary timing;
+        summarizeTiming(levelTiming, speed, timing);
+        if (playerCount == 1)
+        {
+            exportTiming(levelTiming, timing, settings.timingExport,
+                         settings.timingExport == timingExportJson ? "timing.json" : "timing.csv");
+        }
+        const timingStats &allLanes = timing.lanes[5];
+        bool isDirty = true;
         while (!isQuit && !isLevelEnd)
         {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
-            SDL_RenderClear(renderer);
-            backgroundTexture.render(renderer);
-            bigBlackRectangle2Texture.render(renderer);
-            renderText(scoreDisplay, textColor, RalewayLightFont, renderer, textTexture, 70, 70);
-            renderText("Stars: " + numberToString(star), textColor, RalewayLightFont, renderer, textTexture, 70, 120);
-            renderText("Accuracy: " + numberToString(accuracy) + '/' + numberToString(noteCount) + " (" +
-                        numberToString(accuracyPercent) + "%)", textColor, RalewayLightFont, renderer, textTexture, 70, 170);
-            renderText("Highest streak: " + numberToString(highestStreak), textColor, RalewayLightFont, renderer, textTexture, 70, 220);
-            if (accuracy == noteCount)
+            if (isDirty)
             {
-                renderText("Full combo!" + numberToString(highestStreak), textColor, RalewayLightFont, renderer, textTexture, 70, 270);
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
+                SDL_RenderClear(renderer);
+                backgroundTexture.render(renderer);
+                bigBlackRectangle2Texture.render(renderer);
+                if (playerCount > 1)
+                {
+                    // a line each, named by their keys
+                    for (int p = 0; p < playerCount; p++)
+                    {
+                        const playerState &player = levelPlayers[p];
+                        int percent = noteCount > 0 ? int(double(player.accuracy) / noteCount * 100) : 0;
+                        std::string bestText = !practice.isUsed && isPersonalBest[p] ? "   Personal best!" : "";
+                        renderSdfText("Player " + numberToString(p + 1) + " (" + playerKeyNames[p] + "): " + numberToString(player.score)
+                                    + bestText, textColor, ralewayLight, 28, renderer, textTexture, 70, 70 + p * 110);
+                        renderSdfText("Stars " + numberToString(player.star) + ", accuracy " + numberToString(percent) +
+                                    "%, highest streak " + numberToString(player.highestStreak),
+                                    textColor, ralewayLight, 20, renderer, textTexture, 70, 110 + p * 110);
+                    }
+                }
+                else
+                {
+                    renderSdfText(scoreDisplay, textColor, ralewayLight, 28, renderer, textTexture, 70, 70);
+                    renderSdfText("Stars: " + numberToString(star), textColor, ralewayLight, 28, renderer, textTexture, 70, 120);
+                    renderSdfText("Accuracy: " + numberToString(accuracy) + '/' + numberToString(noteCount) + " (" +
+                                numberToString(accuracyPercent) + "%)", textColor, ralewayLight, 28, renderer, textTexture, 70, 170);
+                    renderSdfText("Highest streak: " + numberToString(highestStreak), textColor, ralewayLight, 28, renderer, textTexture, 70, 220);
+                    if (accuracy == noteCount)
+                    {
+                        renderSdfText("Full combo!" + numberToString(highestStreak), textColor, ralewayLight, 28, renderer, textTexture, 70, 270);
+                    }
+                    // timing of the hits, early on the left, late on the right
+                    renderTimingHistogram(timing, renderer, 620, 80, 432, 160);
+                    renderSdfText("-" + numberToString(timing.window) + " ms", textColor, ralewayLight, 20, renderer, textTexture, 620, 250);
+                    renderSdfText("+" + numberToString(timing.window) + " ms", textColor, ralewayLight, 20, renderer, textTexture, 990, 250);
+                    renderSdfText("Mean " + signedToString(int(SDL_floor(allLanes.mean + 0.5f))) + " ms, spread " +
+                                numberToString(int(allLanes.deviation + 0.5f)) + " ms", textColor, ralewayLight, 20, renderer, textTexture, 620, 290);
+                    renderSdfText("Early " + numberToString(allLanes.early) + ", late " + numberToString(allLanes.late),
+                                textColor, ralewayLight, 20, renderer, textTexture, 620, 320);
+                    for (int lane = 0; lane < 5; lane++)
+                    {
+                        const timingStats &stats = timing.lanes[lane];
+                        renderSdfText(std::string(timingLaneNames[lane]) + ": " + numberToString(stats.early) + " early, " +
+                                    numberToString(stats.late) + " late, mean " + signedToString(int(SDL_floor(stats.mean + 0.5f))) + " ms",
+                                    textColor, ralewayLight, 20, renderer, textTexture, 620, 360 + lane * 28);
+                    }
+                }
+                SDL_RenderPresent(renderer);
+                isDirty = false;
             }
-            SDL_RenderPresent(renderer);
-            while (SDL_PollEvent(&e) != 0)
+            bool isEvent = SDL_WaitEventTimeout(&e, idleWaitTime) != 0;
+            while (isEvent)
             {
                 //User requests quit
                 if( e.type == SDL_QUIT )
@@ -822,6 +1198,7 @@ void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
                 }
                 else
                 {
+                    if (e.type == SDL_WINDOWEVENT) isDirty = true;
                     if( e.type == SDL_KEYDOWN )
                     {
                         switch( e.key.keysym.sym )
@@ -832,6 +1209,7 @@ void playLevel(const int &level, bool &isQuit, SDL_Renderer* &renderer)
                         }
                     }
                 }
+                isEvent = SDL_PollEvent(&e) != 0;
             }
         }
     }
@@ -841,10 +1219,22 @@ void pause(bool &isQuit, bool &isLevelEnd, bool &isPause, SDL_Renderer* &rendere
 {
     Uint32 pauseStart = SDL_GetTicks();
     Mix_PauseMusic();
+    pausePcm(gameplaySong);
     SDL_Event e;
-    while (isPause)
+    bool isDirty = true;
+    while (isPause && !isQuit)
     {
-        while (SDL_PollEvent(&e) != 0)
+        // the pause screen is static, draw it once and then sleep until something happens
+        if (isDirty)
+        {
+            SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+            SDL_RenderClear( renderer );
+            pauseTexture.render(renderer);
+            SDL_RenderPresent(renderer);
+            isDirty = false;
+        }
+        bool isEvent = SDL_WaitEventTimeout(&e, idleWaitTime) != 0;
+        while (isEvent)
         {
             //User requests quit
             if( e.type == SDL_QUIT )
@@ -853,6 +1243,7 @@ void pause(bool &isQuit, bool &isLevelEnd, bool &isPause, SDL_Renderer* &rendere
             }
             else
             {
+                if (e.type == SDL_WINDOWEVENT) isDirty = true;
                 if( e.type == SDL_KEYDOWN )
                 {
                     switch( e.key.keysym.sym )
@@ -867,210 +1258,197 @@ void pause(bool &isQuit, bool &isLevelEnd, bool &isPause, SDL_Renderer* &rendere
                     }
                 }
             }
+            isEvent = SDL_PollEvent(&e) != 0;
         }
-        SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
-        SDL_RenderClear( renderer );
-        pauseTexture.render(renderer);
-        SDL_RenderPresent(renderer);
     }
     if (!isLevelEnd)
     {
         Mix_ResumeMusic();
+        resumePcm(gameplaySong);
         pausedTime += SDL_GetTicks() - pauseStart;
     }
     else Mix_HaltMusic();
 }
 
-void loadChart(gameNote (&levelChart)[2000], Uint32 &musicStart, char* file, int &noteCount, Uint32 &noMultiplierScore, int &speed)
+void calibrate(bool &isQuit, SDL_Renderer* &renderer)
 {
-    std::ifstream inFile(file);
-    int currentNote = 0;
-    Uint32 sum = 0;
-    if (inFile)
+    const int calibrationSpeed = 4;
+    Sint32 audioTaps[calibrationBeats];
+    Sint32 visualTaps[calibrationBeats];
+    int audioTapCount = 0;
+    int visualTapCount = 0;
+    bool isAborted = false;
+    bool isButtonPressed = false;
+    SDL_Event e;
+
+    // first only the metronome is heard, then only notes are seen, both are tapped along to
+    for (int phase = 0; phase < 2 && !isQuit && !isAborted; phase++)
     {
-        inFile >> speed >> noMultiplierScore;
-        musicStart = (594 - hitBox + 99) / noteSpeed[speed];
-        while (!inFile.eof())
+        Uint8* metronomeBuffer = NULL;
+        Uint32 phaseStart = SDL_GetTicks();
+        if (phase == 0)
         {
-            Uint32 entryTime_;
-            int lane_;
-            Uint32 heldTime_;
-            inFile >> entryTime_ >> lane_ >> heldTime_;
-            levelChart[currentNote].entryTime = entryTime_;
-            levelChart[currentNote].lane = lane_;
-            levelChart[currentNote].heldTime = heldTime_;
-            if (heldTime_ == 0)
-            {
-                levelChart[currentNote].isHeld = false;
-                sum+=50;
-            }
-            else
-            {
-                levelChart[currentNote].isHeld = true;
-                sum+=heldTime_/10;
-            }
-            currentNote++;
+            startPcmChunk(gameplaySong, synthesizeMetronome(calibrationInterval, calibrationBeats, metronomeBuffer));
+            schedulePcmStart(gameplaySong, calibrationLeadIn);
         }
-        inFile.close();
-        levelChart[currentNote].entryTime = 100000000;
-        noteCount = currentNote;
-    }
-    else
-    {
-        logSDLError(std::cout, "Could not open chart!", true, none);
-    }
-}
-
-void loadLyrics(gameLyrics (&levelLyrics)[150], char* file)
-{
-    std::ifstream inFile(file);
-    int currentLyric = 0;
-    if (inFile)
-    {
-        while (!inFile.eof())
+        Uint32 phaseEnd = phaseStart + calibrationLeadIn + calibrationBeats * calibrationInterval + 1000;
+        while (!isQuit && !isAborted && !SDL_TICKS_PASSED(SDL_GetTicks(), phaseEnd))
         {
-            Uint32 entryTime_;
-            std::string lyric_;
-            int numberOfLines;
-            inFile >> entryTime_ >> numberOfLines;
-            if (numberOfLines == 1) levelLyrics[currentLyric].lyricTwo = " ";
-            for (int i = 1; i <= numberOfLines; i++)
+            while (SDL_PollEvent(&e) != 0)
             {
-                getline(inFile, lyric_);
-                if (i == 1)
+                if (e.type == SDL_QUIT)
+                {
+                    isQuit = true;
+                }
+                else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
                 {
-                    levelLyrics[currentLyric].lyricOne = lyric_;
+                    isAborted = true;
                 }
-                if (i == 2)
+                else if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
+                {
+                    // the event timestamp is when the key went down, not when this frame got to it
+                    Sint32 offset;
+                    if (tapOffset(e.key.timestamp - phaseStart, offset))
+                    {
+                        if (phase == 0 && audioTapCount < calibrationBeats) audioTaps[audioTapCount++] = offset;
+                        if (phase == 1 && visualTapCount < calibrationBeats) visualTaps[visualTapCount++] = offset;
+                    }
+                    isButtonPressed = true;
+                }
+                else if (e.type == SDL_KEYUP)
                 {
-                    levelLyrics[currentLyric].lyricTwo = lyric_;
+                    isButtonPressed = false;
                 }
             }
-            levelLyrics[currentLyric].entryTime = entryTime_;
-            currentLyric++;
+
+            Uint32 phaseTime = SDL_GetTicks() - phaseStart;
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
+            SDL_RenderClear(renderer);
+            guitarTexture.render(renderer);
+            if (phase == 0)
+            {
+                renderSdfText("Tap any key along with the clicks", textColor, ralewayLight, 28, renderer, textTexture, 480, 100);
+            }
+            else
+            {
+                renderSdfText("Tap any key as the notes cross the buttons", textColor, ralewayLight, 28, renderer, textTexture, 480, 100);
+                gameNoteTexture.posX = 150;
+                for (int beat = 0; beat < calibrationBeats; beat++)
+                {
+                    Uint32 hitTime = calibrationLeadIn + beat * calibrationInterval;
+                    Uint32 entryTime = hitTime - Uint32((perfectY + 99) / noteSpeed[calibrationSpeed]);
+                    gameNoteTexture.posY = notePositionAt(entryTime, phaseTime, calibrationSpeed);
+                    if (gameNoteTexture.posY > -noteClips[green].h && gameNoteTexture.posY < SCREEN_HEIGHT)
+                    {
+                        gameNoteTexture.render(renderer, &noteClips[green]);
+                    }
+                }
+            }
+            renderSdfText("Esc: cancel", textColor, ralewayLight, 28, renderer, textTexture, 480, 150);
+            if (isButtonPressed)
+            {
+                pressedButtonsTexture.posX = 148;
+                pressedButtonsTexture.render(renderer, &pressedButtonsClips[green]);
+            }
+            SDL_RenderPresent(renderer);
+        }
+        if (phase == 0)
+        {
+            stopPcm(gameplaySong);
+            SDL_free(metronomeBuffer);
         }
-        inFile.close();
-        levelLyrics[currentLyric].entryTime = 100000000;
-        levelLyrics[currentLyric].lyricOne = "default text";
-        levelLyrics[currentLyric].lyricTwo = "default text";
     }
-    else
+    if (isQuit || isAborted) return;
+
+    int audioOffset = settings.audioOffset;
+    int visualOffset = settings.visualOffset;
+    int audioUsed = 0;
+    int visualUsed = 0;
+    bool isAudioValid = estimateOffset(audioTaps, audioTapCount, audioOffset, audioUsed);
+    bool isVisualValid = estimateOffset(visualTaps, visualTapCount, visualOffset, visualUsed);
+    std::string audioResult = "Audio offset: not enough steady taps";
+    std::string visualResult = "Visual offset: not enough steady taps";
+    if (isAudioValid)
     {
-        logSDLError(std::cout, "Could not open lyrics!", false, none);
+        audioResult = "Audio offset: " + signedToString(audioOffset) + " ms (" + numberToString(audioUsed) + " taps)";
+    }
+    if (isVisualValid)
+    {
+        visualResult = "Visual offset: " + signedToString(visualOffset) + " ms (" + numberToString(visualUsed) + " taps)";
     }
-}
 
-void notePressHandle(const int &lane, gameNote (&onScreenNotes)[200], Uint32 &score, int &numberOfOnScreenNotes,
-                     const int &keyRepeat, const int &keyState, const Uint32 &passedTime, int &streak, const int &multiplier, int &accuracy)
-{
-    int closestNote = -1;
-    for (int i = 0; i < numberOfOnScreenNotes; i++)
+    bool isChoosing = true;
+    bool isDirty = true;
+    while (isChoosing && !isQuit)
     {
-        if (onScreenNotes[i].lane == lane)
+        if (isDirty)
         {
-            closestNote = i;
-            break;
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xFF );
+            SDL_RenderClear(renderer);
+            backgroundTexture.render(renderer);
+            bigBlackRectangle2Texture.render(renderer);
+            renderSdfText(audioResult, textColor, ralewayLight, 28, renderer, textTexture, 70, 70);
+            renderSdfText(visualResult, textColor, ralewayLight, 28, renderer, textTexture, 70, 120);
+            renderSdfText("Enter: save   Esc: discard", textColor, ralewayLight, 28, renderer, textTexture, 70, 220);
+            SDL_RenderPresent(renderer);
+            isDirty = false;
         }
-    }
-    if (closestNote != -1)
-    {
-        if (keyState == SDL_KEYDOWN)
+        bool isEvent = SDL_WaitEventTimeout(&e, idleWaitTime) != 0;
+        while (isEvent)
         {
-            if (keyRepeat == 0)
+            if (e.type == SDL_QUIT)
             {
-                if (onScreenNotes[closestNote].currentPosY <= 594 &&
-                    onScreenNotes[closestNote].currentPosY >= 594 - hitBox)
-                {
-                    accuracy++;
-                    onScreenNotes[closestNote].pressed = true;
-                    if (!onScreenNotes[closestNote].isHeld)
-                    {
-                        for (int i = closestNote; i < numberOfOnScreenNotes; i++)
-                        {
-                            onScreenNotes[i] = onScreenNotes[i + 1];
-                        }
-                        numberOfOnScreenNotes--;
-                        score += 50 * multiplier;
-                    }
-                    else
-                    {
-                        onScreenNotes[closestNote].heldStartTime = passedTime;
-                    }
-                    streak++;
-                }
-                else streak = 0;
+                isQuit = true;
             }
-        }
-        else if (keyState == SDL_KEYUP && onScreenNotes[closestNote].pressed && !onScreenNotes[closestNote].released)
-        {
-            if (passedTime - onScreenNotes[closestNote].heldStartTime > onScreenNotes[closestNote].heldTime)
+            else if (e.type == SDL_WINDOWEVENT)
             {
-                score += onScreenNotes[closestNote].heldTime / 10 * multiplier;
+                isDirty = true;
             }
-            else
+            else if (e.type == SDL_KEYDOWN)
             {
-                score += ( passedTime - onScreenNotes[closestNote].heldStartTime ) / 10 * multiplier;
+                switch (e.key.keysym.sym)
+                {
+                    case SDLK_RETURN:
+                        // a phase without enough taps keeps its old value
+                        settings.audioOffset = audioOffset;
+                        settings.visualOffset = visualOffset;
+                        saveSettings(settings, "assets/Settings.txt");
+                        isChoosing = false;
+                        break;
+                    case SDLK_ESCAPE:
+                        isChoosing = false;
+                        break;
+                }
             }
-            onScreenNotes[closestNote].released = true;
+            isEvent = SDL_PollEvent(&e) != 0;
         }
     }
-    else if (keyState == SDL_KEYDOWN && keyRepeat == 0)
-    {
-        streak = 0;
-    }
 }
 
-void getHighScore(int (&highStar)[10], int (&highAccuracy)[10], Uint32 (&highScore)[10], char* file)
+void loadChart(gameNote (&levelChart)[2000], Uint32 &musicStart, char* file, int &noteCount, Uint32 &noMultiplierScore, int &speed,
+               Uint64 &chartHash)
 {
-    std::ifstream inFile(file);
-    if (inFile)
+    std::string text;
+    bool isRead = readAssetText(file, text);
+    if (isRead && parseChart(levelChart, text, musicStart, noteCount, noMultiplierScore, speed))
     {
-        for (int i = 0; i < 10; i++) inFile >> highStar[i] >> highAccuracy[i] >> highScore[i];
+        chartHash = hashChart(text);
     }
     else
     {
-        logSDLError(std::cout, "Could not load Highscore.txt!", true, none);
+        logSDLError(std::cout, "Could not open chart!", true, none);
     }
 }
 
-void setHighScore(int &highStar, int &highAccuracy, Uint32 &highScore, char* file)
+void loadLyrics(gameLyrics (&levelLyrics)[150], char* file, int &lyricCount)
 {
-    int star[10];
-    int accuracy[10];
-    Uint32 score[10];
-    int place = 10;
-    std::ifstream inFile(file);
-    if (inFile)
+    std::string text;
+    if (readAssetText(file, text))
     {
-        for (int i = 0; i < 10; i++)
-        {
-            inFile >> star[i] >> accuracy[i] >> score[i];
-        }
+        parseLyrics(levelLyrics, text, lyricCount);
     }
     else
     {
-        logSDLError(std::cout, "Could not load Highscore.txt!", true, none);
-    }
-    for (int i = 9; i >= 0; i--) if (highScore > score[i]) place--;
-    if (place != 10)
-    {
-        for (int i = 9; i > place; i--)
-        {
-            star[i] = star[i - 1];
-            accuracy[i] = accuracy[i - 1];
-            score[i] = score[i - 1];
-        }
-        star[place] = highStar;
-        accuracy[place] = highAccuracy;
-        score[place] = highScore;
-        std::ofstream outFile(file);
-        if (outFile)
-        {
-            for (int i = 0; i < 10; i++) outFile << star[i] << ' ' << accuracy[i] << ' ' << score[i] << std::endl;
-        }
-        else
-        {
-            logSDLError(std::cout, "Could not load Highscore.txt!", true, none);
-        }
+        logSDLError(std::cout, "Could not open lyrics!", false, none);
     }
-}
+}
\ No newline at end of file
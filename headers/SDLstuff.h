@@ -13,6 +13,23 @@ enum errorType
 
 void logSDLError(std::ostream& os, const std::string &msg, bool fatal, int type);
 
+// textures count themselves in the resource registry
+#include "resources.h"
+
+// how a copy of a texture's pixels has to be blended, worked out once when it is loaded
+enum pixelKinds
+{
+    pixelsOpaque,
+    // every pixel fully transparent or fully opaque, as color keyed images and solid text are
+    pixelsColorKey,
+    pixelsAlpha
+};
+
+// set when the renderer is a software one, textures then keep an ARGB8888 copy of their pixels
+// for the software gameplay backend
+bool isKeepingPixels = false;
+Uint32 lastPixelsId = 0;
+
 // texture with width and height
 struct textureE
 {
@@ -20,6 +37,14 @@ struct textureE
     int width;
     int height;
 
+    // CPU copy of the pixels, NULL unless isKeepingPixels. The id changes with every load
+    SDL_Surface* pixels;
+    Uint32 pixelsId;
+    int pixelsKind;
+
+    // slot in the resource registry, -1 while nothing is loaded
+    int resourceSlot;
+
     // position on screen
     int posX;
     int posY;
@@ -32,6 +57,18 @@ struct textureE
 
     void loadFromRenderedText( std::string textureText, SDL_Color textColor, TTF_Font* &textFont, SDL_Renderer* &renderer);
 
+    // same without building a std::string, for text formatted into a char buffer
+    void loadFromRenderedText( const char* textureText, SDL_Color textColor, TTF_Font* &textFont, SDL_Renderer* &renderer);
+
+    // upload a surface made elsewhere (e.g. on a worker thread), the surface is not freed
+    void loadFromSurface( SDL_Surface* surface, SDL_Renderer* &renderer, const char* owner = "surface");
+
+    // keep a converted copy of surface when isKeepingPixels
+    void keepPixels( SDL_Surface* surface);
+
+    // count the texture and its pixel copy in the resource registry
+    void trackMemory( const char* owner);
+
     void free();
 
     // render at position with rotation and flipping
@@ -39,7 +76,8 @@ struct textureE
                  double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE );
 };
 
-void initSDL(SDL_Window* &window, SDL_Renderer* &renderer);
+void initSDL(SDL_Window* &window, SDL_Renderer* &renderer, const int &audioFrequency, const int &audioBufferSize,
+             const int &presentMode, const bool &isSoftwareRender);
 
 void quitSDL(SDL_Window* &window, SDL_Renderer* &renderer);
 
@@ -53,6 +91,10 @@ textureE::textureE()
     texture = NULL;
     width = 0;
     height = 0;
+    pixels = NULL;
+    pixelsId = 0;
+    pixelsKind = pixelsOpaque;
+    resourceSlot = -1;
     posX = 0;
     posY = 0;
 }
@@ -62,6 +104,10 @@ textureE::textureE(int posX_, int posY_)
     texture = NULL;
     width = 0;
     height = 0;
+    pixels = NULL;
+    pixelsId = 0;
+    pixelsKind = pixelsOpaque;
+    resourceSlot = -1;
     posX = posX_;
     posY = posY_;
 }
@@ -81,16 +127,24 @@ void textureE::loadTexture(std::string path, SDL_Renderer* &renderer, const bool
             {
                 width = loadedSurface -> w;
                 height = loadedSurface -> h;
+                keepPixels(loadedSurface);
             }
             SDL_FreeSurface(loadedSurface);
         }
     texture = newTexture;
+    if (texture != NULL) trackMemory(path.c_str());
 }
 
 void textureE::loadFromRenderedText( std::string textureText, SDL_Color textColor, TTF_Font* &textFont, SDL_Renderer* &renderer)
+{
+    loadFromRenderedText(textureText.c_str(), textColor, textFont, renderer);
+}
+
+void textureE::loadFromRenderedText( const char* textureText, SDL_Color textColor, TTF_Font* &textFont, SDL_Renderer* &renderer)
 {
     free();
-    SDL_Surface* textSurface = TTF_RenderText_Solid( textFont, textureText.c_str(), textColor );
+    // UTF-8, TTF_RenderText only knows Latin-1
+    SDL_Surface* textSurface = TTF_RenderUTF8_Solid( textFont, textureText, textColor );
     if( textSurface == NULL )
     {
         logSDLError(std::cout, "Unable to render text surface!", true, TTF_Err);
@@ -108,6 +162,8 @@ void textureE::loadFromRenderedText( std::string textureText, SDL_Color textColo
             //Get image dimensions
             width = textSurface->w;
             height = textSurface->h;
+            keepPixels(textSurface);
+            trackMemory(textureText);
         }
 
         //Get rid of old surface
@@ -115,11 +171,69 @@ void textureE::loadFromRenderedText( std::string textureText, SDL_Color textColo
     }
 }
 
+void textureE::loadFromSurface( SDL_Surface* surface, SDL_Renderer* &renderer, const char* owner)
+{
+    free();
+    texture = SDL_CreateTextureFromSurface( renderer, surface );
+    if( texture == NULL )
+    {
+        logSDLError(std::cout, "Unable to create texture from surface!", true, SDL_Err );
+    }
+    else
+    {
+        width = surface->w;
+        height = surface->h;
+        keepPixels(surface);
+        trackMemory(owner);
+    }
+}
+
+void textureE::keepPixels( SDL_Surface* surface)
+{
+    if (!isKeepingPixels) return;
+    // color keys turn into zero alpha in the conversion
+    pixels = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (pixels == NULL)
+    {
+        logSDLError(std::cout, "Unable to keep texture pixels", false, SDL_Err);
+        return;
+    }
+    pixelsId = ++lastPixelsId;
+    bool isOpaque = true;
+    bool isMask = true;
+    for (int y = 0; y < pixels->h; y++)
+    {
+        const Uint32* row = (const Uint32*) ((const Uint8*) pixels->pixels + y * pixels->pitch);
+        for (int x = 0; x < pixels->w; x++)
+        {
+            Uint32 alpha = row[x] >> 24;
+            if (alpha != 0xFF) isOpaque = false;
+            if (alpha != 0 && alpha != 0xFF) isMask = false;
+        }
+    }
+    pixelsKind = isOpaque ? pixelsOpaque : (isMask ? pixelsColorKey : pixelsAlpha);
+}
+
+void textureE::trackMemory( const char* owner)
+{
+    Sint64 bytes = Sint64(width) * height * 4;
+    if (pixels != NULL) bytes += Sint64(pixels->pitch) * pixels->h;
+    resourceSlot = trackResource(texture, resourceTexture, bytes, owner);
+}
+
 void textureE::free()
 {
+    untrackResource(resourceSlot, texture);
+    if (pixels != NULL)
+    {
+        SDL_FreeSurface(pixels);
+        pixels = NULL;
+        pixelsId = 0;
+    }
     if (texture != NULL)
     {
         SDL_DestroyTexture(texture);
+        texture = NULL;
         width = 0;
         height = 0;
         posX = 0;
@@ -152,6 +266,7 @@ void logSDLError(std::ostream& os, const std::string &msg, bool fatal, int type)
 void textureE::render (SDL_Renderer* &renderer, SDL_Rect* clip /*= NULL*/,
                  double angle /*= 0.0*/, SDL_Point* center /*= NULL*/, SDL_RendererFlip flip /*= SDL_FLIP_NONE*/ )
 {
+    touchResource(resourceSlot);
     SDL_Rect renderPos = {posX, posY, width, height};
     if (clip != NULL)
     {
@@ -161,7 +276,8 @@ void textureE::render (SDL_Renderer* &renderer, SDL_Rect* clip /*= NULL*/,
     SDL_RenderCopyEx(renderer, texture, clip, &renderPos, angle, center, flip);
 }
 
-void initSDL(SDL_Window* &window, SDL_Renderer* &renderer)
+void initSDL(SDL_Window* &window, SDL_Renderer* &renderer, const int &audioFrequency, const int &audioBufferSize,
+             const int &presentMode, const bool &isSoftwareRender)
 {
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
     {
@@ -182,7 +298,7 @@ void initSDL(SDL_Window* &window, SDL_Renderer* &renderer)
             }
 
             //Initialize SDL_mixer
-            if( Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048 ) < 0 )
+            if( Mix_OpenAudio( audioFrequency, MIX_DEFAULT_FORMAT, 2, audioBufferSize ) < 0 )
             {
                 logSDLError(std::cout, "SDL_mixer could not initialize!", true, MIX_Err);
             }
@@ -194,16 +310,33 @@ void initSDL(SDL_Window* &window, SDL_Renderer* &renderer)
         }
 
     //Khi thông thường chạy với môi trường bình thường ở nhà
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED |
-                                              SDL_RENDERER_PRESENTVSYNC);
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (presentMode == presentVsync) rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    // adaptive vsync is only reachable through an OpenGL swap interval of -1
+    if (presentMode == presentAdaptive && !isSoftwareRender) SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
+    if (isSoftwareRender) rendererFlags = SDL_RENDERER_SOFTWARE | (rendererFlags & SDL_RENDERER_PRESENTVSYNC);
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
+    if (renderer != NULL && presentMode == presentAdaptive && SDL_GL_SetSwapInterval(-1) != 0)
+    {
+        logSDLError(std::cout, "Adaptive vsync unavailable, using vsync", false, SDL_Err);
+        SDL_RenderSetVSync(renderer, 1);
+    }
 
     //Khi chạy ở máy thực hành WinXP ở trường (máy ảo)
-    //renderer = SDL_CreateSoftwareRenderer(SDL_GetWindowSurface(window));
+    if (renderer == NULL)
+    {
+        logSDLError(std::cout, "No accelerated renderer, using software rendering", false, SDL_Err);
+        // a renderer made on the window surface would never update the window, this one presents to it
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    }
 
     if (renderer == NULL) logSDLError(std::cout, "CreateRenderer", true, SDL_Err);
     else
     {
         SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+        // gameplay then draws through its own SIMD blitters, see softrender.h
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE)) isKeepingPixels = true;
     }
 
     //SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
@@ -0,0 +1,210 @@
+#ifndef assetpack_h
+#define assetpack_h
+
+#include "packformat.h"
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// assets.pack made by tools/packassets.cpp, mapped into memory for the whole run. Textures are
+// uploaded straight from its decoded pixels and everything else is read through SDL_RWFromConstMem,
+// so startup opens one file and inflates no PNGs. Without a pack, or for anything not in it, the
+// loose files under assets/ are used as before.
+struct assetPack
+{
+    const Uint8* data;
+    Uint64 size;
+    const packEntry* entries;
+    int entryCount;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+
+    assetPack();
+};
+
+assetPack gamePack;
+
+// map the pack, false (and loose files from then on) if it is missing or not a valid pack
+bool openAssetPack(assetPack &pack, const char* path);
+
+// unmap the pack, everything read through it has to be freed first, including music streaming from it
+void closeAssetPack(assetPack &pack);
+
+// entry named path, NULL if the pack does not have it
+const packEntry* findAsset(const assetPack &pack, const char* path);
+
+// read only stream of path, from the pack if it is there and from the file otherwise
+SDL_RWops* openAsset(const char* path);
+
+// whole file as text with carriage returns dropped, like a text mode ifstream on Windows
+bool readAssetText(const char* path, std::string &text);
+
+// textureE::loadTexture that takes the pre-decoded pixels from the pack when it has them
+void loadAssetTexture(textureE &texture, const char* path, SDL_Renderer* &renderer, const bool &isColorKey);
+
+assetPack::assetPack()
+{
+    data = NULL;
+    size = 0;
+    entries = NULL;
+    entryCount = 0;
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    file = -1;
+#endif
+}
+
+bool openAssetPack(assetPack &pack, const char* path)
+{
+    closeAssetPack(pack);
+#ifdef _WIN32
+    pack.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (pack.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(pack.file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        pack.mapping = CreateFileMappingA(pack.file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (pack.mapping != NULL) pack.data = (const Uint8*) MapViewOfFile(pack.mapping, FILE_MAP_READ, 0, 0, 0);
+        pack.size = fileSize.QuadPart;
+    }
+#else
+    pack.file = open(path, O_RDONLY);
+    if (pack.file < 0) return false;
+    struct stat status;
+    if (fstat(pack.file, &status) == 0 && status.st_size > 0)
+    {
+        void* mapped = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, pack.file, 0);
+        if (mapped != MAP_FAILED)
+        {
+            pack.data = (const Uint8*) mapped;
+            pack.size = status.st_size;
+        }
+    }
+#endif
+    if (pack.data == NULL)
+    {
+        logSDLError(std::cout, "Could not map the asset pack, loading loose files", false, none);
+        closeAssetPack(pack);
+        return false;
+    }
+
+    // check everything the lookups rely on once, so they never have to
+    const packHeader* header = (const packHeader*) pack.data;
+    bool isValid = pack.size >= sizeof(packHeader) && SDL_memcmp(header->magic, packMagic, sizeof(header->magic)) == 0
+                   && header->version == packVersion
+                   && header->entryCount <= (pack.size - sizeof(packHeader)) / sizeof(packEntry);
+    if (isValid)
+    {
+        pack.entries = (const packEntry*) (pack.data + sizeof(packHeader));
+        pack.entryCount = header->entryCount;
+        for (int i = 0; i < pack.entryCount && isValid; i++)
+        {
+            const packEntry &entry = pack.entries[i];
+            isValid = entry.name[packNameLength - 1] == 0 && entry.offset <= pack.size && entry.size <= pack.size - entry.offset
+                      && (i == 0 || SDL_strcmp(pack.entries[i - 1].name, entry.name) < 0)
+                      && (entry.type != packImage || Uint64(entry.width) * entry.height * 4 == entry.size);
+        }
+    }
+    if (!isValid)
+    {
+        logSDLError(std::cout, "Asset pack is damaged or from another version, loading loose files", false, none);
+        closeAssetPack(pack);
+        return false;
+    }
+    return true;
+}
+
+void closeAssetPack(assetPack &pack)
+{
+#ifdef _WIN32
+    if (pack.data != NULL) UnmapViewOfFile(pack.data);
+    if (pack.mapping != NULL) CloseHandle(pack.mapping);
+    if (pack.file != INVALID_HANDLE_VALUE) CloseHandle(pack.file);
+    pack.mapping = NULL;
+    pack.file = INVALID_HANDLE_VALUE;
+#else
+    if (pack.data != NULL) munmap((void*) pack.data, pack.size);
+    if (pack.file >= 0) close(pack.file);
+    pack.file = -1;
+#endif
+    pack.data = NULL;
+    pack.size = 0;
+    pack.entries = NULL;
+    pack.entryCount = 0;
+}
+
+const packEntry* findAsset(const assetPack &pack, const char* path)
+{
+    // the table is sorted by name
+    int low = 0;
+    int high = pack.entryCount;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        int order = SDL_strcmp(pack.entries[middle].name, path);
+        if (order == 0) return &pack.entries[middle];
+        if (order < 0) low = middle + 1;
+        else high = middle;
+    }
+    return NULL;
+}
+
+SDL_RWops* openAsset(const char* path)
+{
+    const packEntry* entry = findAsset(gamePack, path);
+    if (entry != NULL && entry->type == packFile) return SDL_RWFromConstMem(gamePack.data + entry->offset, int(entry->size));
+    return SDL_RWFromFile(path, "rb");
+}
+
+bool readAssetText(const char* path, std::string &text)
+{
+    text.clear();
+    SDL_RWops* file = openAsset(path);
+    if (file == NULL) return false;
+    char buffer[4096];
+    size_t count;
+    while ((count = SDL_RWread(file, buffer, 1, sizeof(buffer))) > 0)
+    {
+        for (size_t i = 0; i < count; i++) if (buffer[i] != '\r') text += buffer[i];
+    }
+    SDL_RWclose(file);
+    return true;
+}
+
+void loadAssetTexture(textureE &texture, const char* path, SDL_Renderer* &renderer, const bool &isColorKey)
+{
+    const packEntry* entry = findAsset(gamePack, path);
+    if (entry == NULL || entry->type != packImage)
+    {
+        texture.loadTexture(path, renderer, isColorKey);
+        return;
+    }
+    // the surface only points into the mapping, nothing is copied before the upload
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom((void*) (gamePack.data + entry->offset), entry->width,
+                                                              entry->height, 32, entry->width * 4, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == NULL)
+    {
+        logSDLError(std::cout, "Unable to wrap packed image", false, SDL_Err);
+        texture.loadTexture(path, renderer, isColorKey);
+        return;
+    }
+    texture.loadFromSurface(surface, renderer, path);
+    SDL_FreeSurface(surface);
+    // like a PNG without a colour key, images with nothing to blend skip blending
+    if (texture.texture != NULL && (entry->flags & packOpaque)) SDL_SetTextureBlendMode(texture.texture, SDL_BLENDMODE_NONE);
+}
+
+#endif // assetpack_h
@@ -0,0 +1,508 @@
+#ifndef audio_h
+#define audio_h
+
+// Pre-decoded song playback. The whole song is decoded into a Mix_Chunk on a
+// background thread while the notes of the pre-roll scroll in, then it is fed
+// to the mixer from memory through Mix_HookMusic, starting at an exact output
+// sample instead of whenever Mix_PlayMusic gets going.
+struct pcmSong
+{
+    Mix_Chunk* chunk;
+    const char* path;
+    SDL_Thread* decodeThread;
+    // slot of chunk in the resource registry, set by whoever made the chunk
+    int resourceSlot;
+
+    // 0 while decoding, 1 when chunk is ready, -1 if decoding failed
+    SDL_atomic_t decodeState;
+    SDL_atomic_t isPaused;
+    SDL_atomic_t isFinished;
+    bool isHooked;
+
+    int frequency;
+    int frameSize;
+
+    // song clock, guarded by clockLock: output frames handed to the mixer since the
+    // hook was installed, and the time and frame of the latest audio callback
+    SDL_SpinLock clockLock;
+    Sint64 mixedFrames;
+    // output frame the song starts at, only meaningful once isScheduled
+    Sint64 startFrame;
+    bool isScheduled;
+    Uint64 anchorCounter;
+    Sint64 anchorFrame;
+    int bufferFrames;
+
+    // slowed practice playback, only touched by the hook once the song is scheduled
+    timeStretch stretch;
+
+    pcmSong();
+};
+
+pcmSong gameplaySong;
+
+// tap feedback sounds, loaded once and played on their own reserved channels so a
+// hit never waits for a free channel or a file read
+const int hitSoundChannel = 0;
+const int missSoundChannel = 1;
+
+struct hitSoundSet
+{
+    Mix_Chunk* hit;
+    Mix_Chunk* miss;
+    // sample memory of synthesized sounds, Mix_FreeChunk does not own it
+    Uint8* hitBuffer;
+    Uint8* missBuffer;
+    int hitSlot;
+    int missSlot;
+
+    hitSoundSet();
+};
+
+hitSoundSet hitSounds;
+
+void startPcmDecode(pcmSong &song, const char* path);
+
+void startPcmChunk(pcmSong &song, Mix_Chunk* chunk);
+
+bool isPcmDecoded(pcmSong &song);
+
+bool isPcmFailed(pcmSong &song);
+
+void schedulePcmStart(pcmSong &song, const Uint32 &msFromNow);
+
+// make the song heard from msIntoSong right now, a negative position starts it that many ms from now
+void seekPcm(pcmSong &song, const Sint32 &msIntoSong);
+
+// play at rate percent of normal speed with the pitch kept, call after startPcmDecode and before scheduling.
+// Returns false (and stays at full speed) if the mixer format can not be stretched
+bool setPcmRate(pcmSong &song, const int &rate);
+
+void pausePcm(pcmSong &song);
+
+void resumePcm(pcmSong &song);
+
+bool isPcmFinished(pcmSong &song);
+
+void loadHitSounds(hitSoundSet &sounds);
+
+void playHitSound(hitSoundSet &sounds, const int &result);
+
+Mix_Chunk* synthesizeMetronome(const int &interval, const int &beats, Uint8* &buffer);
+
+void freeHitSounds(hitSoundSet &sounds);
+
+void unhookPcm(pcmSong &song);
+
+void stopPcm(pcmSong &song);
+
+// Mix_LoadMUS from the assets, counted in the resource registry by the size of its file
+Mix_Music* loadMusic(const char* path);
+
+// mark music as used, when it starts playing
+void touchMusic(Mix_Music* music);
+
+void freeMusic(Mix_Music* &music);
+
+pcmSong::pcmSong()
+{
+    chunk = NULL;
+    path = NULL;
+    decodeThread = NULL;
+    resourceSlot = -1;
+    SDL_AtomicSet(&decodeState, 0);
+    SDL_AtomicSet(&isPaused, 0);
+    SDL_AtomicSet(&isFinished, 0);
+    isHooked = false;
+    frequency = 0;
+    frameSize = 0;
+    clockLock = 0;
+    mixedFrames = 0;
+    startFrame = -1;
+    isScheduled = false;
+    anchorCounter = 0;
+    anchorFrame = 0;
+    bufferFrames = 0;
+}
+
+hitSoundSet::hitSoundSet()
+{
+    hit = NULL;
+    miss = NULL;
+    hitBuffer = NULL;
+    missBuffer = NULL;
+    hitSlot = -1;
+    missSlot = -1;
+}
+
+int pcmDecodeThread(void* data)
+{
+    pcmSong* song = (pcmSong*) data;
+    // Mix_LoadWAV converts to the opened device format, so the callback can copy bytes as they are
+    song->chunk = Mix_LoadWAV_RW(openAsset(song->path), 1);
+    if (song->chunk != NULL) song->resourceSlot = trackResource(song->chunk, resourceSound, song->chunk->alen, song->path);
+    SDL_AtomicSet(&song->decodeState, song->chunk != NULL ? 1 : -1);
+    return 0;
+}
+
+// the slowed path of pcmSongMix, songFrame counts output frames since the song start
+void pcmStretchMix(pcmSong* song, Uint8* stream, const int &frames, Sint64 songFrame)
+{
+    int skip = 0;
+    if (songFrame < 0)
+    {
+        if (-songFrame >= frames) return;
+        skip = -songFrame;
+        songFrame = 0;
+    }
+    timeStretch &stretch = song->stretch;
+    const Sint16* samples = (const Sint16*) song->chunk->abuf;
+    Sint64 songFrames = song->chunk->alen / song->frameSize;
+    // a seek (or the first callback) moves the song somewhere the last segment does not lead to
+    if (songFrame != stretch.expectedFrame) resetStretch(stretch, samples, songFrames, songFrame);
+    if (!writeStretched(stretch, samples, songFrames, (Sint16*) (stream + skip * song->frameSize), frames - skip))
+    {
+        SDL_AtomicSet(&song->isFinished, 1);
+    }
+}
+
+void pcmSongMix(void* udata, Uint8* stream, int len)
+{
+    pcmSong* song = (pcmSong*) udata;
+    if (SDL_AtomicGet(&song->isPaused)) return;
+
+    int frames = len / song->frameSize;
+    SDL_AtomicLock(&song->clockLock);
+    Sint64 firstFrame = song->mixedFrames;
+    song->anchorCounter = SDL_GetPerformanceCounter();
+    song->anchorFrame = firstFrame;
+    song->bufferFrames = frames;
+    song->mixedFrames += frames;
+    Sint64 startFrame = song->startFrame;
+    bool isScheduled = song->isScheduled;
+    SDL_AtomicUnlock(&song->clockLock);
+
+    // not scheduled yet, the mixer has already filled the stream with silence
+    if (!isScheduled) return;
+
+    Sint64 songFrame = firstFrame - startFrame;
+    if (song->stretch.rate != 100)
+    {
+        pcmStretchMix(song, stream, frames, songFrame);
+        return;
+    }
+    int skip = 0;
+    if (songFrame < 0)
+    {
+        if (-songFrame >= frames) return;
+        skip = -songFrame;
+        songFrame = 0;
+    }
+    Sint64 byteOffset = songFrame * song->frameSize;
+    if (byteOffset >= song->chunk->alen)
+    {
+        SDL_AtomicSet(&song->isFinished, 1);
+        return;
+    }
+    Sint64 bytes = (Sint64)(frames - skip) * song->frameSize;
+    if (bytes > song->chunk->alen - byteOffset) bytes = song->chunk->alen - byteOffset;
+    SDL_memcpy(stream + skip * song->frameSize, song->chunk->abuf + byteOffset, bytes);
+}
+
+void startPcmDecode(pcmSong &song, const char* path)
+{
+    stopPcm(song);
+    Uint16 format;
+    int channels;
+    if (Mix_QuerySpec(&song.frequency, &format, &channels) == 0)
+    {
+        logSDLError(std::cout, "Could not query audio format for PCM playback", false, MIX_Err);
+        SDL_AtomicSet(&song.decodeState, -1);
+        return;
+    }
+    song.frameSize = channels * SDL_AUDIO_BITSIZE(format) / 8;
+    song.path = path;
+    song.mixedFrames = 0;
+    song.startFrame = -1;
+    song.isScheduled = false;
+    startStretch(song.stretch, 100, channels);
+    song.anchorCounter = SDL_GetPerformanceCounter();
+    song.anchorFrame = 0;
+    song.bufferFrames = 0;
+    SDL_AtomicSet(&song.decodeState, 0);
+    SDL_AtomicSet(&song.isPaused, 0);
+    SDL_AtomicSet(&song.isFinished, 0);
+
+    // the hook runs from now on so the song clock covers the whole pre-roll
+    Mix_HookMusic(pcmSongMix, &song);
+    song.isHooked = true;
+
+    if (path == NULL) return;
+    song.decodeThread = SDL_CreateThread(pcmDecodeThread, "pcmDecode", &song);
+    if (song.decodeThread == NULL)
+    {
+        logSDLError(std::cout, "Could not start PCM decode thread", false, SDL_Err);
+        SDL_AtomicSet(&song.decodeState, -1);
+    }
+}
+
+// play an already decoded chunk through the same scheduled hook
+void startPcmChunk(pcmSong &song, Mix_Chunk* chunk)
+{
+    startPcmDecode(song, NULL);
+    song.chunk = chunk;
+    if (chunk != NULL) song.resourceSlot = trackResource(chunk, resourceSound, chunk->alen, "chunk");
+    SDL_AtomicSet(&song.decodeState, chunk != NULL ? 1 : -1);
+}
+
+bool isPcmDecoded(pcmSong &song)
+{
+    return SDL_AtomicGet(&song.decodeState) == 1;
+}
+
+bool isPcmFailed(pcmSong &song)
+{
+    return SDL_AtomicGet(&song.decodeState) == -1;
+}
+
+void schedulePcmStart(pcmSong &song, const Uint32 &msFromNow)
+{
+    seekPcm(song, -Sint32(msFromNow));
+}
+
+void seekPcm(pcmSong &song, const Sint32 &msIntoSong)
+{
+    touchResource(song.resourceSlot);
+    double perfFrequency = SDL_GetPerformanceFrequency();
+    Uint64 now = SDL_GetPerformanceCounter();
+    SDL_AtomicLock(&song.clockLock);
+    // frames written by the latest callback are heard about one buffer after it ran
+    // a slowed song takes longer to reach the same position
+    double secondsAfterAnchor = (now - song.anchorCounter) / perfFrequency - msIntoSong / 10.0 / song.stretch.rate
+                                - double(song.bufferFrames) / song.frequency;
+    song.startFrame = song.anchorFrame + Sint64(SDL_floor(secondsAfterAnchor * song.frequency + 0.5));
+    song.isScheduled = true;
+    SDL_AtomicUnlock(&song.clockLock);
+    SDL_AtomicSet(&song.isFinished, 0);
+}
+
+bool setPcmRate(pcmSong &song, const int &rate)
+{
+    int frequency;
+    Uint16 format;
+    int channels;
+    if (rate >= 100) return startStretch(song.stretch, 100, 0);
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0 || format != AUDIO_S16SYS
+        || !startStretch(song.stretch, rate, channels))
+    {
+        logSDLError(std::cout, "Audio format can not be slowed down, playing at full speed", false, none);
+        startStretch(song.stretch, 100, 0);
+        return false;
+    }
+    return true;
+}
+
+void pausePcm(pcmSong &song)
+{
+    if (song.isHooked) SDL_AtomicSet(&song.isPaused, 1);
+}
+
+void resumePcm(pcmSong &song)
+{
+    if (song.isHooked) SDL_AtomicSet(&song.isPaused, 0);
+}
+
+bool isPcmFinished(pcmSong &song)
+{
+    return SDL_AtomicGet(&song.isFinished) == 1;
+}
+
+// decaying sine frames long written into a mono buffer
+void writeClick(Sint16* samples, const int &frames, const int &frequency, const double &pitch, const double &volume)
+{
+    for (int i = 0; i < frames; i++)
+    {
+        double t = double(i) / frequency;
+        double envelope = 1.0 - double(i) / frames;
+        samples[i] = Sint16(SDL_sin(2 * M_PI * pitch * t) * envelope * envelope * envelope * volume * 32767);
+    }
+}
+
+// build a chunk in the device format from generated mono samples, writeSamples fills the buffer
+Mix_Chunk* synthesizeChunk(const int &frames, Uint8* &buffer, void (*writeSamples)(Sint16*, const int &, const int &, void*), void* data)
+{
+    int frequency;
+    Uint16 format;
+    int channels;
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0) return NULL;
+
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, AUDIO_S16SYS, 1, frequency, format, channels, frequency) < 0) return NULL;
+    cvt.len = frames * 2;
+    cvt.buf = (Uint8*) SDL_calloc(cvt.len * cvt.len_mult, 1);
+    if (cvt.buf == NULL) return NULL;
+    writeSamples((Sint16*) cvt.buf, frames, frequency, data);
+    if (cvt.needed && SDL_ConvertAudio(&cvt) < 0)
+    {
+        SDL_free(cvt.buf);
+        return NULL;
+    }
+
+    Mix_Chunk* chunk = Mix_QuickLoad_RAW(cvt.buf, cvt.len_cvt);
+    if (chunk == NULL) SDL_free(cvt.buf);
+    else buffer = cvt.buf;
+    return chunk;
+}
+
+struct clickShape
+{
+    double pitch;
+    double volume;
+};
+
+void writeSingleClick(Sint16* samples, const int &frames, const int &frequency, void* data)
+{
+    clickShape* shape = (clickShape*) data;
+    // the chunk is exactly one click long
+    writeClick(samples, frames, frequency, shape->pitch, shape->volume);
+}
+
+Mix_Chunk* synthesizeClick(const double &pitch, const int &lengthMs, const double &volume, Uint8* &buffer)
+{
+    int frequency;
+    if (Mix_QuerySpec(&frequency, NULL, NULL) == 0) return NULL;
+    clickShape shape = {pitch, volume};
+    return synthesizeChunk(frequency * lengthMs / 1000, buffer, writeSingleClick, &shape);
+}
+
+void writeMetronome(Sint16* samples, const int &frames, const int &frequency, void* data)
+{
+    int interval = *(int*) data;
+    int beatFrames = frequency * interval / 1000;
+    for (int beat = 0; (beat + 1) * beatFrames <= frames; beat++)
+    {
+        // accent every fourth click
+        writeClick(samples + beat * beatFrames, frequency * 30 / 1000, frequency, beat % 4 == 0 ? 1760 : 1320, 0.6);
+    }
+}
+
+// click track with the first click at sample 0
+Mix_Chunk* synthesizeMetronome(const int &interval, const int &beats, Uint8* &buffer)
+{
+    int frequency;
+    if (Mix_QuerySpec(&frequency, NULL, NULL) == 0) return NULL;
+    int beatInterval = interval;
+    return synthesizeChunk(frequency * interval / 1000 * beats, buffer, writeMetronome, &beatInterval);
+}
+
+void loadHitSounds(hitSoundSet &sounds)
+{
+    freeHitSounds(sounds);
+    Mix_ReserveChannels(2);
+
+    // custom samples win, otherwise build a click and a thud
+    sounds.hit = Mix_LoadWAV_RW(openAsset("assets/hit.wav"), 1);
+    if (sounds.hit == NULL) sounds.hit = synthesizeClick(1760, 35, 0.5, sounds.hitBuffer);
+    sounds.miss = Mix_LoadWAV_RW(openAsset("assets/miss.wav"), 1);
+    if (sounds.miss == NULL) sounds.miss = synthesizeClick(110, 80, 0.6, sounds.missBuffer);
+
+    if (sounds.hit == NULL || sounds.miss == NULL)
+    {
+        logSDLError(std::cout, "Could not create hit sounds", false, MIX_Err);
+    }
+    if (sounds.hit != NULL) sounds.hitSlot = trackResource(sounds.hit, resourceSound, sounds.hit->alen, "hit sound");
+    if (sounds.miss != NULL) sounds.missSlot = trackResource(sounds.miss, resourceSound, sounds.miss->alen, "miss sound");
+}
+
+void playHitSound(hitSoundSet &sounds, const int &result)
+{
+    // restarting the reserved channel cuts the previous sound instead of queueing
+    if (result == noteHit && sounds.hit != NULL)
+    {
+        Mix_PlayChannel(hitSoundChannel, sounds.hit, 0);
+        touchResource(sounds.hitSlot);
+    }
+    else if (result == noteMiss && sounds.miss != NULL)
+    {
+        Mix_PlayChannel(missSoundChannel, sounds.miss, 0);
+        touchResource(sounds.missSlot);
+    }
+}
+
+void freeHitSounds(hitSoundSet &sounds)
+{
+    if (sounds.hit != NULL)
+    {
+        Mix_HaltChannel(hitSoundChannel);
+        untrackResource(sounds.hitSlot, sounds.hit);
+        Mix_FreeChunk(sounds.hit);
+        sounds.hit = NULL;
+    }
+    if (sounds.miss != NULL)
+    {
+        Mix_HaltChannel(missSoundChannel);
+        untrackResource(sounds.missSlot, sounds.miss);
+        Mix_FreeChunk(sounds.miss);
+        sounds.miss = NULL;
+    }
+    SDL_free(sounds.hitBuffer);
+    SDL_free(sounds.missBuffer);
+    sounds.hitBuffer = NULL;
+    sounds.missBuffer = NULL;
+}
+
+// detach from the mixer without waiting for the decode thread
+void unhookPcm(pcmSong &song)
+{
+    if (song.isHooked)
+    {
+        Mix_HookMusic(NULL, NULL);
+        song.isHooked = false;
+    }
+}
+
+void stopPcm(pcmSong &song)
+{
+    unhookPcm(song);
+    if (song.decodeThread != NULL)
+    {
+        SDL_WaitThread(song.decodeThread, NULL);
+        song.decodeThread = NULL;
+    }
+    if (song.chunk != NULL)
+    {
+        untrackResource(song.resourceSlot, song.chunk);
+        Mix_FreeChunk(song.chunk);
+        song.chunk = NULL;
+    }
+    SDL_AtomicSet(&song.decodeState, 0);
+}
+
+Mix_Music* loadMusic(const char* path)
+{
+    SDL_RWops* file = openAsset(path);
+    if (file == NULL) return NULL;
+    Sint64 bytes = SDL_RWsize(file);
+    Mix_Music* music = Mix_LoadMUS_RW(file, 1);
+    if (music != NULL) trackResource(music, resourceMusic, bytes, path);
+    return music;
+}
+
+void touchMusic(Mix_Music* music)
+{
+    if (music == NULL) return;
+    // a few songs are loaded, looking the slot up when one starts is cheap
+    SDL_AtomicLock(&resources.lock);
+    for (int i = 0; i < resources.slotCount; i++) if (resources.entries[i].handle == music) touchResource(i);
+    SDL_AtomicUnlock(&resources.lock);
+}
+
+void freeMusic(Mix_Music* &music)
+{
+    if (music == NULL) return;
+    untrackHandle(music);
+    Mix_FreeMusic(music);
+    music = NULL;
+}
+
+#endif // audio_h
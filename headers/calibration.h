@@ -0,0 +1,95 @@
+#ifndef calibration_h
+#define calibration_h
+
+// metronome used by the calibration screen
+const int calibrationInterval = 500;
+const int calibrationLeadIn = 2000;
+const int calibrationBeats = 24;
+// the first taps are warm up and are not counted
+const int calibrationWarmUpBeats = 4;
+
+// histogram used to find where most taps landed
+const int offsetHistogramRange = 250;
+const int offsetHistogramBin = 5;
+const int minCalibrationTaps = 8;
+
+// signed distance in ms from a tap to the closest beat, false if the tap is not near any counted beat
+bool tapOffset(const Sint32 &tapTime, Sint32 &offset);
+
+// estimate the latency from tap offsets, returns false if there were not enough consistent taps
+bool estimateOffset(const Sint32* offsets, const int &count, int &estimate, int &usedTaps);
+
+bool tapOffset(const Sint32 &tapTime, Sint32 &offset)
+{
+    Sint32 fromFirstBeat = tapTime - calibrationLeadIn;
+    int beat = (fromFirstBeat + calibrationInterval / 2) / calibrationInterval;
+    if (fromFirstBeat + calibrationInterval / 2 < 0) return false;
+    if (beat < calibrationWarmUpBeats || beat >= calibrationBeats) return false;
+    offset = fromFirstBeat - beat * calibrationInterval;
+    return true;
+}
+
+bool estimateOffset(const Sint32* offsets, const int &count, int &estimate, int &usedTaps)
+{
+    const int binCount = 2 * offsetHistogramRange / offsetHistogramBin + 1;
+    int histogram[binCount];
+    for (int i = 0; i < binCount; i++) histogram[i] = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (offsets[i] < -offsetHistogramRange || offsets[i] > offsetHistogramRange) continue;
+        histogram[(offsets[i] + offsetHistogramRange) / offsetHistogramBin]++;
+    }
+
+    // peak of the histogram smoothed over three bins, stray taps far from it do not move it
+    int peakBin = 0;
+    int peakCount = -1;
+    for (int i = 0; i < binCount; i++)
+    {
+        int smoothed = histogram[i];
+        if (i > 0) smoothed += histogram[i - 1];
+        if (i < binCount - 1) smoothed += histogram[i + 1];
+        if (smoothed > peakCount)
+        {
+            peakCount = smoothed;
+            peakBin = i;
+        }
+    }
+    double center = peakBin * offsetHistogramBin - offsetHistogramRange + offsetHistogramBin / 2.0;
+
+    // mean around the peak, then drop taps more than 2.5 standard deviations out and average again
+    double window = 60;
+    double mean = center;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double sum = 0;
+        double sumSquares = 0;
+        int used = 0;
+        for (int i = 0; i < count; i++)
+        {
+            double distance = offsets[i] - center;
+            if (distance < -window || distance > window) continue;
+            sum += offsets[i];
+            sumSquares += double(offsets[i]) * offsets[i];
+            used++;
+        }
+        if (used < minCalibrationTaps)
+        {
+            if (pass == 0)
+            {
+                usedTaps = used;
+                return false;
+            }
+            break;
+        }
+        usedTaps = used;
+        mean = sum / used;
+        double deviation = SDL_sqrt(sumSquares / used - mean * mean);
+        center = mean;
+        window = 2.5 * deviation;
+        if (window < offsetHistogramBin) window = offsetHistogramBin;
+    }
+    estimate = mean < 0 ? int(mean - 0.5) : int(mean + 0.5);
+    return true;
+}
+
+#endif // calibration_h
@@ -0,0 +1,404 @@
+#ifndef capture_h
+#define capture_h
+
+// Gameplay recording. Every frame is read back from the renderer into a ring of preallocated
+// buffers and a worker thread converts and writes them as Y4M video, while a Mix_SetPostMix tap
+// feeds the mixer output through a lock-free ring into a WAV file. The render loop never waits
+// for the worker: when the ring is full the frame is dropped, counted, and the frame after it is
+// held longer in the file so video and audio stay in step.
+const int captureSlots = 8;
+// about two seconds of 44.1 kHz stereo 16-bit audio, must be a power of two
+const int captureAudioRingSize = 1 << 19;
+
+struct captureSlot
+{
+    Uint8* pixels;
+    // how many video frames this picture stands for
+    int repeat;
+};
+
+struct captureState
+{
+    bool isCapturing;
+    int width;
+    int height;
+    int fps;
+    Uint64 startCounter;
+    // video frames accounted for so far, written or dropped
+    Sint64 frameTicks;
+    // ticks of dropped frames, added to the next frame that makes it into the ring
+    int pendingRepeat;
+
+    SDL_Thread* thread;
+    SDL_mutex* lock;
+    SDL_cond* frameReady;
+    captureSlot slots[captureSlots];
+    // guarded by lock
+    int head;
+    int tail;
+    int filled;
+    bool isStopping;
+
+    // worker side
+    std::ofstream videoFile;
+    std::ofstream audioFile;
+    Uint8* yuvBuffer;
+    Uint32 framesWritten;
+    Uint32 audioBytesWritten;
+
+    // mixer tap, written by the audio thread and read by the worker
+    Uint8* audioRing;
+    SDL_atomic_t audioWritten;
+    SDL_atomic_t audioRead;
+    SDL_atomic_t audioDropped;
+    int audioFrequency;
+    int audioChannels;
+    int audioBytesPerSample;
+    bool isAudioFloat;
+
+    // render thread
+    Uint32 framesDropped;
+
+    captureState();
+};
+
+captureState gameplayCapture;
+
+// allocate the ring, open the files and start the worker, false (with the reason logged) if it could not
+bool startCapture(captureState &capture, SDL_Renderer* &renderer, const int &fps, const char* videoPath,
+                  const char* audioPath);
+
+// read back the frame just drawn, call right before SDL_RenderPresent
+void captureFrame(captureState &capture, SDL_Renderer* &renderer);
+
+// finish writing what is queued, close the files and report written and dropped frames
+void stopCapture(captureState &capture);
+
+captureState::captureState()
+{
+    isCapturing = false;
+    width = 0;
+    height = 0;
+    fps = 60;
+    startCounter = 0;
+    frameTicks = 0;
+    pendingRepeat = 0;
+    thread = NULL;
+    lock = NULL;
+    frameReady = NULL;
+    for (int i = 0; i < captureSlots; i++)
+    {
+        slots[i].pixels = NULL;
+        slots[i].repeat = 0;
+    }
+    head = 0;
+    tail = 0;
+    filled = 0;
+    isStopping = false;
+    yuvBuffer = NULL;
+    framesWritten = 0;
+    audioBytesWritten = 0;
+    audioRing = NULL;
+    SDL_AtomicSet(&audioWritten, 0);
+    SDL_AtomicSet(&audioRead, 0);
+    SDL_AtomicSet(&audioDropped, 0);
+    audioFrequency = 0;
+    audioChannels = 0;
+    audioBytesPerSample = 0;
+    isAudioFloat = false;
+    framesDropped = 0;
+}
+
+void writeLittleEndian(std::ofstream &file, const Uint32 &value, const int &bytes)
+{
+    for (int i = 0; i < bytes; i++) file.put(char((value >> (8 * i)) & 0xFF));
+}
+
+// RIFF header, the two sizes are patched in by finishWavHeader once the length is known
+void writeWavHeader(captureState &capture)
+{
+    std::ofstream &file = capture.audioFile;
+    int blockAlign = capture.audioChannels * capture.audioBytesPerSample;
+    file.write("RIFF", 4);
+    writeLittleEndian(file, 0, 4);
+    file.write("WAVEfmt ", 8);
+    writeLittleEndian(file, 16, 4);
+    // 1 is integer PCM, 3 is float
+    writeLittleEndian(file, capture.isAudioFloat ? 3 : 1, 2);
+    writeLittleEndian(file, capture.audioChannels, 2);
+    writeLittleEndian(file, capture.audioFrequency, 4);
+    writeLittleEndian(file, capture.audioFrequency * blockAlign, 4);
+    writeLittleEndian(file, blockAlign, 2);
+    writeLittleEndian(file, capture.audioBytesPerSample * 8, 2);
+    file.write("data", 4);
+    writeLittleEndian(file, 0, 4);
+}
+
+void finishWavHeader(captureState &capture)
+{
+    capture.audioFile.seekp(4);
+    writeLittleEndian(capture.audioFile, 36 + capture.audioBytesWritten, 4);
+    capture.audioFile.seekp(40);
+    writeLittleEndian(capture.audioFile, capture.audioBytesWritten, 4);
+}
+
+// runs on the audio thread after all channels and the music are mixed
+void capturePostMix(void* udata, Uint8* stream, int len)
+{
+    captureState* capture = (captureState*) udata;
+    Uint32 written = SDL_AtomicGet(&capture->audioWritten);
+    Uint32 read = SDL_AtomicGet(&capture->audioRead);
+    if (Uint32(len) > captureAudioRingSize - (written - read))
+    {
+        SDL_AtomicAdd(&capture->audioDropped, len);
+        return;
+    }
+    int start = written & (captureAudioRingSize - 1);
+    int first = len < captureAudioRingSize - start ? len : captureAudioRingSize - start;
+    SDL_memcpy(capture->audioRing + start, stream, first);
+    SDL_memcpy(capture->audioRing, stream + first, len - first);
+    SDL_AtomicSet(&capture->audioWritten, written + len);
+}
+
+// move whatever the mixer tap has collected into the WAV file
+void drainCaptureAudio(captureState &capture)
+{
+    if (!capture.audioFile.is_open()) return;
+    Uint32 written = SDL_AtomicGet(&capture.audioWritten);
+    Uint32 read = SDL_AtomicGet(&capture.audioRead);
+    Uint32 available = written - read;
+    if (available == 0) return;
+    int start = read & (captureAudioRingSize - 1);
+    int first = int(available) < captureAudioRingSize - start ? int(available) : captureAudioRingSize - start;
+    capture.audioFile.write((const char*) capture.audioRing + start, first);
+    capture.audioFile.write((const char*) capture.audioRing, available - first);
+    capture.audioBytesWritten += available;
+    SDL_AtomicSet(&capture.audioRead, read + available);
+}
+
+// BT.601 studio range 4:2:0, chroma from the average of each 2x2 block
+void convertToYuv(const Uint8* pixels, Uint8* yuv, const int &width, const int &height)
+{
+    Uint8* planeY = yuv;
+    Uint8* planeU = yuv + width * height;
+    Uint8* planeV = planeU + (width / 2) * (height / 2);
+    for (int y = 0; y < height; y += 2)
+    {
+        for (int x = 0; x < width; x += 2)
+        {
+            int sumR = 0;
+            int sumG = 0;
+            int sumB = 0;
+            for (int dy = 0; dy < 2; dy++)
+            {
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    // ARGB8888 is B, G, R, A in memory on little endian machines
+                    Uint32 pixel = ((const Uint32*) pixels)[(y + dy) * width + x + dx];
+                    int r = (pixel >> 16) & 0xFF;
+                    int g = (pixel >> 8) & 0xFF;
+                    int b = pixel & 0xFF;
+                    planeY[(y + dy) * width + x + dx] = Uint8(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                    sumR += r;
+                    sumG += g;
+                    sumB += b;
+                }
+            }
+            int r = sumR / 4;
+            int g = sumG / 4;
+            int b = sumB / 4;
+            planeU[(y / 2) * (width / 2) + x / 2] = Uint8(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            planeV[(y / 2) * (width / 2) + x / 2] = Uint8(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+int captureWorker(void* data)
+{
+    captureState* capture = (captureState*) data;
+    int frameBytes = capture->width * capture->height * 3 / 2;
+    SDL_LockMutex(capture->lock);
+    while (true)
+    {
+        if (capture->filled == 0)
+        {
+            if (capture->isStopping) break;
+            // wake up now and then even without frames to keep the audio ring from filling
+            SDL_CondWaitTimeout(capture->frameReady, capture->lock, 20);
+            SDL_UnlockMutex(capture->lock);
+            drainCaptureAudio(*capture);
+            SDL_LockMutex(capture->lock);
+            continue;
+        }
+        captureSlot &slot = capture->slots[capture->tail];
+        SDL_UnlockMutex(capture->lock);
+
+        convertToYuv(slot.pixels, capture->yuvBuffer, capture->width, capture->height);
+        for (int i = 0; i < slot.repeat; i++)
+        {
+            capture->videoFile.write("FRAME\n", 6);
+            capture->videoFile.write((const char*) capture->yuvBuffer, frameBytes);
+            capture->framesWritten++;
+        }
+        drainCaptureAudio(*capture);
+
+        SDL_LockMutex(capture->lock);
+        capture->tail = (capture->tail + 1) % captureSlots;
+        capture->filled--;
+    }
+    SDL_UnlockMutex(capture->lock);
+    drainCaptureAudio(*capture);
+    return 0;
+}
+
+void freeCaptureBuffers(captureState &capture)
+{
+    for (int i = 0; i < captureSlots; i++)
+    {
+        if (capture.slots[i].pixels != NULL) SDL_free(capture.slots[i].pixels);
+        capture.slots[i].pixels = NULL;
+    }
+    if (capture.yuvBuffer != NULL) SDL_free(capture.yuvBuffer);
+    if (capture.audioRing != NULL) SDL_free(capture.audioRing);
+    capture.yuvBuffer = NULL;
+    capture.audioRing = NULL;
+    if (capture.frameReady != NULL) SDL_DestroyCond(capture.frameReady);
+    if (capture.lock != NULL) SDL_DestroyMutex(capture.lock);
+    capture.frameReady = NULL;
+    capture.lock = NULL;
+    if (capture.videoFile.is_open()) capture.videoFile.close();
+    if (capture.audioFile.is_open()) capture.audioFile.close();
+}
+
+bool startCapture(captureState &capture, SDL_Renderer* &renderer, const int &fps, const char* videoPath,
+                  const char* audioPath)
+{
+    if (capture.isCapturing) stopCapture(capture);
+    if (SDL_GetRendererOutputSize(renderer, &capture.width, &capture.height) != 0)
+    {
+        logSDLError(std::cout, "Could not get the renderer size for capture", false, SDL_Err);
+        return false;
+    }
+    // 4:2:0 needs even sizes, an odd last row or column is left out
+    capture.width &= ~1;
+    capture.height &= ~1;
+    capture.fps = fps > 0 ? fps : 60;
+    capture.frameTicks = 0;
+    capture.pendingRepeat = 0;
+    capture.head = 0;
+    capture.tail = 0;
+    capture.filled = 0;
+    capture.isStopping = false;
+    capture.framesWritten = 0;
+    capture.framesDropped = 0;
+    capture.audioBytesWritten = 0;
+    SDL_AtomicSet(&capture.audioWritten, 0);
+    SDL_AtomicSet(&capture.audioRead, 0);
+    SDL_AtomicSet(&capture.audioDropped, 0);
+
+    // everything is allocated here once, capturing a frame only copies into it
+    bool isAllocated = true;
+    for (int i = 0; i < captureSlots; i++)
+    {
+        capture.slots[i].pixels = (Uint8*) SDL_malloc(capture.width * capture.height * 4);
+        if (capture.slots[i].pixels == NULL) isAllocated = false;
+    }
+    capture.yuvBuffer = (Uint8*) SDL_malloc(capture.width * capture.height * 3 / 2);
+    capture.audioRing = (Uint8*) SDL_malloc(captureAudioRingSize);
+    capture.lock = SDL_CreateMutex();
+    capture.frameReady = SDL_CreateCond();
+    capture.videoFile.open(videoPath, std::ios::binary);
+    if (!isAllocated || capture.yuvBuffer == NULL || capture.audioRing == NULL || capture.lock == NULL
+        || capture.frameReady == NULL || !capture.videoFile)
+    {
+        logSDLError(std::cout, "Could not set up capture", false, none);
+        freeCaptureBuffers(capture);
+        return false;
+    }
+    capture.videoFile << "YUV4MPEG2 W" << capture.width << " H" << capture.height << " F" << capture.fps << ":1 Ip A1:1 C420jpeg\n";
+
+    // the mixer output goes to the WAV as it is, 16-bit integer or 32-bit float
+    Uint16 format;
+    if (Mix_QuerySpec(&capture.audioFrequency, &format, &capture.audioChannels) != 0
+        && (format == AUDIO_S16LSB || format == AUDIO_F32LSB))
+    {
+        capture.isAudioFloat = format == AUDIO_F32LSB;
+        capture.audioBytesPerSample = capture.isAudioFloat ? 4 : 2;
+        capture.audioFile.open(audioPath, std::ios::binary);
+    }
+    if (capture.audioFile.is_open()) writeWavHeader(capture);
+    else logSDLError(std::cout, "Could not capture audio, recording video only", false, MIX_Err);
+
+    capture.thread = SDL_CreateThread(captureWorker, "captureWorker", &capture);
+    if (capture.thread == NULL)
+    {
+        logSDLError(std::cout, "Could not start capture thread", false, SDL_Err);
+        freeCaptureBuffers(capture);
+        return false;
+    }
+    if (capture.audioFile.is_open()) Mix_SetPostMix(capturePostMix, &capture);
+    capture.startCounter = SDL_GetPerformanceCounter();
+    capture.isCapturing = true;
+    return true;
+}
+
+void captureFrame(captureState &capture, SDL_Renderer* &renderer)
+{
+    if (!capture.isCapturing) return;
+    // the video runs at a fixed rate, a frame stands for every tick since the last one
+    Sint64 ticks = Sint64((SDL_GetPerformanceCounter() - capture.startCounter) * capture.fps / SDL_GetPerformanceFrequency()) + 1;
+    int repeat = int(ticks - capture.frameTicks);
+    if (repeat <= 0) return;
+    capture.frameTicks = ticks;
+
+    SDL_LockMutex(capture.lock);
+    bool isFull = capture.filled == captureSlots;
+    int head = capture.head;
+    SDL_UnlockMutex(capture.lock);
+    if (isFull)
+    {
+        // the worker is behind, skip this one instead of waiting, the next frame covers its time
+        capture.framesDropped++;
+        capture.pendingRepeat += repeat;
+        return;
+    }
+
+    captureSlot &slot = capture.slots[head];
+    SDL_Rect area = {0, 0, capture.width, capture.height};
+    if (SDL_RenderReadPixels(renderer, &area, SDL_PIXELFORMAT_ARGB8888, slot.pixels, capture.width * 4) != 0)
+    {
+        capture.framesDropped++;
+        capture.pendingRepeat += repeat;
+        return;
+    }
+    slot.repeat = repeat + capture.pendingRepeat;
+    capture.pendingRepeat = 0;
+
+    SDL_LockMutex(capture.lock);
+    capture.head = (capture.head + 1) % captureSlots;
+    capture.filled++;
+    SDL_CondSignal(capture.frameReady);
+    SDL_UnlockMutex(capture.lock);
+}
+
+void stopCapture(captureState &capture)
+{
+    if (!capture.isCapturing) return;
+    capture.isCapturing = false;
+    // removing the tap waits for a running mix to finish
+    if (capture.audioFile.is_open()) Mix_SetPostMix(NULL, NULL);
+    SDL_LockMutex(capture.lock);
+    capture.isStopping = true;
+    SDL_CondSignal(capture.frameReady);
+    SDL_UnlockMutex(capture.lock);
+    SDL_WaitThread(capture.thread, NULL);
+    capture.thread = NULL;
+    if (capture.audioFile.is_open()) finishWavHeader(capture);
+
+    std::cout << "Capture: " << capture.framesWritten << " video frames written, " << capture.framesDropped
+              << " dropped (held from the frame before), " << SDL_AtomicGet(&capture.audioDropped)
+              << " audio bytes dropped" << std::endl;
+    freeCaptureBuffers(capture);
+}
+
+#endif // capture_h
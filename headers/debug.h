@@ -0,0 +1,152 @@
+#ifndef debug_h
+#define debug_h
+
+// build with COUNT_ALLOCATIONS defined to count heap allocations made by the main thread during gameplay,
+// steady frames (nothing on the HUD changing) should make none. Without it everything here does nothing.
+#ifdef COUNT_ALLOCATIONS
+#include <new>
+#include <cstdlib>
+
+#if __cplusplus >= 201103L || defined(_MSC_VER)
+    #define NEW_THROWS
+    #define NOEXCEPT noexcept
+#else
+    #define NEW_THROWS throw(std::bad_alloc)
+    #define NOEXCEPT throw()
+#endif
+
+Uint32 allocationCount = 0;
+SDL_threadID allocationThread = 0;
+bool isCountingAllocations = false;
+
+SDL_malloc_func originalMalloc;
+SDL_calloc_func originalCalloc;
+SDL_realloc_func originalRealloc;
+SDL_free_func originalFree;
+
+// audio and loader threads allocate on their own schedule, only the game loop is counted
+void countAllocation()
+{
+    if (isCountingAllocations && SDL_ThreadID() == allocationThread) allocationCount++;
+}
+
+void* SDLCALL countedMalloc(size_t size)
+{
+    countAllocation();
+    return originalMalloc(size);
+}
+
+void* SDLCALL countedCalloc(size_t count, size_t size)
+{
+    countAllocation();
+    return originalCalloc(count, size);
+}
+
+void* SDLCALL countedRealloc(void* memory, size_t size)
+{
+    countAllocation();
+    return originalRealloc(memory, size);
+}
+
+void SDLCALL countedFree(void* memory)
+{
+    originalFree(memory);
+}
+
+void* operator new(std::size_t size) NEW_THROWS
+{
+    countAllocation();
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) NEW_THROWS
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) NOEXCEPT
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) NOEXCEPT
+{
+    std::free(memory);
+}
+#endif // COUNT_ALLOCATIONS
+
+// how many gameplay frames allocated and how much
+struct allocationStats
+{
+    Uint32 frames;
+    Uint32 framesWithAllocations;
+    Uint32 allocations;
+    Uint32 worstFrame;
+    Uint32 frameStart;
+
+    allocationStats();
+};
+
+// call once at the start of main, before SDL allocates anything
+void startAllocationCounter();
+
+void beginFrameAllocations(allocationStats &stats);
+
+void endFrameAllocations(allocationStats &stats);
+
+void logAllocationStats(const allocationStats &stats);
+
+allocationStats::allocationStats()
+{
+    frames = 0;
+    framesWithAllocations = 0;
+    allocations = 0;
+    worstFrame = 0;
+    frameStart = 0;
+}
+
+void startAllocationCounter()
+{
+#ifdef COUNT_ALLOCATIONS
+    SDL_GetMemoryFunctions(&originalMalloc, &originalCalloc, &originalRealloc, &originalFree);
+    SDL_SetMemoryFunctions(countedMalloc, countedCalloc, countedRealloc, countedFree);
+    allocationThread = SDL_ThreadID();
+    isCountingAllocations = true;
+#endif
+}
+
+void beginFrameAllocations(allocationStats &stats)
+{
+#ifdef COUNT_ALLOCATIONS
+    stats.frameStart = allocationCount;
+#else
+    (void) stats;
+#endif
+}
+
+void endFrameAllocations(allocationStats &stats)
+{
+#ifdef COUNT_ALLOCATIONS
+    Uint32 made = allocationCount - stats.frameStart;
+    stats.frames++;
+    stats.allocations += made;
+    if (made > 0) stats.framesWithAllocations++;
+    if (made > stats.worstFrame) stats.worstFrame = made;
+#else
+    (void) stats;
+#endif
+}
+
+void logAllocationStats(const allocationStats &stats)
+{
+#ifdef COUNT_ALLOCATIONS
+    std::cout << "Heap allocations: " << stats.allocations << " in " << stats.framesWithAllocations << " of "
+              << stats.frames << " frames, worst frame " << stats.worstFrame << std::endl;
+#else
+    (void) stats;
+#endif
+}
+
+#endif // debug_h
@@ -0,0 +1,283 @@
+#ifndef difficulty_h
+#define difficulty_h
+
+#include <vector>
+
+// Chart difficulty ratings for the level select screen. Every chart in the catalog is read and
+// hashed at startup on the work pool, charts whose hash is in the cache file keep their cached
+// rating and only new or edited ones are analysed. Browsing the menu only reads the results.
+// Metrics are kept as whole numbers in the units they are shown in, tenths or percent, so the
+// cache reads back exactly what was written.
+const char ratingCacheMagic[] = "ratings";
+// bump when the metrics or the rating change, every cached entry is then worked out again
+const int ratingCacheVersion = 1;
+// notes closer than this to the one before form a chord
+const Uint32 chordWindow = 20;
+// peak density is the most notes in any window this long
+const Uint32 peakWindow = 2000;
+
+struct chartRating
+{
+    bool isRated;
+    Uint64 hash;
+    int speed;
+    int noteCount;
+    // notes per second in tenths, at the densest peakWindow and over the whole chart
+    int peakDensity;
+    int averageDensity;
+    // percent of notes that are part of a chord
+    int chordDensity;
+    // uncertainty of the next lane from the current one, in hundredths of a bit, 0 - 232 for five lanes
+    int laneEntropy;
+    // percent of the chart's length with a hold going on
+    int holdCoverage;
+    // overall, 10 - 100 for 1.0 - 10.0
+    int rating;
+    // the lines the menu shows
+    std::string ratingText;
+    std::string densityText;
+    std::string patternText;
+
+    chartRating();
+};
+
+// work out every metric of a parsed chart, notes sorted by entryTime like the game needs them
+void rateChart(const gameNote* chart, const int &noteCount, const int &speed, chartRating &rating);
+
+// rate every chart in paths into ratings, from cacheFile where it has them, and update cacheFile
+void rateCatalog(const char* const* paths, const int &count, chartRating* ratings, const char* cacheFile);
+
+chartRating::chartRating()
+{
+    isRated = false;
+    hash = 0;
+    speed = 0;
+    noteCount = 0;
+    peakDensity = 0;
+    averageDensity = 0;
+    chordDensity = 0;
+    laneEntropy = 0;
+    holdCoverage = 0;
+    rating = 0;
+}
+
+// "6.4" from 64
+std::string tenthsToString(const int &tenths)
+{
+    return numberToString(Uint32(tenths / 10)) + "." + numberToString(Uint32(tenths % 10));
+}
+
+void describeRating(chartRating &rating)
+{
+    if (!rating.isRated)
+    {
+        rating.ratingText = "Difficulty: -";
+        rating.densityText = "";
+        rating.patternText = "";
+        return;
+    }
+    rating.ratingText = "Difficulty: " + tenthsToString(rating.rating);
+    rating.densityText = "Notes/s: " + tenthsToString(rating.peakDensity) + " peak, " + tenthsToString(rating.averageDensity) + " avg";
+    rating.patternText = "Chords " + numberToString(Uint32(rating.chordDensity)) + "%, holds "
+                         + numberToString(Uint32(rating.holdCoverage)) + "%, speed " + numberToString(Uint32(rating.speed));
+}
+
+void rateChart(const gameNote* chart, const int &noteCount, const int &speed, chartRating &rating)
+{
+    rating.speed = speed;
+    rating.noteCount = noteCount;
+    rating.peakDensity = 0;
+    rating.averageDensity = 0;
+    rating.chordDensity = 0;
+    rating.laneEntropy = 0;
+    rating.holdCoverage = 0;
+    rating.isRated = true;
+    if (noteCount <= 0)
+    {
+        rating.rating = 10;
+        return;
+    }
+
+    Uint32 first = chart[0].entryTime;
+    Uint32 last = first;
+    int peak = 0;
+    int windowStart = 0;
+    int chordNotes = 0;
+    // lane transitions between chords, counted by the first lane of each
+    int transitions[5][5] = {{0}};
+    int previousLane = -1;
+    // union of the hold trails, they are merged as they come since notes are sorted
+    Uint32 holdTime = 0;
+    Uint32 holdStart = 0;
+    Uint32 holdEnd = 0;
+    for (int i = 0; i < noteCount; i++)
+    {
+        const gameNote &note = chart[i];
+        Uint32 end = note.entryTime + note.heldTime;
+        if (end > last) last = end;
+
+        while (note.entryTime - chart[windowStart].entryTime >= peakWindow) windowStart++;
+        if (i - windowStart + 1 > peak) peak = i - windowStart + 1;
+
+        bool isChord = i > 0 && note.entryTime - chart[i - 1].entryTime < chordWindow;
+        bool isNextChord = i + 1 < noteCount && chart[i + 1].entryTime - note.entryTime < chordWindow;
+        if (isChord || isNextChord) chordNotes++;
+        if (!isChord && note.lane >= 0 && note.lane < 5)
+        {
+            if (previousLane != -1) transitions[previousLane][note.lane]++;
+            previousLane = note.lane;
+        }
+
+        if (note.isHeld)
+        {
+            if (note.entryTime > holdEnd)
+            {
+                holdTime += holdEnd - holdStart;
+                holdStart = note.entryTime;
+                holdEnd = end;
+            }
+            else if (end > holdEnd) holdEnd = end;
+        }
+    }
+    holdTime += holdEnd - holdStart;
+
+    Uint32 length = last - first;
+    rating.peakDensity = int(Uint64(peak) * 10000 / peakWindow);
+    rating.averageDensity = length > 0 ? int(Uint64(noteCount) * 10000 / length) : 0;
+    rating.chordDensity = chordNotes * 100 / noteCount;
+    rating.holdCoverage = length > 0 ? int(Uint64(holdTime) * 100 / length) : 0;
+
+    // conditional entropy of the next lane given the current one
+    int total = 0;
+    for (int from = 0; from < 5; from++) for (int to = 0; to < 5; to++) total += transitions[from][to];
+    double entropy = 0;
+    for (int from = 0; from < 5 && total > 0; from++)
+    {
+        int fromTotal = 0;
+        for (int to = 0; to < 5; to++) fromTotal += transitions[from][to];
+        for (int to = 0; to < 5; to++)
+        {
+            if (transitions[from][to] == 0) continue;
+            double joint = double(transitions[from][to]) / total;
+            double next = double(transitions[from][to]) / fromTotal;
+            entropy -= joint * SDL_log(next) / SDL_log(2.0);
+        }
+    }
+    rating.laneEntropy = int(entropy * 100 + 0.5);
+
+    // a plain weighted sum: density matters most, then how much the hand has to move, chords,
+    // holds to keep down while playing the rest, and how fast the gems fall
+    double score = 1 + 0.25 * rating.peakDensity / 10.0 + 0.4 * rating.averageDensity / 10.0 + 0.8 * entropy
+                   + 1.5 * rating.chordDensity / 100.0 + 0.5 * rating.holdCoverage / 100.0 + 0.1 * speed;
+    if (score < 1) score = 1;
+    if (score > 10) score = 10;
+    rating.rating = int(score * 10 + 0.5);
+}
+
+// shared with the workers while the catalog is rated
+struct catalogJob
+{
+    const char* path;
+    chartRating* rating;
+    const std::vector<chartRating>* cached;
+};
+
+std::vector<catalogJob> catalogJobs;
+// one parsed chart per worker, too big for a worker thread's stack
+gameNote (*catalogScratch)[2000] = NULL;
+
+void rateCatalogChart(const int &index, const int &worker)
+{
+    catalogJob &job = catalogJobs[index];
+    chartRating &rating = *job.rating;
+    std::string text;
+    if (!readAssetText(job.path, text)) return;
+    rating.hash = hashChart(text);
+    for (size_t i = 0; i < job.cached->size(); i++)
+    {
+        if ((*job.cached)[i].hash == rating.hash)
+        {
+            rating = (*job.cached)[i];
+            return;
+        }
+    }
+    Uint32 musicStart;
+    int noteCount;
+    Uint32 noMultiplierScore;
+    int speed;
+    if (parseChart(catalogScratch[worker], text, musicStart, noteCount, noMultiplierScore, speed))
+    {
+        rateChart(catalogScratch[worker], noteCount, speed, rating);
+    }
+}
+
+bool readRatingCache(const char* cacheFile, std::vector<chartRating> &cached)
+{
+    std::ifstream inFile(cacheFile);
+    std::string magic;
+    int version;
+    if (!inFile || !(inFile >> magic >> version) || magic != ratingCacheMagic || version != ratingCacheVersion) return false;
+    chartRating rating;
+    while (inFile >> std::hex >> rating.hash >> std::dec >> rating.speed >> rating.noteCount >> rating.peakDensity
+           >> rating.averageDensity >> rating.chordDensity >> rating.laneEntropy >> rating.holdCoverage >> rating.rating)
+    {
+        rating.isRated = true;
+        cached.push_back(rating);
+    }
+    return true;
+}
+
+void writeRatingCache(const char* cacheFile, const chartRating* ratings, const int &count)
+{
+    std::ofstream outFile(cacheFile);
+    if (!outFile)
+    {
+        logSDLError(std::cout, "Could not save the difficulty ratings!", false, none);
+        return;
+    }
+    outFile << ratingCacheMagic << ' ' << ratingCacheVersion << std::endl;
+    for (int i = 0; i < count; i++)
+    {
+        const chartRating &rating = ratings[i];
+        if (!rating.isRated) continue;
+        outFile << std::hex << rating.hash << std::dec << ' ' << rating.speed << ' ' << rating.noteCount << ' '
+                << rating.peakDensity << ' ' << rating.averageDensity << ' ' << rating.chordDensity << ' '
+                << rating.laneEntropy << ' ' << rating.holdCoverage << ' ' << rating.rating << std::endl;
+    }
+}
+
+void rateCatalog(const char* const* paths, const int &count, chartRating* ratings, const char* cacheFile)
+{
+    std::vector<chartRating> cached;
+    readRatingCache(cacheFile, cached);
+
+    workPool pool;
+    startWorkPool(pool);
+    catalogScratch = new gameNote[pool.workerCount][2000];
+    catalogJobs.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        ratings[i] = chartRating();
+        catalogJobs[i].path = paths[i];
+        catalogJobs[i].rating = &ratings[i];
+        catalogJobs[i].cached = &cached;
+    }
+    runParallel(pool, count, rateCatalogChart);
+    delete[] catalogScratch;
+    catalogScratch = NULL;
+    catalogJobs.clear();
+
+    // written again when a rating was missing from it, so stale entries of edited charts go too
+    int rated = 0;
+    int fromCache = 0;
+    for (int i = 0; i < count; i++)
+    {
+        describeRating(ratings[i]);
+        if (!ratings[i].isRated) continue;
+        rated++;
+        for (size_t j = 0; j < cached.size(); j++) if (cached[j].hash == ratings[i].hash) fromCache++;
+    }
+    if (fromCache < rated || int(cached.size()) != rated) writeRatingCache(cacheFile, ratings, count);
+}
+
+#endif // difficulty_h
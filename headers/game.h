@@ -8,10 +8,41 @@ const int SCREEN_WIDTH = 1120;
 const int SCREEN_HEIGHT = 630;
 
 const int hitBox = 68;
+// gem position in the middle of the hit window
+const int perfectY = 594 - hitBox / 2;
+
+// players on one keyboard, see players.h
+const int maxPlayers = 4;
 
 float noteSpeed[10] = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1};
 float starMultiplier[7] = {0.5, 1, 1.5, 2, 2.5, 3, 3.5};
 
+// how gameplay frames are presented
+enum presentModes
+{
+    presentVsync,
+    presentAdaptive,
+    presentUncapped,
+    presentCapped
+};
+
+// file format of the timing telemetry written at the end of a song
+enum timingExports
+{
+    timingExportOff,
+    timingExportCsv,
+    timingExportJson
+};
+
+// result of a key press or release, used for feedback
+enum judgement
+{
+    noJudgement,
+    noteHit,
+    noteMiss,
+    holdRelease
+};
+
 enum lanes
 {
     green,
@@ -37,6 +68,9 @@ struct gameNote
     gameNote();
 };
 
+// gem position on screen at a given level time, negative while above the screen
+int notePositionAt(const Uint32 &entryTime, const Uint32 &time, const int &speed);
+
 struct gameLyrics
 {
     std::string lyricOne;
@@ -62,6 +96,11 @@ gameNote::gameNote()
     released = false;
 }
 
+int notePositionAt(const Uint32 &entryTime, const Uint32 &time, const int &speed)
+{
+    return Sint32(time - entryTime) * noteSpeed[speed] - 99;
+}
+
 gameLyrics::gameLyrics(std::string lyricOne_, std::string lyricTwo_, Uint32 entryTime_)
 {
     lyricOne = lyricOne_;
@@ -0,0 +1,336 @@
+#ifndef hotreload_h
+#define hotreload_h
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+// Authoring mode. A worker watches the level's Chart.txt and Lyrics.txt on disk while it is played,
+// with inotify on Linux and by comparing stat results elsewhere, and parses a file again once it
+// was saved. playLevel takes the parsed data in between frames at the current song time, the song
+// keeps playing. The loose files are read even when an asset pack is loaded, they are what gets edited.
+
+// how often the worker wakes to check for changes without inotify, and to check it was stopped
+const Uint32 reloadPollInterval = 100;
+// editors save in more than one write, a file is parsed once it was left alone this long
+const Uint32 reloadSettleTime = 50;
+
+enum reloadFiles
+{
+    reloadChart,
+    reloadLyrics,
+    reloadFileCount
+};
+
+struct watchedFile
+{
+    std::string path;
+    // stat of the last version seen, for the polling fallback
+    Sint64 modified;
+    Sint64 size;
+    // SDL ticks of the last change not parsed yet, 0 for none
+    Uint32 changedAt;
+};
+
+struct hotReloader
+{
+    SDL_Thread* thread;
+    SDL_mutex* lock;
+    watchedFile files[reloadFileCount];
+    // inotify descriptor and the watch on the level folder, -1 when polling
+    int notify;
+    int watch;
+    // the chart being played, a chart with another speed can not be swapped in while the song plays
+    int speed;
+    Uint64 chartHash;
+
+    // worker side, parsed here before taking the lock
+    gameNote parsedChart[2000];
+    gameLyrics parsedLyrics[150];
+
+    // guarded by lock
+    bool isStopping;
+    bool isChartReady;
+    gameNote chart[2000];
+    int noteCount;
+    Uint32 noMultiplierScore;
+    bool isLyricsReady;
+    gameLyrics lyrics[150];
+    int lyricCount;
+
+    hotReloader();
+};
+
+hotReloader levelReload;
+
+// watch the chart and lyrics of the level being played, chartHash is the chart as it was loaded
+void startHotReload(hotReloader &reloader, const char* chartPath, const char* lyricsPath, const int &speed,
+                    const Uint64 &chartHash);
+
+// copy a chart parsed since the last call into levelChart, false if there is none. Never waits on the worker
+bool takeReloadedChart(hotReloader &reloader, gameNote (&levelChart)[2000], int &noteCount, Uint32 &noMultiplierScore);
+
+// true if lyrics parsed since the last take are waiting, so whatever reads the old ones can be stopped first
+bool hasReloadedLyrics(hotReloader &reloader);
+
+bool takeReloadedLyrics(hotReloader &reloader, gameLyrics (&levelLyrics)[150], int &lyricCount);
+
+void stopHotReload(hotReloader &reloader);
+
+hotReloader::hotReloader()
+{
+    thread = NULL;
+    lock = NULL;
+    notify = -1;
+    watch = -1;
+    speed = 0;
+    chartHash = 0;
+    isStopping = false;
+    isChartReady = false;
+    noteCount = 0;
+    noMultiplierScore = 0;
+    isLyricsReady = false;
+    lyricCount = 0;
+}
+
+// file name after the last slash
+std::string watchedName(const std::string &path)
+{
+    return path.substr(path.find_last_of('/') + 1);
+}
+
+// true if the file's stat changed since it was last seen
+bool statChanged(watchedFile &file)
+{
+    struct stat info;
+    Sint64 modified = -1;
+    Sint64 size = -1;
+    if (stat(file.path.c_str(), &info) == 0)
+    {
+        modified = Sint64(info.st_mtime);
+        size = Sint64(info.st_size);
+    }
+    if (modified == file.modified && size == file.size) return false;
+    file.modified = modified;
+    file.size = size;
+    return true;
+}
+
+// the file on disk with carriage returns dropped, like readAssetText, but never from the pack
+bool readLooseText(const std::string &path, std::string &text)
+{
+    std::ifstream inFile(path.c_str(), std::ios::binary);
+    if (!inFile) return false;
+    std::ostringstream bytes;
+    bytes << inFile.rdbuf();
+    text.clear();
+    const std::string &raw = bytes.str();
+    for (size_t i = 0; i < raw.size(); i++) if (raw[i] != '\r') text += raw[i];
+    return true;
+}
+
+void reparseChart(hotReloader &reloader)
+{
+    std::string text;
+    if (!readLooseText(reloader.files[reloadChart].path, text)) return;
+    Uint64 hash = hashChart(text);
+    // saved without changes
+    if (hash == reloader.chartHash) return;
+    Uint32 musicStart;
+    int noteCount;
+    Uint32 noMultiplierScore;
+    int speed;
+    if (!parseChart(reloader.parsedChart, text, musicStart, noteCount, noMultiplierScore, speed))
+    {
+        logSDLError(std::cout, "Reloaded chart could not be read, keeping the old one", false, none);
+        return;
+    }
+    if (speed != reloader.speed)
+    {
+        // the song start depends on the speed, it only changes when the level is started again
+        logSDLError(std::cout, "Reloaded chart changes the speed, restart the level to use it", false, none);
+        return;
+    }
+    reloader.chartHash = hash;
+    SDL_LockMutex(reloader.lock);
+    for (int i = 0; i <= noteCount; i++) reloader.chart[i] = reloader.parsedChart[i];
+    reloader.noteCount = noteCount;
+    reloader.noMultiplierScore = noMultiplierScore;
+    reloader.isChartReady = true;
+    SDL_UnlockMutex(reloader.lock);
+}
+
+void reparseLyrics(hotReloader &reloader)
+{
+    std::string text;
+    if (!readLooseText(reloader.files[reloadLyrics].path, text)) return;
+    int lyricCount;
+    parseLyrics(reloader.parsedLyrics, text, lyricCount);
+    SDL_LockMutex(reloader.lock);
+    for (int i = 0; i <= lyricCount; i++) reloader.lyrics[i] = reloader.parsedLyrics[i];
+    reloader.lyricCount = lyricCount;
+    reloader.isLyricsReady = true;
+    SDL_UnlockMutex(reloader.lock);
+}
+
+// wait up to reloadPollInterval for a change, marking the files that changed
+void waitForChanges(hotReloader &reloader)
+{
+    Uint32 now;
+#ifdef __linux__
+    if (reloader.notify != -1)
+    {
+        pollfd waiting;
+        waiting.fd = reloader.notify;
+        waiting.events = POLLIN;
+        if (poll(&waiting, 1, reloadPollInterval) <= 0) return;
+        // events are read in place, so the buffer is aligned for them
+        Uint64 events[512];
+        const char* buffer = (const char*) events;
+        ssize_t length = read(reloader.notify, events, sizeof(events));
+        now = SDL_GetTicks() | 1;
+        // editors that save through a new file and a rename show up as IN_MOVED_TO
+        for (ssize_t at = 0; at + ssize_t(sizeof(inotify_event)) <= length;)
+        {
+            const inotify_event* event = (const inotify_event*) (buffer + at);
+            for (int i = 0; i < reloadFileCount && event->len > 0; i++)
+            {
+                if (watchedName(reloader.files[i].path) == event->name) reloader.files[i].changedAt = now;
+            }
+            at += sizeof(inotify_event) + event->len;
+        }
+        return;
+    }
+#endif
+    SDL_Delay(reloadPollInterval);
+    now = SDL_GetTicks() | 1;
+    for (int i = 0; i < reloadFileCount; i++) if (statChanged(reloader.files[i])) reloader.files[i].changedAt = now;
+}
+
+int hotReloadWorker(void* data)
+{
+    hotReloader* reloader = (hotReloader*) data;
+    while (true)
+    {
+        SDL_LockMutex(reloader->lock);
+        bool isStopping = reloader->isStopping;
+        SDL_UnlockMutex(reloader->lock);
+        if (isStopping) break;
+
+        waitForChanges(*reloader);
+        Uint32 now = SDL_GetTicks();
+        for (int i = 0; i < reloadFileCount; i++)
+        {
+            watchedFile &file = reloader->files[i];
+            if (file.changedAt == 0 || !SDL_TICKS_PASSED(now, file.changedAt + reloadSettleTime)) continue;
+            file.changedAt = 0;
+            if (i == reloadChart) reparseChart(*reloader);
+            else reparseLyrics(*reloader);
+        }
+    }
+    return 0;
+}
+
+void startHotReload(hotReloader &reloader, const char* chartPath, const char* lyricsPath, const int &speed,
+                    const Uint64 &chartHash)
+{
+    reloader.files[reloadChart].path = chartPath;
+    reloader.files[reloadLyrics].path = lyricsPath;
+    for (int i = 0; i < reloadFileCount; i++)
+    {
+        reloader.files[i].changedAt = 0;
+        statChanged(reloader.files[i]);
+    }
+    reloader.speed = speed;
+    reloader.chartHash = chartHash;
+    reloader.isStopping = false;
+    reloader.isChartReady = false;
+    reloader.isLyricsReady = false;
+#ifdef __linux__
+    // both files sit in the level folder, one watch on it sees them saved in place or replaced
+    std::string folder = reloader.files[reloadChart].path;
+    folder = folder.substr(0, folder.find_last_of('/'));
+    reloader.notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader.notify != -1)
+    {
+        reloader.watch = inotify_add_watch(reloader.notify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (reloader.watch == -1)
+        {
+            close(reloader.notify);
+            reloader.notify = -1;
+        }
+    }
+    if (reloader.notify == -1) logSDLError(std::cout, "Could not watch the level folder, polling it instead", false, none);
+#endif
+
+    reloader.lock = SDL_CreateMutex();
+    if (reloader.lock != NULL) reloader.thread = SDL_CreateThread(hotReloadWorker, "hotReload", &reloader);
+    if (reloader.thread == NULL)
+    {
+        logSDLError(std::cout, "Could not start the chart watcher, edits are not reloaded", false, SDL_Err);
+    }
+}
+
+bool takeReloadedChart(hotReloader &reloader, gameNote (&levelChart)[2000], int &noteCount, Uint32 &noMultiplierScore)
+{
+    // the worker only holds the lock to copy, if it has it now the chart is taken next frame
+    if (reloader.thread == NULL || SDL_TryLockMutex(reloader.lock) != 0) return false;
+    bool isReady = reloader.isChartReady;
+    if (isReady)
+    {
+        // the end marker after the last note comes along
+        for (int i = 0; i <= reloader.noteCount; i++) levelChart[i] = reloader.chart[i];
+        noteCount = reloader.noteCount;
+        noMultiplierScore = reloader.noMultiplierScore;
+        reloader.isChartReady = false;
+    }
+    SDL_UnlockMutex(reloader.lock);
+    return isReady;
+}
+
+bool hasReloadedLyrics(hotReloader &reloader)
+{
+    if (reloader.thread == NULL || SDL_TryLockMutex(reloader.lock) != 0) return false;
+    bool isReady = reloader.isLyricsReady;
+    SDL_UnlockMutex(reloader.lock);
+    return isReady;
+}
+
+bool takeReloadedLyrics(hotReloader &reloader, gameLyrics (&levelLyrics)[150], int &lyricCount)
+{
+    if (reloader.thread == NULL || SDL_TryLockMutex(reloader.lock) != 0) return false;
+    bool isReady = reloader.isLyricsReady;
+    if (isReady)
+    {
+        for (int i = 0; i <= reloader.lyricCount; i++) levelLyrics[i] = reloader.lyrics[i];
+        lyricCount = reloader.lyricCount;
+        reloader.isLyricsReady = false;
+    }
+    SDL_UnlockMutex(reloader.lock);
+    return isReady;
+}
+
+void stopHotReload(hotReloader &reloader)
+{
+    if (reloader.thread != NULL)
+    {
+        SDL_LockMutex(reloader.lock);
+        reloader.isStopping = true;
+        SDL_UnlockMutex(reloader.lock);
+        SDL_WaitThread(reloader.thread, NULL);
+        reloader.thread = NULL;
+    }
+    if (reloader.lock != NULL) SDL_DestroyMutex(reloader.lock);
+    reloader.lock = NULL;
+#ifdef __linux__
+    if (reloader.notify != -1) close(reloader.notify);
+#endif
+    reloader.notify = -1;
+    reloader.watch = -1;
+}
+
+#endif // hotreload_h
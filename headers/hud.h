@@ -0,0 +1,103 @@
+#ifndef hud_h
+#define hud_h
+
+// text drawn every frame whose texture is kept until what it shows changes
+struct cachedText
+{
+    textureE texture;
+    // what the texture was rendered from, a counter value or a lyric index
+    Uint32 key;
+    bool isRendered;
+    const char* prefix;
+
+    // position on screen, kept here since textureE::free resets the texture's
+    int posX;
+    int posY;
+
+    cachedText(int posX_, int posY_, const char* prefix_ = "");
+};
+
+// draw a number, formatted on the stack and only rendered again when value changes
+void renderCounter(cachedText &text, const Uint32 &value, const SDL_Color &textColor, sdfFont &font,
+                   const int &fontSize, SDL_Renderer* &renderer);
+
+// draw a line of text, only rendered again when key changes
+void renderCachedText(cachedText &text, const Uint32 &key, const std::string &line, const SDL_Color &textColor,
+                      sdfFont &font, const int &fontSize, SDL_Renderer* &renderer);
+
+// draw the resource registry's totals, rendered again when the total moves by a KB
+void renderResourceTotals(cachedText &text, const SDL_Color &textColor, sdfFont &font, const int &fontSize,
+                          SDL_Renderer* &renderer);
+
+void freeCachedText(cachedText &text);
+
+cachedText::cachedText(int posX_, int posY_, const char* prefix_)
+{
+    key = 0;
+    isRendered = false;
+    prefix = prefix_;
+    posX = posX_;
+    posY = posY_;
+}
+
+void renderCounter(cachedText &text, const Uint32 &value, const SDL_Color &textColor, sdfFont &font,
+                   const int &fontSize, SDL_Renderer* &renderer)
+{
+    if (!text.isRendered || text.key != value)
+    {
+        // prefix plus at most 10 digits
+        char buffer[32];
+        int length = 0;
+        while (text.prefix[length] != 0 && length < 20)
+        {
+            buffer[length] = text.prefix[length];
+            length++;
+        }
+        formatNumber(buffer + length, value);
+        loadSdfText(text.texture, buffer, textColor, font, fontSize, renderer);
+        text.key = value;
+        text.isRendered = true;
+    }
+    text.texture.posX = text.posX;
+    text.texture.posY = text.posY;
+    queueSprite(gameplayQueue, layerText, renderer, text.texture);
+}
+
+void renderCachedText(cachedText &text, const Uint32 &key, const std::string &line, const SDL_Color &textColor,
+                      sdfFont &font, const int &fontSize, SDL_Renderer* &renderer)
+{
+    if (!text.isRendered || text.key != key)
+    {
+        loadSdfText(text.texture, line.c_str(), textColor, font, fontSize, renderer);
+        text.key = key;
+        text.isRendered = true;
+    }
+    text.texture.posX = text.posX;
+    text.texture.posY = text.posY;
+    queueSprite(gameplayQueue, layerText, renderer, text.texture);
+}
+
+void renderResourceTotals(cachedText &text, const SDL_Color &textColor, sdfFont &font, const int &fontSize,
+                          SDL_Renderer* &renderer)
+{
+    Uint32 totalKb = Uint32(totalResourceBytes() / 1024);
+    if (!text.isRendered || text.key != totalKb)
+    {
+        char buffer[160];
+        formatResourceTotals(buffer, sizeof(buffer));
+        loadSdfText(text.texture, buffer, textColor, font, fontSize, renderer);
+        text.key = totalKb;
+        text.isRendered = true;
+    }
+    text.texture.posX = text.posX;
+    text.texture.posY = text.posY;
+    queueSprite(gameplayQueue, layerText, renderer, text.texture);
+}
+
+void freeCachedText(cachedText &text)
+{
+    if (text.isRendered) text.texture.free();
+    text.isRendered = false;
+}
+
+#endif // hud_h
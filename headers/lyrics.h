@@ -0,0 +1,339 @@
+#ifndef lyrics_h
+#define lyrics_h
+
+// how many lyric lines the worker rasterizes ahead of the one on screen
+const int lyricLookAhead = 4;
+
+const int lyricPosX = 480;
+const int lyricLineOneY = 100;
+const int lyricLineTwoY = 150;
+
+// surfaces of one lyric, rasterized by the worker and waiting for upload
+struct preparedLyric
+{
+    int index;
+    bool isReady;
+    SDL_Surface* lineOne;
+    SDL_Surface* lineTwo;
+
+    preparedLyric();
+};
+
+// rasterizes upcoming lyrics on a worker thread so a new line on screen only costs a texture upload
+struct lyricPipeline
+{
+    SDL_Thread* thread;
+    SDL_mutex* lock;
+    // signalled when a slot frees up or the pipeline stops
+    SDL_cond* slotFreed;
+    // the atlas is only read, so the worker and the render thread can share it
+    const sdfFont* font;
+    int fontSize;
+    SDL_Color color;
+    const gameLyrics* lyrics;
+    int lyricCount;
+    // every line laid out once when the pipeline starts, two per lyric, empty for blank lines
+    std::vector<sdfRun> runs;
+
+    // guarded by lock
+    int nextLyric;
+    int shownLyric;
+    // bumped by a seek, lines the worker was busy with before it are dropped
+    int generation;
+    bool isStopping;
+    preparedLyric slots[lyricLookAhead];
+
+    // only touched by the render thread
+    textureE lineOne;
+    textureE lineTwo;
+
+    lyricPipeline();
+};
+
+// read a lyrics file's text, a time and a line count, then that many lines, per lyric
+void parseLyrics(gameLyrics (&levelLyrics)[150], const std::string &text, int &lyricCount);
+
+// cache the glyphs and lay out every line, then start rasterizing from the first lyric. lyrics and
+// font must stay alive until stopLyricPipeline
+void startLyricPipeline(lyricPipeline &pipeline, const gameLyrics* lyrics, const int &lyricCount, sdfFont &font,
+                        const int &fontSize, const SDL_Color &color);
+
+// make lyric index the one on screen, uploads its prepared surfaces or rasterizes it here if the worker fell behind
+void showLyric(lyricPipeline &pipeline, const int &index, SDL_Renderer* &renderer);
+
+// one blit per line of the lyric on screen
+void renderLyric(lyricPipeline &pipeline, SDL_Renderer* &renderer);
+
+// restart preparing from lyric index after the song jumped, nothing is on screen until the next showLyric
+void seekLyricPipeline(lyricPipeline &pipeline, const int &index);
+
+void stopLyricPipeline(lyricPipeline &pipeline);
+
+preparedLyric::preparedLyric()
+{
+    index = -1;
+    isReady = false;
+    lineOne = NULL;
+    lineTwo = NULL;
+}
+
+lyricPipeline::lyricPipeline()
+{
+    thread = NULL;
+    lock = NULL;
+    slotFreed = NULL;
+    font = NULL;
+    fontSize = 0;
+    lyrics = NULL;
+    lyricCount = 0;
+    nextLyric = 0;
+    shownLyric = -1;
+    generation = 0;
+    isStopping = false;
+}
+
+void parseLyrics(gameLyrics (&levelLyrics)[150], const std::string &text, int &lyricCount)
+{
+    // editors on Windows start UTF-8 files with a byte order mark
+    std::istringstream inFile(text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? text.substr(3) : text);
+    int currentLyric = 0;
+    // the last slot holds the end marker
+    while (!inFile.eof() && currentLyric < 149)
+    {
+        Uint32 entryTime_;
+        std::string lyric_;
+        int numberOfLines;
+        inFile >> entryTime_ >> numberOfLines;
+        if (numberOfLines == 1) levelLyrics[currentLyric].lyricTwo = " ";
+        for (int i = 1; i <= numberOfLines; i++)
+        {
+            getline(inFile, lyric_);
+            if (i == 1)
+            {
+                levelLyrics[currentLyric].lyricOne = lyric_;
+            }
+            if (i == 2)
+            {
+                levelLyrics[currentLyric].lyricTwo = lyric_;
+            }
+        }
+        levelLyrics[currentLyric].entryTime = entryTime_;
+        currentLyric++;
+    }
+    lyricCount = currentLyric;
+    levelLyrics[currentLyric].entryTime = 100000000;
+    levelLyrics[currentLyric].lyricOne = "default text";
+    levelLyrics[currentLyric].lyricTwo = "default text";
+}
+
+// lines loaded as " " are the empty second line of a one line lyric
+bool isBlankLyric(const std::string &line)
+{
+    return line.empty() || line == " ";
+}
+
+// line is 0 or 1 of lyric index, NULL for a blank line
+SDL_Surface* rasterizeLyric(const lyricPipeline &pipeline, const int &index, const int &line)
+{
+    return renderSdfRun(pipeline.runs[index * 2 + line], *pipeline.font, pipeline.fontSize, pipeline.color);
+}
+
+void freePreparedLyric(preparedLyric &slot)
+{
+    if (slot.lineOne != NULL) SDL_FreeSurface(slot.lineOne);
+    if (slot.lineTwo != NULL) SDL_FreeSurface(slot.lineTwo);
+    slot.lineOne = NULL;
+    slot.lineTwo = NULL;
+    slot.index = -1;
+    slot.isReady = false;
+}
+
+void freeLyricLine(textureE &line)
+{
+    line.free();
+}
+
+int lyricWorker(void* data)
+{
+    lyricPipeline* pipeline = (lyricPipeline*) data;
+    SDL_LockMutex(pipeline->lock);
+    while (!pipeline->isStopping)
+    {
+        int index = pipeline->nextLyric;
+        if (index >= pipeline->lyricCount || pipeline->slots[index % lyricLookAhead].isReady)
+        {
+            SDL_CondWait(pipeline->slotFreed, pipeline->lock);
+            continue;
+        }
+        pipeline->nextLyric++;
+        int generation = pipeline->generation;
+        SDL_UnlockMutex(pipeline->lock);
+
+        // the slow part, done without holding the lock
+        SDL_Surface* lineOne = rasterizeLyric(*pipeline, index, 0);
+        SDL_Surface* lineTwo = rasterizeLyric(*pipeline, index, 1);
+
+        SDL_LockMutex(pipeline->lock);
+        preparedLyric &slot = pipeline->slots[index % lyricLookAhead];
+        if (index <= pipeline->shownLyric || generation != pipeline->generation)
+        {
+            // already on screen (rasterized by the render thread while this one was busy) or seeked away from
+            if (lineOne != NULL) SDL_FreeSurface(lineOne);
+            if (lineTwo != NULL) SDL_FreeSurface(lineTwo);
+            continue;
+        }
+        slot.index = index;
+        slot.lineOne = lineOne;
+        slot.lineTwo = lineTwo;
+        slot.isReady = true;
+    }
+    SDL_UnlockMutex(pipeline->lock);
+    return 0;
+}
+
+void startLyricPipeline(lyricPipeline &pipeline, const gameLyrics* lyrics, const int &lyricCount, sdfFont &font,
+                        const int &fontSize, const SDL_Color &color)
+{
+    // glyphs past ASCII are added here on the render thread, the worker and showLyric only draw runs
+    pipeline.runs.assign(lyricCount > 0 ? lyricCount * 2 : 0, sdfRun());
+    for (int i = 0; i < lyricCount; i++)
+    {
+        const std::string* lines[2] = {&lyrics[i].lyricOne, &lyrics[i].lyricTwo};
+        for (int line = 0; line < 2; line++)
+        {
+            if (isBlankLyric(*lines[line])) continue;
+            cacheSdfGlyphs(font, lines[line]->c_str());
+            layoutSdfRun(font, lines[line]->c_str(), pipeline.runs[i * 2 + line]);
+        }
+    }
+    pipeline.lyrics = lyrics;
+    pipeline.lyricCount = lyricCount;
+    pipeline.font = &font;
+    pipeline.fontSize = fontSize;
+    pipeline.color = color;
+    pipeline.nextLyric = 0;
+    pipeline.shownLyric = -1;
+    pipeline.isStopping = false;
+    if (lyricCount <= 0) return;
+
+    pipeline.lock = SDL_CreateMutex();
+    pipeline.slotFreed = SDL_CreateCond();
+    if (pipeline.lock != NULL && pipeline.slotFreed != NULL)
+    {
+        pipeline.thread = SDL_CreateThread(lyricWorker, "lyricWorker", &pipeline);
+    }
+    if (pipeline.thread == NULL)
+    {
+        logSDLError(std::cout, "Could not start lyric worker, lyrics are rendered in place", false, SDL_Err);
+    }
+}
+
+void showLyric(lyricPipeline &pipeline, const int &index, SDL_Renderer* &renderer)
+{
+    if (index == pipeline.shownLyric) return;
+
+    preparedLyric taken;
+    if (pipeline.thread != NULL)
+    {
+        SDL_LockMutex(pipeline.lock);
+        pipeline.shownLyric = index;
+        // nothing before this line is needed anymore, including lyrics the worker has not reached yet
+        if (pipeline.nextLyric <= index) pipeline.nextLyric = index + 1;
+        for (int i = 0; i < lyricLookAhead; i++)
+        {
+            preparedLyric &slot = pipeline.slots[i];
+            if (!slot.isReady) continue;
+            if (slot.index == index)
+            {
+                taken = slot;
+                slot = preparedLyric();
+            }
+            else if (slot.index < index) freePreparedLyric(slot);
+        }
+        SDL_CondSignal(pipeline.slotFreed);
+        SDL_UnlockMutex(pipeline.lock);
+    }
+    else pipeline.shownLyric = index;
+
+    freeLyricLine(pipeline.lineOne);
+    freeLyricLine(pipeline.lineTwo);
+    if (taken.isReady)
+    {
+        if (taken.lineOne != NULL) pipeline.lineOne.loadFromSurface(taken.lineOne, renderer);
+        if (taken.lineTwo != NULL) pipeline.lineTwo.loadFromSurface(taken.lineTwo, renderer);
+        freePreparedLyric(taken);
+    }
+    else if (index >= 0 && index < pipeline.lyricCount)
+    {
+        // the worker fell behind (or is not running), rasterize it now like before
+        SDL_Surface* lineOne = rasterizeLyric(pipeline, index, 0);
+        SDL_Surface* lineTwo = rasterizeLyric(pipeline, index, 1);
+        if (lineOne != NULL)
+        {
+            pipeline.lineOne.loadFromSurface(lineOne, renderer);
+            SDL_FreeSurface(lineOne);
+        }
+        if (lineTwo != NULL)
+        {
+            pipeline.lineTwo.loadFromSurface(lineTwo, renderer);
+            SDL_FreeSurface(lineTwo);
+        }
+    }
+}
+
+void renderLyric(lyricPipeline &pipeline, SDL_Renderer* &renderer)
+{
+    if (pipeline.lineOne.texture != NULL)
+    {
+        pipeline.lineOne.posX = lyricPosX;
+        pipeline.lineOne.posY = lyricLineOneY;
+        queueSprite(gameplayQueue, layerText, renderer, pipeline.lineOne);
+    }
+    if (pipeline.lineTwo.texture != NULL)
+    {
+        pipeline.lineTwo.posX = lyricPosX;
+        pipeline.lineTwo.posY = lyricLineTwoY;
+        queueSprite(gameplayQueue, layerText, renderer, pipeline.lineTwo);
+    }
+}
+
+void seekLyricPipeline(lyricPipeline &pipeline, const int &index)
+{
+    if (pipeline.thread != NULL)
+    {
+        SDL_LockMutex(pipeline.lock);
+        for (int i = 0; i < lyricLookAhead; i++) freePreparedLyric(pipeline.slots[i]);
+        pipeline.nextLyric = index < 0 ? 0 : index;
+        pipeline.shownLyric = -1;
+        pipeline.generation++;
+        SDL_CondSignal(pipeline.slotFreed);
+        SDL_UnlockMutex(pipeline.lock);
+    }
+    else pipeline.shownLyric = -1;
+    freeLyricLine(pipeline.lineOne);
+    freeLyricLine(pipeline.lineTwo);
+}
+
+void stopLyricPipeline(lyricPipeline &pipeline)
+{
+    if (pipeline.thread != NULL)
+    {
+        SDL_LockMutex(pipeline.lock);
+        pipeline.isStopping = true;
+        SDL_CondSignal(pipeline.slotFreed);
+        SDL_UnlockMutex(pipeline.lock);
+        SDL_WaitThread(pipeline.thread, NULL);
+        pipeline.thread = NULL;
+    }
+    for (int i = 0; i < lyricLookAhead; i++) freePreparedLyric(pipeline.slots[i]);
+    if (pipeline.slotFreed != NULL) SDL_DestroyCond(pipeline.slotFreed);
+    if (pipeline.lock != NULL) SDL_DestroyMutex(pipeline.lock);
+    pipeline.slotFreed = NULL;
+    pipeline.lock = NULL;
+    freeLyricLine(pipeline.lineOne);
+    freeLyricLine(pipeline.lineTwo);
+    pipeline.shownLyric = -1;
+    pipeline.runs.clear();
+}
+
+#endif // lyrics_h
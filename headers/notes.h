@@ -0,0 +1,254 @@
+#ifndef notes_h
+#define notes_h
+
+// notes currently on the highway, stored as one array per field so the per frame
+// update can run over them in SIMD batches before anything is drawn
+const int maxActiveNotes = 256;
+
+// flags are 0 or -1 (all bits set) so a vector compare result can be stored straight into them
+const Sint32 flagSet = -1;
+
+struct activeNotes
+{
+    int count;
+
+    // hot fields, read or written by updateNotes() every frame
+    Sint32 entryTime[maxActiveNotes];
+    Sint32 posY[maxActiveNotes];
+    Sint32 heldLength[maxActiveNotes];
+    // render time where a hold trail ends, judge time after which an unpressed note is missed
+    Sint32 holdEndTime[maxActiveNotes];
+    Sint32 missTime[maxActiveNotes];
+    Sint32 isHeld[maxActiveNotes];
+    Sint32 pressed[maxActiveNotes];
+    Sint32 heldEndCheck[maxActiveNotes];
+    Uint8 lane[maxActiveNotes];
+
+    // cold fields, only touched when a key goes down or up
+    Uint32 heldTime[maxActiveNotes];
+    Uint32 heldStartTime[maxActiveNotes];
+    bool released[maxActiveNotes];
+
+    activeNotes();
+};
+
+// copy a chart note onto the highway, false if it is full
+bool addNote(activeNotes &notes, const gameNote &note, const int &speed);
+
+// remove one note, keeping the rest in order
+void removeNote(activeNotes &notes, const int &index);
+
+// drop every note, used when the chart cursor seeks
+void clearNotes(activeNotes &notes);
+
+// move every note to its position at renderTime, fix the length of trails that ended, drop notes
+// that left the screen at both renderTime and judgeTime and report whether an unpressed note went
+// past the hit window at judgeTime
+void updateNotes(activeNotes &notes, const double &preciseRenderTime, const Uint32 &renderTime,
+                 const Uint32 &judgeTime, const int &speed, bool &isMissed);
+
+activeNotes::activeNotes()
+{
+    count = 0;
+}
+
+bool addNote(activeNotes &notes, const gameNote &note, const int &speed)
+{
+    if (notes.count >= maxActiveNotes) return false;
+    int i = notes.count;
+    notes.entryTime[i] = note.entryTime;
+    notes.posY[i] = note.currentPosY;
+    notes.heldLength[i] = note.heldLength;
+    notes.holdEndTime[i] = note.entryTime + note.heldTime;
+    // notePositionAt() passes 594 once the gem has travelled 594 + 1 + 99 pixels
+    notes.missTime[i] = note.entryTime + Sint32(SDL_ceil(694 / noteSpeed[speed]));
+    notes.isHeld[i] = note.isHeld ? flagSet : 0;
+    notes.pressed[i] = note.pressed ? flagSet : 0;
+    notes.heldEndCheck[i] = note.heldEndCheck ? flagSet : 0;
+    notes.lane[i] = note.lane;
+    notes.heldTime[i] = note.heldTime;
+    notes.heldStartTime[i] = note.heldStartTime;
+    notes.released[i] = note.released;
+    notes.count++;
+    return true;
+}
+
+void moveNote(activeNotes &notes, const int &from, const int &to)
+{
+    notes.entryTime[to] = notes.entryTime[from];
+    notes.posY[to] = notes.posY[from];
+    notes.heldLength[to] = notes.heldLength[from];
+    notes.holdEndTime[to] = notes.holdEndTime[from];
+    notes.missTime[to] = notes.missTime[from];
+    notes.isHeld[to] = notes.isHeld[from];
+    notes.pressed[to] = notes.pressed[from];
+    notes.heldEndCheck[to] = notes.heldEndCheck[from];
+    notes.lane[to] = notes.lane[from];
+    notes.heldTime[to] = notes.heldTime[from];
+    notes.heldStartTime[to] = notes.heldStartTime[from];
+    notes.released[to] = notes.released[from];
+}
+
+void removeNote(activeNotes &notes, const int &index)
+{
+    for (int i = index + 1; i < notes.count; i++) moveNote(notes, i, i - 1);
+    notes.count--;
+}
+
+// drop every note, for seeks and restarts
+void clearNotes(activeNotes &notes)
+{
+    notes.count = 0;
+}
+
+// stable compaction of notes whose gem, or trail end, is below bottom
+void compactNotes(activeNotes &notes, const Sint32 &bottom)
+{
+    int kept = 0;
+    for (int i = 0; i < notes.count; i++)
+    {
+        if (notes.posY[i] - notes.heldLength[i] > bottom) continue;
+        if (kept != i) moveNote(notes, i, kept);
+        kept++;
+    }
+    notes.count = kept;
+}
+
+// wrapping difference of two level times, like SDL_TICKS_PASSED
+Sint32 timeDifference(const Sint32 &a, const Sint32 &b)
+{
+    return Sint32(Uint32(a) - Uint32(b));
+}
+
+void updateNotesScalar(activeNotes &notes, int i, const float &time, const float &speed, const Sint32 &renderTime,
+                       const Sint32 &judgeTime, const Sint32 &bottom, bool &isMissed, bool &isExpired)
+{
+    for (; i < notes.count; i++)
+    {
+        notes.posY[i] = Sint32(SDL_floorf((time - float(notes.entryTime[i])) * speed - 98.5f));
+        if (notes.isHeld[i] && !notes.heldEndCheck[i] && timeDifference(notes.holdEndTime[i], renderTime) <= 0)
+        {
+            notes.heldLength[i] = notes.posY[i];
+            notes.heldEndCheck[i] = flagSet;
+        }
+        if (!notes.pressed[i] && timeDifference(notes.missTime[i], judgeTime) <= 0) isMissed = true;
+        if (notes.posY[i] - notes.heldLength[i] > bottom) isExpired = true;
+    }
+}
+
+#ifdef SIMD_X86
+// same as the scalar loop four notes at a time, returns the index where the scalar tail starts
+TARGET_SSE2 int updateNotesSSE2(activeNotes &notes, const float &time, const float &speed, const Sint32 &renderTime,
+                                const Sint32 &judgeTime, const Sint32 &bottom, bool &isMissed, bool &isExpired)
+{
+    const __m128 vTime = _mm_set1_ps(time);
+    const __m128 vSpeed = _mm_set1_ps(speed);
+    const __m128 vOffset = _mm_set1_ps(-98.5f);
+    const __m128i vRender = _mm_set1_epi32(renderTime);
+    const __m128i vJudge = _mm_set1_epi32(judgeTime);
+    const __m128i vOne = _mm_set1_epi32(1);
+    const __m128i vBottom = _mm_set1_epi32(bottom);
+    __m128i missed = _mm_setzero_si128();
+    __m128i expired = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= notes.count; i += 4)
+    {
+        __m128 entry = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (notes.entryTime + i)));
+        __m128 y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(vTime, entry), vSpeed), vOffset);
+        // SSE2 has no floor: truncation rounds negatives up, so take one off where that happened
+        __m128i truncated = _mm_cvttps_epi32(y);
+        __m128i posY = _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmplt_ps(y, _mm_cvtepi32_ps(truncated))));
+        _mm_storeu_si128((__m128i*) (notes.posY + i), posY);
+
+        __m128i isHeld = _mm_loadu_si128((const __m128i*) (notes.isHeld + i));
+        __m128i endChecked = _mm_loadu_si128((const __m128i*) (notes.heldEndCheck + i));
+        __m128i holdEnd = _mm_loadu_si128((const __m128i*) (notes.holdEndTime + i));
+        __m128i endPassed = _mm_cmplt_epi32(_mm_sub_epi32(holdEnd, vRender), vOne);
+        __m128i endNow = _mm_andnot_si128(endChecked, _mm_and_si128(isHeld, endPassed));
+        __m128i heldLength = _mm_loadu_si128((const __m128i*) (notes.heldLength + i));
+        heldLength = _mm_or_si128(_mm_and_si128(endNow, posY), _mm_andnot_si128(endNow, heldLength));
+        _mm_storeu_si128((__m128i*) (notes.heldLength + i), heldLength);
+        _mm_storeu_si128((__m128i*) (notes.heldEndCheck + i), _mm_or_si128(endChecked, endNow));
+
+        __m128i pressed = _mm_loadu_si128((const __m128i*) (notes.pressed + i));
+        __m128i missTime = _mm_loadu_si128((const __m128i*) (notes.missTime + i));
+        __m128i missPassed = _mm_cmplt_epi32(_mm_sub_epi32(missTime, vJudge), vOne);
+        missed = _mm_or_si128(missed, _mm_andnot_si128(pressed, missPassed));
+        expired = _mm_or_si128(expired, _mm_cmpgt_epi32(_mm_sub_epi32(posY, heldLength), vBottom));
+    }
+    if (_mm_movemask_epi8(missed)) isMissed = true;
+    if (_mm_movemask_epi8(expired)) isExpired = true;
+    return i;
+}
+
+TARGET_AVX2 int updateNotesAVX2(activeNotes &notes, const float &time, const float &speed, const Sint32 &renderTime,
+                                const Sint32 &judgeTime, const Sint32 &bottom, bool &isMissed, bool &isExpired)
+{
+    const __m256 vTime = _mm256_set1_ps(time);
+    const __m256 vSpeed = _mm256_set1_ps(speed);
+    const __m256 vOffset = _mm256_set1_ps(-98.5f);
+    const __m256i vRender = _mm256_set1_epi32(renderTime);
+    const __m256i vJudge = _mm256_set1_epi32(judgeTime);
+    const __m256i vOne = _mm256_set1_epi32(1);
+    const __m256i vBottom = _mm256_set1_epi32(bottom);
+    __m256i missed = _mm256_setzero_si256();
+    __m256i expired = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= notes.count; i += 8)
+    {
+        __m256 entry = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (notes.entryTime + i)));
+        __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(vTime, entry), vSpeed), vOffset);
+        __m256i posY = _mm256_cvttps_epi32(_mm256_floor_ps(y));
+        _mm256_storeu_si256((__m256i*) (notes.posY + i), posY);
+
+        __m256i isHeld = _mm256_loadu_si256((const __m256i*) (notes.isHeld + i));
+        __m256i endChecked = _mm256_loadu_si256((const __m256i*) (notes.heldEndCheck + i));
+        __m256i holdEnd = _mm256_loadu_si256((const __m256i*) (notes.holdEndTime + i));
+        __m256i endPassed = _mm256_cmpgt_epi32(vOne, _mm256_sub_epi32(holdEnd, vRender));
+        __m256i endNow = _mm256_andnot_si256(endChecked, _mm256_and_si256(isHeld, endPassed));
+        __m256i heldLength = _mm256_loadu_si256((const __m256i*) (notes.heldLength + i));
+        heldLength = _mm256_blendv_epi8(heldLength, posY, endNow);
+        _mm256_storeu_si256((__m256i*) (notes.heldLength + i), heldLength);
+        _mm256_storeu_si256((__m256i*) (notes.heldEndCheck + i), _mm256_or_si256(endChecked, endNow));
+
+        __m256i pressed = _mm256_loadu_si256((const __m256i*) (notes.pressed + i));
+        __m256i missTime = _mm256_loadu_si256((const __m256i*) (notes.missTime + i));
+        __m256i missPassed = _mm256_cmpgt_epi32(vOne, _mm256_sub_epi32(missTime, vJudge));
+        missed = _mm256_or_si256(missed, _mm256_andnot_si256(pressed, missPassed));
+        expired = _mm256_or_si256(expired, _mm256_cmpgt_epi32(_mm256_sub_epi32(posY, heldLength), vBottom));
+    }
+    if (_mm256_movemask_epi8(missed)) isMissed = true;
+    if (_mm256_movemask_epi8(expired)) isExpired = true;
+    return i;
+}
+#endif
+
+void updateNotes(activeNotes &notes, const double &preciseRenderTime, const Uint32 &renderTime,
+                 const Uint32 &judgeTime, const int &speed, bool &isMissed)
+{
+    float time = float(preciseRenderTime);
+    float speedPerMs = noteSpeed[speed];
+    // a positive visual offset draws gems ahead of where they are judged, keep them until their judged
+    // position has left the screen too so they can still be hit and missed
+    Sint32 visualLead = timeDifference(renderTime, judgeTime);
+    Sint32 bottom = SCREEN_HEIGHT;
+    if (visualLead > 0) bottom += Sint32(SDL_ceil(visualLead * speedPerMs));
+    bool isExpired = false;
+    isMissed = false;
+    int i = 0;
+#ifdef SIMD_X86
+    switch (detectSimd())
+    {
+        case simdAVX2:
+            i = updateNotesAVX2(notes, time, speedPerMs, renderTime, judgeTime, bottom, isMissed, isExpired);
+            break;
+        case simdSSE2:
+            i = updateNotesSSE2(notes, time, speedPerMs, renderTime, judgeTime, bottom, isMissed, isExpired);
+            break;
+    }
+#endif
+    updateNotesScalar(notes, i, time, speedPerMs, renderTime, judgeTime, bottom, isMissed, isExpired);
+    if (isExpired) compactNotes(notes, bottom);
+}
+
+#endif // notes_h
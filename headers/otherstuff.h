@@ -1,20 +1,41 @@
 #ifndef other_stuff_h
 #define other_stuff_h
 
+// writes the digits of number and a terminating zero into buffer (at least 11 chars), returns the length
+int formatNumber (char* buffer, const Uint32 &number);
+
 std::string numberToString (const Uint32 &number);
 
-std::string numberToString (const Uint32 &number)
+std::string signedToString (const int &number);
+
+int formatNumber (char* buffer, const Uint32 &number)
 {
-    std::string s;
-    if (number == 0) return "0";
-    int number1 = number;
-    while (number1 != 0)
+    // digits come out last first, collect them backwards then copy forward
+    char digits[10];
+    int length = 0;
+    Uint32 number1 = number;
+    do
     {
-        int tmp = number1 % 10;
-        s = char (tmp + 48) + s;
+        digits[length++] = char (number1 % 10 + 48);
         number1 /= 10;
     }
-    return s;
+    while (number1 != 0);
+    for (int i = 0; i < length; i++) buffer[i] = digits[length - 1 - i];
+    buffer[length] = 0;
+    return length;
+}
+
+std::string numberToString (const Uint32 &number)
+{
+    char buffer[11];
+    int length = formatNumber(buffer, number);
+    return std::string(buffer, length);
+}
+
+std::string signedToString (const int &number)
+{
+    if (number < 0) return "-" + numberToString(Uint32(0) - Uint32(number));
+    return numberToString(number);
 }
 
 #endif // other_stuff_h
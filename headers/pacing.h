@@ -0,0 +1,183 @@
+#ifndef pacing_h
+#define pacing_h
+
+// how long a static screen sleeps waiting for input before checking timers again, in ms
+const int idleWaitTime = 100;
+
+// holds gameplay to a fixed frame rate when presenting does not wait for vsync
+struct frameLimiter
+{
+    // performance counter ticks per frame, 0 when the limiter is off
+    Uint64 frameLength;
+    Uint64 nextFrame;
+
+    frameLimiter();
+};
+
+// frame count and worst frame of a play session, for comparing present modes
+struct frameStats
+{
+    Uint64 startCounter;
+    Uint64 lastCounter;
+    Uint64 worstFrame;
+    Uint32 frames;
+
+    frameStats();
+};
+
+// time spent in parts of a gameplay frame, to see what a feature costs
+enum profileSections
+{
+    profileNotes,
+    profileEffects,
+    profileText,
+    profileSectionCount
+};
+
+const char* profileSectionNames[profileSectionCount] = {"notes", "effects", "text"};
+
+struct frameProfile
+{
+    Uint64 sectionStart;
+    Uint64 current[profileSectionCount];
+    Uint64 total[profileSectionCount];
+    Uint64 worst[profileSectionCount];
+    Uint32 frames;
+
+    frameProfile();
+};
+
+bool isVsyncOn(SDL_Renderer* &renderer);
+
+void startFrameLimiter(frameLimiter &limiter, const int &fps);
+
+void waitForNextFrame(frameLimiter &limiter);
+
+void countFrame(frameStats &stats);
+
+void logFrameStats(const frameStats &stats);
+
+void startSection(frameProfile &profile);
+
+// add the time since startSection to section
+void endSection(frameProfile &profile, const int &section);
+
+void countProfileFrame(frameProfile &profile);
+
+void logFrameProfile(const frameProfile &profile);
+
+frameLimiter::frameLimiter()
+{
+    frameLength = 0;
+    nextFrame = 0;
+}
+
+frameStats::frameStats()
+{
+    startCounter = SDL_GetPerformanceCounter();
+    lastCounter = startCounter;
+    worstFrame = 0;
+    frames = 0;
+}
+
+frameProfile::frameProfile()
+{
+    sectionStart = 0;
+    for (int i = 0; i < profileSectionCount; i++)
+    {
+        current[i] = 0;
+        total[i] = 0;
+        worst[i] = 0;
+    }
+    frames = 0;
+}
+
+bool isVsyncOn(SDL_Renderer* &renderer)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0) return false;
+    return (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+}
+
+void startFrameLimiter(frameLimiter &limiter, const int &fps)
+{
+    if (fps <= 0)
+    {
+        limiter.frameLength = 0;
+        return;
+    }
+    limiter.frameLength = SDL_GetPerformanceFrequency() / fps;
+    limiter.nextFrame = SDL_GetPerformanceCounter() + limiter.frameLength;
+}
+
+void waitForNextFrame(frameLimiter &limiter)
+{
+    if (limiter.frameLength == 0) return;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now > limiter.nextFrame + limiter.frameLength)
+    {
+        // fell more than a frame behind (or came back from pause), start counting from here
+        limiter.nextFrame = now + limiter.frameLength;
+        return;
+    }
+    if (now < limiter.nextFrame)
+    {
+        // sleep most of the way, SDL_Delay can oversleep by a ms or two, then spin the rest
+        Uint64 frequency = SDL_GetPerformanceFrequency();
+        Uint32 remainingMs = Uint32((limiter.nextFrame - now) * 1000 / frequency);
+        if (remainingMs > 2) SDL_Delay(remainingMs - 2);
+        while (SDL_GetPerformanceCounter() < limiter.nextFrame) {}
+    }
+    limiter.nextFrame += limiter.frameLength;
+}
+
+void countFrame(frameStats &stats)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (stats.frames > 0 && now - stats.lastCounter > stats.worstFrame) stats.worstFrame = now - stats.lastCounter;
+    stats.lastCounter = now;
+    stats.frames++;
+}
+
+void logFrameStats(const frameStats &stats)
+{
+    double frequency = SDL_GetPerformanceFrequency();
+    double seconds = (stats.lastCounter - stats.startCounter) / frequency;
+    if (stats.frames < 2 || seconds <= 0) return;
+    std::cout << "Frames: " << stats.frames << ", average " << (stats.frames - 1) / seconds << " fps, worst frame "
+              << stats.worstFrame * 1000 / frequency << " ms" << std::endl;
+}
+
+void startSection(frameProfile &profile)
+{
+    profile.sectionStart = SDL_GetPerformanceCounter();
+}
+
+void endSection(frameProfile &profile, const int &section)
+{
+    profile.current[section] += SDL_GetPerformanceCounter() - profile.sectionStart;
+}
+
+void countProfileFrame(frameProfile &profile)
+{
+    for (int i = 0; i < profileSectionCount; i++)
+    {
+        profile.total[i] += profile.current[i];
+        if (profile.current[i] > profile.worst[i]) profile.worst[i] = profile.current[i];
+        profile.current[i] = 0;
+    }
+    profile.frames++;
+}
+
+void logFrameProfile(const frameProfile &profile)
+{
+    if (profile.frames == 0) return;
+    double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+    for (int i = 0; i < profileSectionCount; i++)
+    {
+        std::cout << "  " << profileSectionNames[i] << ": average " << profile.total[i] * msPerTick / profile.frames
+                  << " ms, worst " << profile.worst[i] * msPerTick << " ms" << std::endl;
+    }
+}
+
+#endif // pacing_h
@@ -0,0 +1,41 @@
+#ifndef packformat_h
+#define packformat_h
+
+// Layout of assets.pack, shared by the game and tools/packassets.cpp. A header, then a table of
+// contents sorted by name, then the data of every entry aligned to packAlignment. Images are
+// stored decoded as ARGB8888 rows without padding, with the colour key already turned into alpha,
+// everything else is the file as it is. Numbers are in the byte order of the machine that packed.
+const char packMagic[8] = "KHPACK1";
+const Uint32 packVersion = 1;
+const int packNameLength = 56;
+const int packAlignment = 64;
+
+enum packEntryTypes
+{
+    packFile,
+    packImage
+};
+
+// set on images with no transparent pixels, they are drawn without blending
+const Uint32 packOpaque = 1;
+
+struct packHeader
+{
+    char magic[8];
+    Uint32 version;
+    Uint32 entryCount;
+};
+
+struct packEntry
+{
+    // path as the game asks for it, e.g. "assets/guitar.png"
+    char name[packNameLength];
+    Uint32 type;
+    Uint32 flags;
+    Uint32 width;
+    Uint32 height;
+    Uint64 offset;
+    Uint64 size;
+};
+
+#endif // packformat_h
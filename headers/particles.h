@@ -0,0 +1,218 @@
+#ifndef particles_h
+#define particles_h
+
+// hit and miss bursts above the buttons. Particles live in a fixed pool, are moved in one pass over
+// plain arrays and drawn as one geometry batch, so chord spam costs at most maxParticles quads a frame
+const int maxParticles = 640;
+const int hitBurstSize = 24;
+const int missBurstSize = 10;
+const int hitParticleLife = 450;
+const int missParticleLife = 300;
+// px per ms, and px per ms squared pulling particles back down
+const float hitParticleSpeed = 0.45f;
+const float missParticleSpeed = 0.15f;
+const float particleGravity = 0.0015f;
+// longest step one update takes, so coming back from a pause does not fling everything away
+const float maxParticleStep = 50;
+
+// colours by lane, the last one for misses
+const int missParticleColor = 5;
+const SDL_Color particleColors[6] = {{40, 220, 60, 255}, {230, 40, 40, 255}, {240, 220, 40, 255},
+                                     {40, 120, 240, 255}, {250, 140, 20, 255}, {150, 150, 150, 255}};
+
+struct particlePool
+{
+    int count;
+    float x[maxParticles];
+    float y[maxParticles];
+    float velocityX[maxParticles];
+    float velocityY[maxParticles];
+    // ms left to live and one over the full life, for fading out
+    float life[maxParticles];
+    float inverseLife[maxParticles];
+    Uint8 color[maxParticles];
+
+    // draw buffers, filled every frame without allocating
+    SDL_Vertex vertices[maxParticles * 4];
+    int indices[maxParticles * 6];
+    SDL_Rect rects[maxParticles];
+    // set if the renderer refused geometry, rectangles are used from then on
+    bool isGeometryBroken;
+
+    Uint32 seed;
+
+    particlePool();
+};
+
+// one pool for gameplay, too big to sit on playLevel's stack
+particlePool hitParticles;
+
+void clearParticles(particlePool &pool);
+
+// burst for a judgement in lane of the highway offsetX along, nothing for other results. Bursts
+// that do not fit are cut short
+void spawnBurst(particlePool &pool, const int &lane, const int &result, const int &offsetX = 0);
+
+// move every particle by step ms and drop the ones that died
+void updateParticles(particlePool &pool, float step);
+
+void renderParticles(particlePool &pool, SDL_Renderer* &renderer);
+
+particlePool::particlePool()
+{
+    count = 0;
+    isGeometryBroken = false;
+    seed = 2463534242u;
+    // the index pattern never changes, two triangles per quad
+    for (int i = 0; i < maxParticles; i++)
+    {
+        indices[i * 6] = i * 4;
+        indices[i * 6 + 1] = i * 4 + 1;
+        indices[i * 6 + 2] = i * 4 + 2;
+        indices[i * 6 + 3] = i * 4 + 2;
+        indices[i * 6 + 4] = i * 4 + 3;
+        indices[i * 6 + 5] = i * 4;
+    }
+}
+
+void clearParticles(particlePool &pool)
+{
+    pool.count = 0;
+}
+
+// xorshift, uniform in [0, 1)
+float randomUnit(Uint32 &seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+void spawnBurst(particlePool &pool, const int &lane, const int &result, const int &offsetX)
+{
+    if (result != noteHit && result != noteMiss) return;
+    bool isHit = result == noteHit;
+    int size = isHit ? hitBurstSize : missBurstSize;
+    float speed = isHit ? hitParticleSpeed : missParticleSpeed;
+    float life = isHit ? hitParticleLife : missParticleLife;
+    // middle of the hit window of the lane, gems are 49 px
+    float centerX = float(offsetX + 150 + 60 * lane + 24);
+    float centerY = float(perfectY + 24);
+    // on the field as the gameplay queue draws it
+    toScreen(gameplayQueue, centerX, centerY);
+    for (int i = 0; i < size && pool.count < maxParticles; i++)
+    {
+        int p = pool.count++;
+        // hits spray upwards in a fan, misses drop in a small puff
+        float angle = float(M_PI) * (isHit ? 1.1f + 0.8f * randomUnit(pool.seed) : 2 * randomUnit(pool.seed));
+        float velocity = speed * (0.5f + randomUnit(pool.seed));
+        pool.x[p] = centerX + 8 * (randomUnit(pool.seed) - 0.5f);
+        pool.y[p] = centerY;
+        pool.velocityX[p] = velocity * float(SDL_cos(angle));
+        pool.velocityY[p] = velocity * float(SDL_sin(angle));
+        pool.life[p] = life * (0.6f + 0.4f * randomUnit(pool.seed));
+        pool.inverseLife[p] = 1 / pool.life[p];
+        pool.color[p] = isHit ? lane : missParticleColor;
+    }
+}
+
+void updateParticles(particlePool &pool, float step)
+{
+    if (step > maxParticleStep) step = maxParticleStep;
+    // straight loops over the arrays, the compiler turns these into vector code
+    for (int i = 0; i < pool.count; i++)
+    {
+        pool.velocityY[i] += particleGravity * step;
+        pool.x[i] += pool.velocityX[i] * step;
+        pool.y[i] += pool.velocityY[i] * step;
+        pool.life[i] -= step;
+    }
+    // order does not matter, so dead particles are replaced by the last one
+    int i = 0;
+    while (i < pool.count)
+    {
+        if (pool.life[i] > 0)
+        {
+            i++;
+            continue;
+        }
+        int last = --pool.count;
+        pool.x[i] = pool.x[last];
+        pool.y[i] = pool.y[last];
+        pool.velocityX[i] = pool.velocityX[last];
+        pool.velocityY[i] = pool.velocityY[last];
+        pool.life[i] = pool.life[last];
+        pool.inverseLife[i] = pool.inverseLife[last];
+        pool.color[i] = pool.color[last];
+    }
+}
+
+// squares in one colour per call, for renderers without geometry support
+void renderParticleRects(particlePool &pool, SDL_Renderer* &renderer)
+{
+    for (int c = 0; c <= missParticleColor; c++)
+    {
+        int rectCount = 0;
+        for (int i = 0; i < pool.count; i++)
+        {
+            if (pool.color[i] != c) continue;
+            int size = 2 + int(4 * pool.life[i] * pool.inverseLife[i]);
+            pool.rects[rectCount].x = int(pool.x[i]) - size / 2;
+            pool.rects[rectCount].y = int(pool.y[i]) - size / 2;
+            pool.rects[rectCount].w = size;
+            pool.rects[rectCount].h = size;
+            rectCount++;
+        }
+        if (rectCount == 0) continue;
+        SDL_SetRenderDrawColor(renderer, particleColors[c].r, particleColors[c].g, particleColors[c].b, 0xFF);
+        SDL_RenderFillRects(renderer, pool.rects, rectCount);
+    }
+}
+
+void renderParticles(particlePool &pool, SDL_Renderer* &renderer)
+{
+    if (pool.count == 0) return;
+    SDL_BlendMode oldBlendMode;
+    SDL_GetRenderDrawBlendMode(renderer, &oldBlendMode);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_ADD);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!pool.isGeometryBroken)
+    {
+        for (int i = 0; i < pool.count; i++)
+        {
+            // shrink and fade out over the life of the particle
+            float fade = pool.life[i] * pool.inverseLife[i];
+            float half = 1 + 2 * fade;
+            SDL_Color color = particleColors[pool.color[i]];
+            color.a = Uint8(255 * fade);
+            SDL_Vertex* quad = pool.vertices + i * 4;
+            for (int v = 0; v < 4; v++)
+            {
+                quad[v].color = color;
+                quad[v].tex_coord.x = 0;
+                quad[v].tex_coord.y = 0;
+            }
+            quad[0].position.x = pool.x[i] - half;
+            quad[0].position.y = pool.y[i] - half;
+            quad[1].position.x = pool.x[i] + half;
+            quad[1].position.y = pool.y[i] - half;
+            quad[2].position.x = pool.x[i] + half;
+            quad[2].position.y = pool.y[i] + half;
+            quad[3].position.x = pool.x[i] - half;
+            quad[3].position.y = pool.y[i] + half;
+        }
+        if (SDL_RenderGeometry(renderer, NULL, pool.vertices, pool.count * 4, pool.indices, pool.count * 6) == 0)
+        {
+            SDL_SetRenderDrawBlendMode(renderer, oldBlendMode);
+            return;
+        }
+        logSDLError(std::cout, "Could not draw particle geometry, using rectangles", false, SDL_Err);
+        pool.isGeometryBroken = true;
+    }
+#endif
+    renderParticleRects(pool, renderer);
+    SDL_SetRenderDrawBlendMode(renderer, oldBlendMode);
+}
+
+#endif // particles_h
@@ -0,0 +1,128 @@
+#ifndef players_h
+#define players_h
+
+// Local multiplayer. Every player has a highway, a key for each lane and their own judgement
+// state, and all of them read the one chart playLevel loaded, each with its own cursor into it.
+// Highways share the textures and go into the same render queue, so a frame with more players
+// still sorts and submits once. One player plays on the original layout; two and three get
+// highways cut down to the lanes side by side, four do too on a field scaled down to fit.
+// maxPlayers is in game.h, the score journal and its tools need it too.
+// the lanes part of guitar.png, without the multiplier dial
+const int highwayWidth = 320;
+// guitarTexture's x on the single player layout, the highway offsets are taken from it
+const int highwayX = 134;
+
+// lanes green to orange of each player
+const SDL_Keycode playerKeys[maxPlayers][5] =
+{
+    {SDLK_a, SDLK_w, SDLK_e, SDLK_r, SDLK_t},
+    {SDLK_y, SDLK_u, SDLK_i, SDLK_o, SDLK_p},
+    {SDLK_z, SDLK_x, SDLK_c, SDLK_v, SDLK_b},
+    {SDLK_n, SDLK_m, SDLK_COMMA, SDLK_PERIOD, SDLK_SLASH}
+};
+
+const char* playerKeyNames[maxPlayers] = {"A W E R T", "Y U I O P", "Z X C V B", "N M , . /"};
+
+struct playerState
+{
+    activeNotes notes;
+    // next chart note to come onto this player's highway
+    int currentNote;
+    Uint32 score;
+    int streak;
+    int multiplier;
+    int star;
+    int accuracy;
+    int highestStreak;
+    bool isButtonPressed[5];
+    // added to every x of the single player layout
+    int offsetX;
+
+    // the small HUD over each highway in multiplayer
+    cachedText scoreText;
+    cachedText streakText;
+    cachedText multiplierText;
+
+    playerState();
+};
+
+// too big for playLevel's stack, 256 notes a player
+playerState levelPlayers[maxPlayers];
+
+// fresh state for player index of playerCount, placed on their highway
+void resetPlayer(playerState &player, const int &index, const int &playerCount);
+
+// scale of the gameplay field and where it starts, everything but one player fits unscaled up to three
+void playfieldScale(const int &playerCount, float &scale, int &originX, int &originY);
+
+// which player's lane key went down or up, false for other keys
+bool findPlayerKey(const SDL_Keycode &key, const int &playerCount, int &player, int &lane);
+
+playerState::playerState() : scoreText(0, 0), streakText(0, 0), multiplierText(0, 0, "x ")
+{
+    currentNote = 0;
+    score = 0;
+    streak = 0;
+    multiplier = 1;
+    star = 0;
+    accuracy = 0;
+    highestStreak = 0;
+    for (int i = 0; i < 5; i++) isButtonPressed[i] = false;
+    offsetX = 0;
+}
+
+void resetPlayer(playerState &player, const int &index, const int &playerCount)
+{
+    clearNotes(player.notes);
+    player.currentNote = 0;
+    player.score = 0;
+    player.streak = 0;
+    player.multiplier = 1;
+    player.star = 0;
+    player.accuracy = 0;
+    player.highestStreak = 0;
+    for (int i = 0; i < 5; i++) player.isButtonPressed[i] = false;
+    if (playerCount == 1) player.offsetX = 0;
+    else
+    {
+        // equal columns with the highway in the middle of each, four take the scaled field's full width
+        int fieldWidth = playerCount < maxPlayers ? SCREEN_WIDTH : highwayWidth * maxPlayers;
+        int column = fieldWidth / playerCount;
+        player.offsetX = column * index + (column - highwayWidth) / 2 - highwayX;
+    }
+    player.scoreText.posX = player.offsetX + 150;
+    player.scoreText.posY = 8;
+    player.streakText.posX = player.offsetX + 150;
+    player.streakText.posY = 40;
+    player.multiplierText.posX = player.offsetX + 390;
+    player.multiplierText.posY = 8;
+}
+
+void playfieldScale(const int &playerCount, float &scale, int &originX, int &originY)
+{
+    scale = 1;
+    originX = 0;
+    originY = 0;
+    if (playerCount < maxPlayers) return;
+    scale = float(SCREEN_WIDTH) / (highwayWidth * maxPlayers);
+    originY = int((SCREEN_HEIGHT - SCREEN_HEIGHT * scale) / 2);
+}
+
+bool findPlayerKey(const SDL_Keycode &key, const int &playerCount, int &player, int &lane)
+{
+    for (int p = 0; p < playerCount; p++)
+    {
+        for (int l = 0; l < 5; l++)
+        {
+            if (playerKeys[p][l] == key)
+            {
+                player = p;
+                lane = l;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#endif // players_h
@@ -0,0 +1,89 @@
+#ifndef practice_h
+#define practice_h
+
+// A-B section looping. Times are song times, a chart note's entryTime is the song time it reaches
+// the buttons, so a restart puts the clock one note fall before the loop start and seeks the chart
+// cursor and the audio there without reloading anything.
+struct practiceLoop
+{
+    Uint32 start;
+    Uint32 end;
+    bool hasStart;
+    bool isLooping;
+    // set once any seek happened, the run no longer counts as a full play
+    bool isUsed;
+
+    practiceLoop();
+};
+
+// song time after realTime ms of play at rate percent of normal speed, and back. Both wrap like SDL ticks
+Uint32 scaleTime(const Uint32 &realTime, const int &rate);
+
+Uint32 unscaleTime(const Uint32 &songTime, const int &rate);
+
+// move the level clock so it reads songTime right now at rate
+void anchorClock(Uint32 &beginningTime, Uint64 &beginningCounter, const Uint32 &pausedTime, const Uint32 &songTime,
+                 const int &rate, const double &counterToMs);
+
+// index of the first note reaching the buttons at or after time, charts are sorted by entryTime
+int noteIndexAt(const gameNote* chart, const int &noteCount, const Uint32 &time);
+
+// how many lyric lines have appeared by time
+int lyricIndexAt(const gameLyrics* lyrics, const int &lyricCount, const Uint32 &time);
+
+practiceLoop::practiceLoop()
+{
+    start = 0;
+    end = 0;
+    hasStart = false;
+    isLooping = false;
+    isUsed = false;
+}
+
+Uint32 scaleTime(const Uint32 &realTime, const int &rate)
+{
+    if (rate == 100) return realTime;
+    return Uint32(Sint64(Sint32(realTime)) * rate / 100);
+}
+
+Uint32 unscaleTime(const Uint32 &songTime, const int &rate)
+{
+    if (rate == 100) return songTime;
+    return Uint32(Sint64(Sint32(songTime)) * 100 / rate);
+}
+
+void anchorClock(Uint32 &beginningTime, Uint64 &beginningCounter, const Uint32 &pausedTime, const Uint32 &songTime,
+                 const int &rate, const double &counterToMs)
+{
+    Uint32 realTime = unscaleTime(songTime, rate);
+    beginningTime = SDL_GetTicks() - pausedTime - realTime;
+    beginningCounter = SDL_GetPerformanceCounter() - Uint64((pausedTime + realTime) / counterToMs);
+}
+
+int noteIndexAt(const gameNote* chart, const int &noteCount, const Uint32 &time)
+{
+    int low = 0;
+    int high = noteCount;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (chart[middle].entryTime < time) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+int lyricIndexAt(const gameLyrics* lyrics, const int &lyricCount, const Uint32 &time)
+{
+    int low = 0;
+    int high = lyricCount;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (lyrics[middle].entryTime <= time) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+#endif // practice_h
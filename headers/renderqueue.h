@@ -0,0 +1,304 @@
+#ifndef renderqueue_h
+#define renderqueue_h
+
+// Sprite draws of a gameplay frame are queued with a layer instead of going out in the order the
+// code reaches them. At the end of the frame they are sorted stably by (layer, texture), so each
+// texture of a layer is bound once and all its sprites go out as one geometry batch. Draw order
+// only holds between layers, sprites of one layer must not care which texture is drawn first.
+const int maxQueuedSprites = 4096;
+// distinct textures in one frame, more fall back to drawing one at a time
+const int maxQueuedTextures = 32;
+
+enum renderLayers
+{
+    layerBackground,
+    // hold trails under the gems, so the gem of a held note covers the start of its trail
+    layerTrails,
+    layerGems,
+    layerText,
+    layerButtons,
+    layerCount
+};
+
+struct queuedSprite
+{
+    textureE* texture;
+    SDL_Rect source;
+    SDL_Rect target;
+    // layer * maxQueuedTextures + order the texture was first seen in this frame
+    int key;
+};
+
+struct renderQueue
+{
+    // draws go straight out while this is off, so the same drawing code works outside gameplay
+    bool isRecording;
+    // sprite positions are scaled by this and moved by the origin, for a field bigger than the screen
+    float scale;
+    int originX;
+    int originY;
+    int count;
+    queuedSprite sprites[maxQueuedSprites];
+
+    textureE* textures[maxQueuedTextures];
+    int textureCount;
+
+    // sort scratch, allocated once with the queue
+    int keyCounts[layerCount * maxQueuedTextures + 1];
+    int order[maxQueuedSprites];
+
+    // batch buffers
+    SDL_Vertex vertices[maxQueuedSprites * 4];
+    int indices[maxQueuedSprites * 6];
+    bool isGeometryBroken;
+
+    // totals for the log at the end of the level
+    Uint32 frames;
+    Uint32 spritesDrawn;
+    Uint32 batchesDrawn;
+
+    renderQueue();
+};
+
+// too big for playLevel's stack like the particle pool
+renderQueue gameplayQueue;
+
+// start recording a frame
+void beginRenderQueue(renderQueue &queue);
+
+// queue texture at its position on layer, drawn right away when the queue is not recording
+void queueSprite(renderQueue &queue, const int &layer, SDL_Renderer* &renderer, textureE &texture, SDL_Rect* clip = NULL);
+
+// scale sprites queued from now on, 1 and 0, 0 draw them where they are
+void setRenderQueueScale(renderQueue &queue, const float &scale, const int &originX, const int &originY);
+
+// where a point of the field ends up on screen with the queue's scale
+void toScreen(const renderQueue &queue, float &x, float &y);
+
+// sort and draw what is queued without counting a frame, also used when the queue fills up
+void drawRenderQueue(renderQueue &queue, SDL_Renderer* &renderer);
+
+// sort and draw everything queued, into the software frame when that is active, then stop recording
+void submitRenderQueue(renderQueue &queue, SDL_Renderer* &renderer);
+
+// average sprites and batches per frame, then reset the totals
+void logRenderQueue(renderQueue &queue);
+
+renderQueue::renderQueue()
+{
+    isRecording = false;
+    scale = 1;
+    originX = 0;
+    originY = 0;
+    count = 0;
+    textureCount = 0;
+    isGeometryBroken = false;
+    frames = 0;
+    spritesDrawn = 0;
+    batchesDrawn = 0;
+    // two triangles per quad, the pattern never changes
+    for (int i = 0; i < maxQueuedSprites; i++)
+    {
+        indices[i * 6] = i * 4;
+        indices[i * 6 + 1] = i * 4 + 1;
+        indices[i * 6 + 2] = i * 4 + 2;
+        indices[i * 6 + 3] = i * 4 + 2;
+        indices[i * 6 + 4] = i * 4 + 3;
+        indices[i * 6 + 5] = i * 4;
+    }
+}
+
+void beginRenderQueue(renderQueue &queue)
+{
+    queue.isRecording = true;
+    queue.count = 0;
+    queue.textureCount = 0;
+}
+
+void setRenderQueueScale(renderQueue &queue, const float &scale, const int &originX, const int &originY)
+{
+    queue.scale = scale;
+    queue.originX = originX;
+    queue.originY = originY;
+}
+
+void toScreen(const renderQueue &queue, float &x, float &y)
+{
+    x = queue.originX + x * queue.scale;
+    y = queue.originY + y * queue.scale;
+}
+
+void queueSprite(renderQueue &queue, const int &layer, SDL_Renderer* &renderer, textureE &texture, SDL_Rect* clip)
+{
+    if (!queue.isRecording)
+    {
+        drawTexture(gameplayFrame, renderer, texture, clip);
+        return;
+    }
+    if (texture.texture == NULL) return;
+    touchResource(texture.resourceSlot);
+    if (queue.count == maxQueuedSprites)
+    {
+        // a full queue is drawn early, order across the flush still follows the code
+        drawRenderQueue(queue, renderer);
+        beginRenderQueue(queue);
+    }
+    int textureIndex = 0;
+    while (textureIndex < queue.textureCount && queue.textures[textureIndex] != &texture) textureIndex++;
+    if (textureIndex == queue.textureCount)
+    {
+        if (queue.textureCount == maxQueuedTextures)
+        {
+            // out of keys, keep it in order by drawing what is queued first
+            submitRenderQueue(queue, renderer);
+            beginRenderQueue(queue);
+            textureIndex = 0;
+        }
+        queue.textures[queue.textureCount++] = &texture;
+    }
+
+    queuedSprite &sprite = queue.sprites[queue.count++];
+    sprite.texture = &texture;
+    sprite.source.x = 0;
+    sprite.source.y = 0;
+    sprite.source.w = texture.width;
+    sprite.source.h = texture.height;
+    if (clip != NULL) sprite.source = *clip;
+    // the texture's position is changed for every note, so it is taken now
+    sprite.target.x = texture.posX;
+    sprite.target.y = texture.posY;
+    sprite.target.w = sprite.source.w;
+    sprite.target.h = sprite.source.h;
+    if (queue.scale != 1)
+    {
+        // both corners are scaled so sprites that touched still touch
+        float left = float(sprite.target.x);
+        float top = float(sprite.target.y);
+        float right = left + sprite.target.w;
+        float bottom = top + sprite.target.h;
+        toScreen(queue, left, top);
+        toScreen(queue, right, bottom);
+        sprite.target.x = int(SDL_floorf(left));
+        sprite.target.y = int(SDL_floorf(top));
+        sprite.target.w = int(SDL_floorf(right)) - sprite.target.x;
+        sprite.target.h = int(SDL_floorf(bottom)) - sprite.target.y;
+    }
+    sprite.key = layer * maxQueuedTextures + textureIndex;
+}
+
+// counting sort on the key, stable and without allocating
+void sortRenderQueue(renderQueue &queue)
+{
+    const int keyCount = layerCount * maxQueuedTextures;
+    for (int k = 0; k <= keyCount; k++) queue.keyCounts[k] = 0;
+    for (int i = 0; i < queue.count; i++) queue.keyCounts[queue.sprites[i].key + 1]++;
+    for (int k = 0; k < keyCount; k++) queue.keyCounts[k + 1] += queue.keyCounts[k];
+    for (int i = 0; i < queue.count; i++) queue.order[queue.keyCounts[queue.sprites[i].key]++] = i;
+}
+
+// one geometry call for the sprites order[first, last) which all share a texture
+bool drawBatch(renderQueue &queue, SDL_Renderer* &renderer, const int &first, const int &last)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (queue.isGeometryBroken) return false;
+    textureE* texture = queue.sprites[queue.order[first]].texture;
+    if (texture->width <= 0 || texture->height <= 0) return false;
+    float inverseWidth = 1.0f / texture->width;
+    float inverseHeight = 1.0f / texture->height;
+    SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+    // the alpha mod is kept by the texture and applies to geometry as well, only the colour is per vertex
+    for (int i = first; i < last; i++)
+    {
+        const queuedSprite &sprite = queue.sprites[queue.order[i]];
+        SDL_Vertex* quad = queue.vertices + (i - first) * 4;
+        float left = float(sprite.target.x);
+        float top = float(sprite.target.y);
+        float right = float(sprite.target.x + sprite.target.w);
+        float bottom = float(sprite.target.y + sprite.target.h);
+        float u0 = sprite.source.x * inverseWidth;
+        float v0 = sprite.source.y * inverseHeight;
+        float u1 = (sprite.source.x + sprite.source.w) * inverseWidth;
+        float v1 = (sprite.source.y + sprite.source.h) * inverseHeight;
+        quad[0].position.x = left;
+        quad[0].position.y = top;
+        quad[0].tex_coord.x = u0;
+        quad[0].tex_coord.y = v0;
+        quad[1].position.x = right;
+        quad[1].position.y = top;
+        quad[1].tex_coord.x = u1;
+        quad[1].tex_coord.y = v0;
+        quad[2].position.x = right;
+        quad[2].position.y = bottom;
+        quad[2].tex_coord.x = u1;
+        quad[2].tex_coord.y = v1;
+        quad[3].position.x = left;
+        quad[3].position.y = bottom;
+        quad[3].tex_coord.x = u0;
+        quad[3].tex_coord.y = v1;
+        for (int v = 0; v < 4; v++) quad[v].color = white;
+    }
+    int quads = last - first;
+    if (SDL_RenderGeometry(renderer, texture->texture, queue.vertices, quads * 4, queue.indices, quads * 6) == 0) return true;
+    logSDLError(std::cout, "Could not draw sprite geometry, drawing sprites one at a time", false, SDL_Err);
+    queue.isGeometryBroken = true;
+#endif
+    return false;
+}
+
+void drawRenderQueue(renderQueue &queue, SDL_Renderer* &renderer)
+{
+    if (queue.count == 0) return;
+    sortRenderQueue(queue);
+    queue.spritesDrawn += queue.count;
+
+    int first = 0;
+    while (first < queue.count)
+    {
+        textureE* texture = queue.sprites[queue.order[first]].texture;
+        int last = first + 1;
+        while (last < queue.count && queue.sprites[queue.order[last]].texture == texture) last++;
+        queue.batchesDrawn++;
+
+        if (gameplayFrame.isActive)
+        {
+            // the software backend works from recorded sprites as well, it only gets them sorted
+            for (int i = first; i < last; i++)
+            {
+                const queuedSprite &sprite = queue.sprites[queue.order[i]];
+                recordSoftSprite(gameplayFrame, *texture, sprite.source, sprite.target);
+            }
+        }
+        else if (last - first == 1 || !drawBatch(queue, renderer, first, last))
+        {
+            // still one texture bind for the run, SDL batches consecutive copies of the same texture
+            for (int i = first; i < last; i++)
+            {
+                queuedSprite &sprite = queue.sprites[queue.order[i]];
+                SDL_RenderCopy(renderer, texture->texture, &sprite.source, &sprite.target);
+            }
+        }
+        first = last;
+    }
+}
+
+void submitRenderQueue(renderQueue &queue, SDL_Renderer* &renderer)
+{
+    queue.isRecording = false;
+    // a frame that flushed a full queue early is still one frame
+    queue.frames++;
+    drawRenderQueue(queue, renderer);
+}
+
+void logRenderQueue(renderQueue &queue)
+{
+    if (queue.frames > 0)
+    {
+        std::cout << "Sprites: " << queue.spritesDrawn / queue.frames << " per frame in "
+                  << queue.batchesDrawn / queue.frames << " batches" << std::endl;
+    }
+    queue.frames = 0;
+    queue.spritesDrawn = 0;
+    queue.batchesDrawn = 0;
+}
+
+#endif // renderqueue_h
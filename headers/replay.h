@@ -0,0 +1,147 @@
+#ifndef replay_h
+#define replay_h
+
+#include <ctime>
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+// Records what playLevel fed into the scoring code, see headers/replayformat.h, into a fixed
+// buffer during play. Full plays are saved to replays/ so tools/rescore.cpp can score them again
+// when the rules change.
+// about an hour of play at 144 fps
+const Uint32 maxReplayBytes = 1 << 21;
+// the longest record, a frame with three full varints
+const Uint32 maxReplayRecord = 30;
+
+struct replayRecorder
+{
+    Uint8 data[maxReplayBytes];
+    Uint32 size;
+    Uint32 lastTime;
+    Uint32 flags;
+    // set when the buffer ran out, the replay is not saved
+    bool isFull;
+
+    replayRecorder();
+};
+
+replayRecorder levelReplay;
+
+void startReplay(replayRecorder &replay, const bool &isLeadFromRender);
+
+// a gameplay loop step that moved the notes, with the times it used
+void recordReplayFrame(replayRecorder &replay, const Uint32 &judgeTime, const Uint32 &renderTime, const double &preciseRenderTime);
+
+// a loop step that came back from the pause menu
+void recordReplayPause(replayRecorder &replay);
+
+// a lane key going down (not a repeat) or up at time
+void recordReplayKey(replayRecorder &replay, const Uint32 &time, const int &lane, const Uint32 &keyState);
+
+// write the replay with the results it ended on to replays/<level folder>-<time>.khr
+void saveReplay(const replayRecorder &replay, const char* chartPath, const Uint64 &chartHash, const Uint32 &score,
+                const int &star, const int &accuracy, const int &highestStreak, const int &noteCount);
+
+replayRecorder::replayRecorder()
+{
+    size = 0;
+    lastTime = 0;
+    flags = 0;
+    isFull = false;
+}
+
+void startReplay(replayRecorder &replay, const bool &isLeadFromRender)
+{
+    replay.size = 0;
+    replay.lastTime = 0;
+    replay.flags = isLeadFromRender ? replayLeadFromRender : 0;
+    replay.isFull = false;
+}
+
+// tag of a record at time, false once the buffer is full
+bool putReplayTag(replayRecorder &replay, const Uint32 &time, const int &kind)
+{
+    if (replay.isFull || replay.size > maxReplayBytes - maxReplayRecord)
+    {
+        replay.isFull = true;
+        return false;
+    }
+    putVarint(replay.data, replay.size, (Uint64(zigzag(Sint32(time - replay.lastTime))) << 4) | kind);
+    replay.lastTime = time;
+    return true;
+}
+
+void recordReplayFrame(replayRecorder &replay, const Uint32 &judgeTime, const Uint32 &renderTime, const double &preciseRenderTime)
+{
+    if (!putReplayTag(replay, judgeTime, replayFrame)) return;
+    putVarint(replay.data, replay.size, zigzag(Sint32(renderTime - judgeTime)));
+    // the fraction the notes are drawn at, in 1/64 ms
+    Sint32 fraction = Sint32(SDL_floor((preciseRenderTime - Sint32(renderTime)) * 64 + 0.5));
+    putVarint(replay.data, replay.size, zigzag(fraction));
+}
+
+void recordReplayPause(replayRecorder &replay)
+{
+    putReplayTag(replay, replay.lastTime, replayPause);
+}
+
+void recordReplayKey(replayRecorder &replay, const Uint32 &time, const int &lane, const Uint32 &keyState)
+{
+    putReplayTag(replay, time, (keyState == SDL_KEYDOWN ? replayKeyDown : replayKeyUp) + lane);
+}
+
+void saveReplay(const replayRecorder &replay, const char* chartPath, const Uint64 &chartHash, const Uint32 &score,
+                const int &star, const int &accuracy, const int &highestStreak, const int &noteCount)
+{
+    if (replay.isFull)
+    {
+        logSDLError(std::cout, "Replay too long, not saved", false, none);
+        return;
+    }
+    if (SDL_strlen(chartPath) >= size_t(replayPathLength))
+    {
+        logSDLError(std::cout, "Chart path too long for a replay, not saved", false, none);
+        return;
+    }
+#ifdef _WIN32
+    _mkdir("replays");
+#else
+    mkdir("replays", 0755);
+#endif
+    // named after the chart's folder, "assets/LevelOne/Chart.txt" is saved as LevelOne-<time>.khr
+    std::string folder = chartPath;
+    folder = folder.substr(0, folder.find_last_of('/'));
+    folder = folder.substr(folder.find_last_of('/') + 1);
+    Sint64 now = Sint64(std::time(NULL));
+    std::ostringstream path;
+    path << "replays/" << folder << '-' << now << ".khr";
+
+    replayHeader header;
+    SDL_memset(&header, 0, sizeof(header));
+    SDL_memcpy(header.magic, replayMagic, sizeof(header.magic));
+    header.version = replayVersion;
+    header.dataSize = replay.size;
+    header.chartHash = chartHash;
+    SDL_strlcpy(header.chartPath, chartPath, replayPathLength);
+    header.score = score;
+    header.star = star;
+    header.accuracy = accuracy;
+    header.highestStreak = highestStreak;
+    header.noteCount = noteCount;
+    header.flags = replay.flags;
+    header.recordedAt = now;
+
+    std::ofstream outFile(path.str().c_str(), std::ios::binary);
+    if (!outFile)
+    {
+        logSDLError(std::cout, "Could not save the replay!", false, none);
+        return;
+    }
+    outFile.write((const char*) &header, sizeof(header));
+    outFile.write((const char*) replay.data, replay.size);
+}
+
+#endif // replay_h
@@ -0,0 +1,162 @@
+#ifndef replayformat_h
+#define replayformat_h
+
+// Layout of the replays the game saves under replays/, shared by the game and tools/rescore.cpp.
+// A header, then one record per gameplay loop step and per lane key the game judged, in the order
+// the game handled them. A record starts with a varint tag: the zigzagged ms from the previous
+// record's time shifted up by four, and the record kind in the low four bits. Frames add the
+// render time and the fraction of the precise render time as two more zigzagged varints, so a
+// frame usually takes three or four bytes.
+const char replayMagic[8] = "KHRPLY1";
+const Uint32 replayVersion = 1;
+const int replayPathLength = 48;
+
+enum replayRecords
+{
+    // notes enter, move and are missed, then the multiplier and stars are updated
+    replayFrame,
+    // a loop step spent in the pause menu, only the multiplier and stars are updated
+    replayPause,
+    // lane key down is replayKeyDown + lane, key up replayKeyUp + lane
+    replayKeyDown,
+    replayKeyUp = replayKeyDown + 5,
+    replayRecordCount = replayKeyUp + 5
+};
+
+// notes were fed in by render time, the visual offset was positive
+const Uint32 replayLeadFromRender = 1;
+
+struct replayHeader
+{
+    char magic[8];
+    Uint32 version;
+    Uint32 dataSize;
+    Uint64 chartHash;
+    // chart as the game loads it, e.g. "assets/LevelOne/Chart.txt"
+    char chartPath[replayPathLength];
+    // what the results screen showed, the rescoring tool reports against these
+    Uint32 score;
+    Sint32 star;
+    Sint32 accuracy;
+    Sint32 highestStreak;
+    Sint32 noteCount;
+    Uint32 flags;
+    Sint64 recordedAt;
+};
+
+struct replayResult
+{
+    Uint32 score;
+    int star;
+    int accuracy;
+    int highestStreak;
+};
+
+Uint32 zigzag(const Sint32 &value);
+
+Sint32 unzigzag(const Uint32 &value);
+
+// append value as a varint, seven bits per byte, room for 10 bytes has to be there
+void putVarint(Uint8* data, Uint32 &size, Uint64 value);
+
+// read the varint at data[at], false if it runs past size
+bool getVarint(const Uint8* data, const Uint32 &size, Uint32 &at, Uint64 &value);
+
+// play the records through the scoring code against chart, false if they are damaged. notes is
+// scratch, it is too big for a worker thread's stack
+bool simulateReplay(const gameNote* chart, const int &noteCount, const Uint32 &noMultiplierScore, const int &speed,
+                    const Uint8* data, const Uint32 &size, const Uint32 &flags, activeNotes &notes, replayResult &result);
+
+Uint32 zigzag(const Sint32 &value)
+{
+    return (Uint32(value) << 1) ^ Uint32(value >> 31);
+}
+
+Sint32 unzigzag(const Uint32 &value)
+{
+    return Sint32(value >> 1) ^ -Sint32(value & 1);
+}
+
+void putVarint(Uint8* data, Uint32 &size, Uint64 value)
+{
+    while (value >= 0x80)
+    {
+        data[size++] = Uint8(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = Uint8(value);
+}
+
+bool getVarint(const Uint8* data, const Uint32 &size, Uint32 &at, Uint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && at < size; shift += 7)
+    {
+        Uint8 byte = data[at++];
+        value |= Uint64(byte & 0x7F) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+bool simulateReplay(const gameNote* chart, const int &noteCount, const Uint32 &noMultiplierScore, const int &speed,
+                    const Uint8* data, const Uint32 &size, const Uint32 &flags, activeNotes &notes, replayResult &result)
+{
+    clearNotes(notes);
+    int currentNote = 0;
+    int streak = 0;
+    int multiplier = 1;
+    result.score = 0;
+    result.star = 0;
+    result.accuracy = 0;
+    result.highestStreak = 0;
+    Uint32 time = 0;
+    Uint32 at = 0;
+    while (at < size)
+    {
+        Uint64 tag;
+        if (!getVarint(data, size, at, tag)) return false;
+        int kind = int(tag & 15);
+        time += unzigzag(Uint32(tag >> 4));
+        if (kind >= replayRecordCount) return false;
+        if (kind == replayFrame || kind == replayPause)
+        {
+            // playLevel takes the highest streak at the end of each loop step, the step before this one
+            if (streak > result.highestStreak) result.highestStreak = streak;
+        }
+        if (kind == replayFrame)
+        {
+            Uint64 renderDelta;
+            Uint64 preciseDelta;
+            if (!getVarint(data, size, at, renderDelta) || !getVarint(data, size, at, preciseDelta)) return false;
+            Uint32 judgeTime = time;
+            Uint32 renderTime = judgeTime + unzigzag(Uint32(renderDelta));
+            double preciseRenderTime = Sint32(renderTime) + unzigzag(Uint32(preciseDelta)) / 64.0;
+            Uint32 noteLeadTime = (flags & replayLeadFromRender) ? renderTime : judgeTime;
+            while (currentNote < noteCount && SDL_TICKS_PASSED(noteLeadTime, chart[currentNote].entryTime))
+            {
+                addNote(notes, chart[currentNote], speed);
+                currentNote++;
+            }
+            bool isMissed;
+            updateNotes(notes, preciseRenderTime, renderTime, judgeTime, speed, isMissed);
+            if (isMissed) streak = 0;
+        }
+        if (kind == replayFrame || kind == replayPause)
+        {
+            scoreFrame(streak, multiplier, result.star, result.score, noMultiplierScore);
+        }
+        else
+        {
+            bool isUp = kind >= replayKeyUp;
+            int lane = kind - (isUp ? replayKeyUp : replayKeyDown);
+            Sint32 offset;
+            notePressHandle(lane, notes, result.score, 0, isUp ? SDL_KEYUP : SDL_KEYDOWN, time, streak, multiplier,
+                            result.accuracy, speed, offset);
+        }
+    }
+    if (streak > result.highestStreak) result.highestStreak = streak;
+    return true;
+}
+
+#endif // replayformat_h
@@ -0,0 +1,270 @@
+#ifndef resources_h
+#define resources_h
+
+#include <algorithm>
+#include <vector>
+
+// Memory accounting. Every texture, font atlas, song and sound that is loaded is tracked here with
+// its size, what loaded it and the frame it was last drawn, so the totals can be shown while
+// playing and the whole list written out on demand. Sizes are estimates of the decoded data: a
+// texture counts 4 bytes a pixel plus its CPU copy whatever the driver keeps, a chunk its samples,
+// and streamed music, which SDL_mixer keeps opaque, the size of its file.
+const int maxResources = 1024;
+
+enum resourceKinds
+{
+    resourceTexture,
+    resourceFont,
+    resourceMusic,
+    resourceSound,
+    resourceKindCount
+};
+
+const char* resourceKindNames[resourceKindCount] = {"texture", "font", "music", "sound"};
+
+struct resourceEntry
+{
+    // NULL for a free slot
+    const void* handle;
+    int kind;
+    Sint64 bytes;
+    std::string owner;
+    Uint32 loadedFrame;
+    Uint32 lastUsedFrame;
+};
+
+struct resourceRegistry
+{
+    // songs are decoded on a worker, lock guards everything but lastUsedFrame and frame
+    SDL_SpinLock lock;
+    resourceEntry entries[maxResources];
+    // one past the highest slot in use
+    int slotCount;
+    Sint64 bytes[resourceKindCount];
+    int counts[resourceKindCount];
+    Sint64 peakBytes;
+    Uint32 frame;
+    bool isFullLogged;
+
+    resourceRegistry();
+};
+
+resourceRegistry resources;
+// the totals line over the game, toggled with F3
+bool isResourceOverlayShown = false;
+
+// add a loaded handle, the slot to untrack it with comes back, -1 if the registry is full
+int trackResource(const void* handle, const int &kind, const Sint64 &bytes, const char* owner);
+
+// the handle at slot grew or shrank
+void resizeResource(const int &slot, const Sint64 &bytes);
+
+// forget handle before it is freed, a slot that has been reused by another handle is left alone
+void untrackResource(int &slot, const void* handle);
+
+// same for handles nobody kept the slot of
+void untrackHandle(const void* handle);
+
+// mark the resource at slot as used this frame
+void touchResource(const int &slot);
+
+void countResourceFrame();
+
+Sint64 resourceBytes(const int &kind);
+
+Sint64 totalResourceBytes();
+
+// "Textures 1234 KB (12)  Fonts ..." into buffer
+void formatResourceTotals(char* buffer, const int &size);
+
+// write every tracked resource, biggest first, to path and the totals to the console
+void dumpResources(const char* path);
+
+resourceRegistry::resourceRegistry()
+{
+    lock = 0;
+    for (int i = 0; i < maxResources; i++)
+    {
+        entries[i].handle = NULL;
+        entries[i].kind = resourceTexture;
+        entries[i].bytes = 0;
+        entries[i].loadedFrame = 0;
+        entries[i].lastUsedFrame = 0;
+    }
+    slotCount = 0;
+    for (int i = 0; i < resourceKindCount; i++)
+    {
+        bytes[i] = 0;
+        counts[i] = 0;
+    }
+    peakBytes = 0;
+    frame = 0;
+    isFullLogged = false;
+}
+
+// called with the lock held
+void updatePeakBytes(resourceRegistry &registry)
+{
+    Sint64 total = 0;
+    for (int i = 0; i < resourceKindCount; i++) total += registry.bytes[i];
+    if (total > registry.peakBytes) registry.peakBytes = total;
+}
+
+int trackResource(const void* handle, const int &kind, const Sint64 &bytes, const char* owner)
+{
+    if (handle == NULL) return -1;
+    SDL_AtomicLock(&resources.lock);
+    int slot = 0;
+    while (slot < resources.slotCount && resources.entries[slot].handle != NULL) slot++;
+    if (slot == maxResources)
+    {
+        bool isLogged = resources.isFullLogged;
+        resources.isFullLogged = true;
+        SDL_AtomicUnlock(&resources.lock);
+        if (!isLogged) logSDLError(std::cout, "Resource registry is full, later loads are not counted", false, none);
+        return -1;
+    }
+    if (slot == resources.slotCount) resources.slotCount++;
+    resourceEntry &entry = resources.entries[slot];
+    entry.handle = handle;
+    entry.kind = kind;
+    entry.bytes = bytes;
+    entry.owner = owner;
+    entry.loadedFrame = resources.frame;
+    entry.lastUsedFrame = resources.frame;
+    resources.bytes[kind] += bytes;
+    resources.counts[kind]++;
+    updatePeakBytes(resources);
+    SDL_AtomicUnlock(&resources.lock);
+    return slot;
+}
+
+void resizeResource(const int &slot, const Sint64 &bytes)
+{
+    if (slot < 0) return;
+    SDL_AtomicLock(&resources.lock);
+    resourceEntry &entry = resources.entries[slot];
+    resources.bytes[entry.kind] += bytes - entry.bytes;
+    entry.bytes = bytes;
+    updatePeakBytes(resources);
+    SDL_AtomicUnlock(&resources.lock);
+}
+
+// called with the lock held
+void clearResource(resourceRegistry &registry, const int &slot)
+{
+    resourceEntry &entry = registry.entries[slot];
+    registry.bytes[entry.kind] -= entry.bytes;
+    registry.counts[entry.kind]--;
+    entry.handle = NULL;
+    entry.bytes = 0;
+    entry.owner.clear();
+    while (registry.slotCount > 0 && registry.entries[registry.slotCount - 1].handle == NULL) registry.slotCount--;
+}
+
+void untrackResource(int &slot, const void* handle)
+{
+    if (slot < 0) return;
+    SDL_AtomicLock(&resources.lock);
+    // a copied textureE shares its slot with the original, only the first free counts
+    if (resources.entries[slot].handle == handle) clearResource(resources, slot);
+    SDL_AtomicUnlock(&resources.lock);
+    slot = -1;
+}
+
+void untrackHandle(const void* handle)
+{
+    if (handle == NULL) return;
+    SDL_AtomicLock(&resources.lock);
+    for (int i = 0; i < resources.slotCount; i++)
+    {
+        if (resources.entries[i].handle == handle)
+        {
+            clearResource(resources, i);
+            break;
+        }
+    }
+    SDL_AtomicUnlock(&resources.lock);
+}
+
+void touchResource(const int &slot)
+{
+    if (slot >= 0) resources.entries[slot].lastUsedFrame = resources.frame;
+}
+
+void countResourceFrame()
+{
+    resources.frame++;
+}
+
+Sint64 resourceBytes(const int &kind)
+{
+    SDL_AtomicLock(&resources.lock);
+    Sint64 bytes = resources.bytes[kind];
+    SDL_AtomicUnlock(&resources.lock);
+    return bytes;
+}
+
+Sint64 totalResourceBytes()
+{
+    Sint64 total = 0;
+    for (int i = 0; i < resourceKindCount; i++) total += resourceBytes(i);
+    return total;
+}
+
+void formatResourceTotals(char* buffer, const int &size)
+{
+    Sint64 bytes[resourceKindCount];
+    int counts[resourceKindCount];
+    SDL_AtomicLock(&resources.lock);
+    for (int i = 0; i < resourceKindCount; i++)
+    {
+        bytes[i] = resources.bytes[i];
+        counts[i] = resources.counts[i];
+    }
+    SDL_AtomicUnlock(&resources.lock);
+    SDL_snprintf(buffer, size, "Textures %d KB (%d)  Fonts %d KB  Music %d KB  Sounds %d KB (%d)",
+                 int(bytes[resourceTexture] / 1024), counts[resourceTexture], int(bytes[resourceFont] / 1024),
+                 int(bytes[resourceMusic] / 1024), int(bytes[resourceSound] / 1024), counts[resourceSound]);
+}
+
+bool isBiggerResource(const resourceEntry* a, const resourceEntry* b)
+{
+    return a->bytes > b->bytes;
+}
+
+void dumpResources(const char* path)
+{
+    // copied out so the file is written without holding the lock
+    std::vector<resourceEntry> entries;
+    SDL_AtomicLock(&resources.lock);
+    for (int i = 0; i < resources.slotCount; i++) if (resources.entries[i].handle != NULL) entries.push_back(resources.entries[i]);
+    Sint64 peakBytes = resources.peakBytes;
+    SDL_AtomicUnlock(&resources.lock);
+    std::vector<const resourceEntry*> order;
+    for (size_t i = 0; i < entries.size(); i++) order.push_back(&entries[i]);
+    std::stable_sort(order.begin(), order.end(), isBiggerResource);
+
+    char totals[160];
+    formatResourceTotals(totals, sizeof(totals));
+    std::cout << totals << ", peak " << peakBytes / 1024 << " KB" << std::endl;
+
+    std::ofstream outFile(path);
+    if (!outFile)
+    {
+        logSDLError(std::cout, std::string("Could not write ") + path, false, none);
+        return;
+    }
+    outFile << totals << std::endl;
+    outFile << "peak " << peakBytes / 1024 << " KB, frame " << resources.frame << std::endl;
+    outFile << "kind\tbytes\tloaded\tlast used\towner" << std::endl;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const resourceEntry &entry = *order[i];
+        outFile << resourceKindNames[entry.kind] << '\t' << entry.bytes << '\t' << entry.loadedFrame << '\t'
+                << entry.lastUsedFrame << '\t' << entry.owner << std::endl;
+    }
+    std::cout << "Resources written to " << path << std::endl;
+}
+
+#endif // resources_h
@@ -0,0 +1,415 @@
+#ifndef scorejournal_h
+#define scorejournal_h
+
+#include <ctime>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Every finished play as a fixed size record with its own checksum, appended to scores.journal and
+// flushed, so a crash loses at most the play being written and a torn record is found on the next
+// start. Once the journal has grown by journalCompactRecords, all records are written to a fresh
+// scores.db, it replaces the old one by a rename, and the journal starts over empty. Records are
+// numbered, so ones that made it into scores.db before a crash emptied the journal are not read twice.
+// The whole history is kept in memory with indexes per song that are updated as records come in:
+// the top maxHighScores, each player's best and each player's plays in order. Adding a play is a
+// fixed amount of work and the menu never looks at more records than it shows.
+const char journalMagic[8] = "KHSCORE";
+const Uint32 journalVersion = 1;
+const int maxHighScores = 10;
+const Uint32 journalCompactRecords = 4096;
+
+struct journalHeader
+{
+    char magic[8];
+    Uint32 version;
+    // scores.db: sequence of the last record in it, scores.journal: 0
+    Uint32 sequence;
+};
+
+struct journalRecord
+{
+    // hashChart of the chart's path, a song keeps its scores when its chart is edited
+    Uint64 song;
+    // counts every record ever added from 1
+    Uint32 sequence;
+    // unix time in seconds, 0 for scores imported from Highscore.txt
+    Uint32 playedAt;
+    Uint32 score;
+    // notes hit of noteCount, imported scores only have the percentage and store it of 100
+    Uint16 hits;
+    Uint16 noteCount;
+    Uint16 highestStreak;
+    Uint8 star;
+    // player slot, 0 for a solo run
+    Uint8 player;
+    // of the bytes before it
+    Uint32 checksum;
+};
+
+struct songScores
+{
+    // indexes into scoreJournal::records, best score first
+    int top[maxHighScores];
+    int topCount;
+    // every player's best, -1 before their first play
+    int best[maxPlayers];
+    // every player's plays in the order they were added
+    std::vector<int> history[maxPlayers];
+
+    songScores();
+};
+
+struct scoreJournal
+{
+    std::vector<journalRecord> records;
+    std::map<Uint64, songScores> songs;
+    std::string databasePath;
+    std::string journalPath;
+    std::ofstream journal;
+    Uint32 nextSequence;
+    // records in the journal file, compacted into the database once there are enough
+    Uint32 journalCount;
+};
+
+scoreJournal levelScores;
+
+// key of the song whose chart is at chartPath
+Uint64 songKey(const char* chartPath);
+
+// read databasePath and journalPath into memory and build the indexes, then keep the journal open to add to
+void openScoreJournal(scoreJournal &scores, const char* databasePath, const char* journalPath);
+
+// bring in a song's Highscore.txt the first time the journal is opened without any scores for it
+void importHighScores(scoreJournal &scores, const char* chartPath, const char* highscorePath);
+
+// append a play to the journal and the indexes
+void addScore(scoreJournal &scores, const Uint64 &song, const int &player, const Uint32 &score, const int &star,
+              const int &hits, const int &noteCount, const int &highestStreak);
+
+// up to count of the best scores of song, best first, returns how many there are
+int topScores(const scoreJournal &scores, const Uint64 &song, const journalRecord** top, const int &count);
+
+// player's best play of song, NULL if they have not played it
+const journalRecord* personalBest(const scoreJournal &scores, const Uint64 &song, const int &player);
+
+// up to count of player's plays of song from the time from on, oldest first, returns how many there are
+int scoreHistory(const scoreJournal &scores, const Uint64 &song, const int &player, const Uint32 &from,
+                 const journalRecord** history, const int &count);
+
+// rewrite the database with every record and empty the journal
+void compactScoreJournal(scoreJournal &scores);
+
+// compact if the journal is due and close it
+void closeScoreJournal(scoreJournal &scores);
+
+songScores::songScores()
+{
+    topCount = 0;
+    for (int i = 0; i < maxPlayers; i++) best[i] = -1;
+}
+
+Uint64 songKey(const char* chartPath)
+{
+    return hashChart(chartPath);
+}
+
+// FNV-1a of the record up to its checksum
+Uint32 recordChecksum(const journalRecord &record)
+{
+    const Uint8* bytes = (const Uint8*) &record;
+    Uint32 hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(journalRecord) - sizeof(Uint32); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// the record at index goes into its song's indexes
+void indexRecord(scoreJournal &scores, const int &index)
+{
+    const journalRecord &record = scores.records[index];
+    songScores &song = scores.songs[record.song];
+    int player = record.player < maxPlayers ? record.player : 0;
+
+    // insertion into the short top list, ties go to whoever got there first
+    int place = song.topCount;
+    while (place > 0 && record.score > scores.records[song.top[place - 1]].score) place--;
+    if (place < maxHighScores)
+    {
+        if (song.topCount < maxHighScores) song.topCount++;
+        for (int i = song.topCount - 1; i > place; i--) song.top[i] = song.top[i - 1];
+        song.top[place] = index;
+    }
+
+    if (song.best[player] == -1 || record.score > scores.records[song.best[player]].score) song.best[player] = index;
+    // kept in time order, plays come in as they happen but the rescore tool can bring back older ones
+    std::vector<int> &plays = song.history[player];
+    std::vector<int>::iterator at = plays.end();
+    while (at != plays.begin() && scores.records[*(at - 1)].playedAt > record.playedAt) --at;
+    plays.insert(at, index);
+}
+
+journalHeader makeJournalHeader(const Uint32 &sequence)
+{
+    journalHeader header;
+    SDL_memset(&header, 0, sizeof(header));
+    SDL_memcpy(header.magic, journalMagic, sizeof(header.magic));
+    header.version = journalVersion;
+    header.sequence = sequence;
+    return header;
+}
+
+void writeJournalHeader(std::ofstream &outFile, const Uint32 &sequence)
+{
+    journalHeader header = makeJournalHeader(sequence);
+    outFile.write((const char*) &header, sizeof(header));
+}
+
+// every whole record of file with a good checksum and a sequence after after, false once one is not.
+// A file that is not there reads as empty
+bool readJournalFile(scoreJournal &scores, const std::string &path, const Uint32 &after, Uint32 &sequence)
+{
+    sequence = 0;
+    std::ifstream inFile(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!inFile) return true;
+    Uint64 fileSize = inFile.tellg();
+    inFile.seekg(0);
+    journalHeader header;
+    if (!inFile.read((char*) &header, sizeof(header)) || SDL_memcmp(header.magic, journalMagic, sizeof(header.magic)) != 0
+        || header.version != journalVersion)
+    {
+        return false;
+    }
+    sequence = header.sequence;
+    // in one read, a database can have millions of these
+    size_t count = size_t((fileSize - sizeof(header)) / sizeof(journalRecord));
+    size_t first = scores.records.size();
+    scores.records.resize(first + count);
+    if (count > 0) inFile.read((char*) &scores.records[first], count * sizeof(journalRecord));
+    bool isWhole = (fileSize - sizeof(header)) % sizeof(journalRecord) == 0;
+    size_t kept = first;
+    for (size_t i = first; i < first + count; i++)
+    {
+        const journalRecord &record = scores.records[i];
+        if (record.checksum != recordChecksum(record))
+        {
+            isWhole = false;
+            break;
+        }
+        if (record.sequence <= after) continue;
+        scores.records[kept++] = record;
+    }
+    scores.records.resize(kept);
+    return isWhole;
+}
+
+// true if the database at path was written out to the end: every record is whole with a good
+// checksum and the last one is the one its header names
+bool isCompleteDatabase(const std::string &path)
+{
+    std::ifstream inFile(path.c_str());
+    if (!inFile) return false;
+    inFile.close();
+    scoreJournal check;
+    Uint32 sequence;
+    if (!readJournalFile(check, path, 0, sequence)) return false;
+    Uint32 last = check.records.empty() ? 0 : check.records.back().sequence;
+    return last == sequence;
+}
+
+void openScoreJournal(scoreJournal &scores, const char* databasePath, const char* journalPath)
+{
+    scores.databasePath = databasePath;
+    scores.journalPath = journalPath;
+    scores.records.clear();
+    scores.songs.clear();
+    // a compaction stopped after the new database was written but before it replaced the old one.
+    // One that stopped while writing is left alone, the journal still has its records
+    std::string temporaryPath = scores.databasePath + ".tmp";
+    std::ifstream database(databasePath);
+    if (!database && isCompleteDatabase(temporaryPath)) std::rename(temporaryPath.c_str(), databasePath);
+    database.close();
+    Uint32 databaseSequence;
+    bool isDatabaseGood = readJournalFile(scores, scores.databasePath, 0, databaseSequence);
+    if (!isDatabaseGood) logSDLError(std::cout, "Score database is damaged, some scores were lost", false, none);
+    size_t databaseCount = scores.records.size();
+    // journal records are skipped up to the last one the database really has, not the one its
+    // header claims, so a damaged database does not hide what the journal still holds
+    Uint32 databaseLast = 0;
+    for (size_t i = 0; i < databaseCount; i++) databaseLast = std::max(databaseLast, scores.records[i].sequence);
+    Uint32 unused;
+    // a damaged tail is a play that was being written when the game stopped
+    bool isJournalGood = readJournalFile(scores, scores.journalPath, databaseLast, unused);
+    scores.journalCount = Uint32(scores.records.size() - databaseCount);
+
+    scores.nextSequence = databaseSequence + 1;
+    for (size_t i = 0; i < scores.records.size(); i++)
+    {
+        if (scores.records[i].sequence >= scores.nextSequence) scores.nextSequence = scores.records[i].sequence + 1;
+        indexRecord(scores, int(i));
+    }
+
+    // the records are all in memory now, writing them out leaves no damaged bytes to append after
+    if (!isDatabaseGood || !isJournalGood || scores.journalCount >= journalCompactRecords) compactScoreJournal(scores);
+    else
+    {
+        std::ifstream existing(scores.journalPath.c_str());
+        bool isNew = !existing;
+        existing.close();
+        scores.journal.open(scores.journalPath.c_str(), std::ios::binary | std::ios::app);
+        if (isNew && scores.journal) writeJournalHeader(scores.journal, 0);
+        scores.journal.flush();
+    }
+    if (!scores.journal) logSDLError(std::cout, "Could not open the score journal, scores will not be saved!", false, none);
+}
+
+// number and checksum record, index it and append it to the journal
+void appendRecord(scoreJournal &scores, journalRecord &record)
+{
+    record.sequence = scores.nextSequence++;
+    record.checksum = recordChecksum(record);
+    scores.records.push_back(record);
+    indexRecord(scores, int(scores.records.size() - 1));
+
+    if (!scores.journal) return;
+    scores.journal.write((const char*) &record, sizeof(record));
+    scores.journal.flush();
+    if (!scores.journal) logSDLError(std::cout, "Could not save the score!", false, none);
+    scores.journalCount++;
+}
+
+void importHighScores(scoreJournal &scores, const char* chartPath, const char* highscorePath)
+{
+    Uint64 song = songKey(chartPath);
+    if (scores.songs.count(song) != 0) return;
+    std::ifstream inFile(highscorePath);
+    if (!inFile) return;
+    int star;
+    int accuracyPercent;
+    Uint32 score;
+    for (int i = 0; i < maxHighScores && inFile >> star >> accuracyPercent >> score; i++)
+    {
+        // empty places of the old table are zeros
+        if (score == 0) continue;
+        journalRecord record;
+        SDL_memset(&record, 0, sizeof(record));
+        record.song = song;
+        record.score = score;
+        record.hits = Uint16(accuracyPercent);
+        record.noteCount = 100;
+        record.star = Uint8(star);
+        appendRecord(scores, record);
+    }
+}
+
+void addScore(scoreJournal &scores, const Uint64 &song, const int &player, const Uint32 &score, const int &star,
+              const int &hits, const int &noteCount, const int &highestStreak)
+{
+    journalRecord record;
+    SDL_memset(&record, 0, sizeof(record));
+    record.song = song;
+    record.playedAt = Uint32(std::time(NULL));
+    record.score = score;
+    record.hits = Uint16(hits);
+    record.noteCount = Uint16(noteCount);
+    record.highestStreak = Uint16(highestStreak);
+    record.star = Uint8(star);
+    record.player = Uint8(player);
+    appendRecord(scores, record);
+}
+
+int topScores(const scoreJournal &scores, const Uint64 &song, const journalRecord** top, const int &count)
+{
+    std::map<Uint64, songScores>::const_iterator found = scores.songs.find(song);
+    if (found == scores.songs.end()) return 0;
+    int shown = std::min(count, found->second.topCount);
+    for (int i = 0; i < shown; i++) top[i] = &scores.records[found->second.top[i]];
+    return shown;
+}
+
+const journalRecord* personalBest(const scoreJournal &scores, const Uint64 &song, const int &player)
+{
+    std::map<Uint64, songScores>::const_iterator found = scores.songs.find(song);
+    if (found == scores.songs.end() || player < 0 || player >= maxPlayers || found->second.best[player] == -1) return NULL;
+    return &scores.records[found->second.best[player]];
+}
+
+int scoreHistory(const scoreJournal &scores, const Uint64 &song, const int &player, const Uint32 &from,
+                 const journalRecord** history, const int &count)
+{
+    std::map<Uint64, songScores>::const_iterator found = scores.songs.find(song);
+    if (found == scores.songs.end() || player < 0 || player >= maxPlayers) return 0;
+    const std::vector<int> &plays = found->second.history[player];
+    // plays are indexed in time order, so the start is a binary search
+    size_t low = 0;
+    size_t high = plays.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (scores.records[plays[middle]].playedAt < from) low = middle + 1;
+        else high = middle;
+    }
+    int shown = 0;
+    for (size_t i = low; i < plays.size() && shown < count; i++) history[shown++] = &scores.records[plays[i]];
+    return shown;
+}
+
+void compactScoreJournal(scoreJournal &scores)
+{
+    scores.journal.close();
+    std::string temporaryPath = scores.databasePath + ".tmp";
+    // the header names the last record, which is the newest since records are kept in sequence order
+    Uint32 lastSequence = scores.records.empty() ? 0 : scores.records.back().sequence;
+    journalHeader header = makeJournalHeader(lastSequence);
+    std::FILE* outFile = std::fopen(temporaryPath.c_str(), "wb");
+    bool isWritten = outFile != NULL && std::fwrite(&header, sizeof(header), 1, outFile) == 1;
+    if (isWritten && !scores.records.empty())
+    {
+        isWritten = std::fwrite(&scores.records[0], sizeof(journalRecord), scores.records.size(), outFile) == scores.records.size();
+    }
+    // on the disk before the rename, or a crash could leave a renamed database that was never written
+    if (isWritten) isWritten = std::fflush(outFile) == 0;
+#ifdef _WIN32
+    if (isWritten) isWritten = _commit(_fileno(outFile)) == 0;
+#else
+    if (isWritten) isWritten = fsync(fileno(outFile)) == 0;
+#endif
+    if (outFile != NULL && std::fclose(outFile) != 0) isWritten = false;
+    if (!isWritten)
+    {
+        logSDLError(std::cout, "Could not compact the score journal", false, none);
+        std::remove(temporaryPath.c_str());
+    }
+    else
+    {
+#ifdef _WIN32
+        // rename does not replace a file here
+        std::remove(scores.databasePath.c_str());
+#endif
+        std::rename(temporaryPath.c_str(), scores.databasePath.c_str());
+        // the database has every record now, the journal starts over
+        std::ofstream emptied(scores.journalPath.c_str(), std::ios::binary | std::ios::trunc);
+        writeJournalHeader(emptied, 0);
+        emptied.close();
+        scores.journalCount = 0;
+    }
+    scores.journal.clear();
+    scores.journal.open(scores.journalPath.c_str(), std::ios::binary | std::ios::app);
+}
+
+void closeScoreJournal(scoreJournal &scores)
+{
+    if (scores.journalCount >= journalCompactRecords) compactScoreJournal(scores);
+    scores.journal.close();
+}
+
+#endif // scorejournal_h
@@ -0,0 +1,160 @@
+#ifndef scoring_h
+#define scoring_h
+
+// Chart parsing, judging and the scoring rules. playLevel and tools/rescore.cpp both score through
+// these, so a replay re-simulated by the tool gets what the game would give with the rules as they
+// are now. Nothing in here draws, plays sounds or keeps state between calls.
+
+// offset passed back for a press that had no note in its lane to be timed against
+const Sint32 noTimingOffset = 0x7FFFFFFF;
+// starMultiplier has one threshold per star
+const int maxStars = 7;
+
+// read a chart's text, the speed and score for all notes on x1 first, then one note per line
+bool parseChart(gameNote (&levelChart)[2000], const std::string &text, Uint32 &musicStart, int &noteCount,
+                Uint32 &noMultiplierScore, int &speed);
+
+// FNV-1a of the chart text, a replay only fits the chart it was played on
+Uint64 hashChart(const std::string &text);
+
+int multiplierForStreak(const int &streak);
+
+// points for a tap note, and for a hold let go after heldFor ms of its heldTime
+Uint32 tapPoints(const int &multiplier);
+
+Uint32 holdPoints(const Uint32 &heldFor, const Uint32 &heldTime, const int &multiplier);
+
+// once per gameplay frame: multiplier from the streak, and every star the score has reached
+void scoreFrame(const int &streak, int &multiplier, int &star, const Uint32 &score, const Uint32 &noMultiplierScore);
+
+// judge a key going down or up in lane at passedTime, offset is the press's timing in ms for hits and misses
+int notePressHandle(const int &lane, activeNotes &onScreenNotes, Uint32 &score,
+                    const int &keyRepeat, const int &keyState, const Uint32 &passedTime, int &streak, const int &multiplier, int &accuracy,
+                    const int &speed, Sint32 &offset);
+
+bool parseChart(gameNote (&levelChart)[2000], const std::string &text, Uint32 &musicStart, int &noteCount,
+                Uint32 &noMultiplierScore, int &speed)
+{
+    std::istringstream inFile(text);
+    int currentNote = 0;
+    if (!(inFile >> speed >> noMultiplierScore) || speed < 0 || speed > 9) return false;
+    musicStart = (594 - hitBox + 99) / noteSpeed[speed];
+    // the last slot holds the end marker
+    while (!inFile.eof() && currentNote < 1999)
+    {
+        Uint32 entryTime_;
+        int lane_;
+        Uint32 heldTime_;
+        inFile >> entryTime_ >> lane_ >> heldTime_;
+        levelChart[currentNote].entryTime = entryTime_;
+        levelChart[currentNote].lane = lane_;
+        levelChart[currentNote].heldTime = heldTime_;
+        levelChart[currentNote].isHeld = heldTime_ != 0;
+        currentNote++;
+    }
+    levelChart[currentNote].entryTime = 100000000;
+    noteCount = currentNote;
+    return true;
+}
+
+Uint64 hashChart(const std::string &text)
+{
+    Uint64 hash = 14695981039346656037ull;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        hash ^= Uint8(text[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+int multiplierForStreak(const int &streak)
+{
+    if (streak <= 10) return 1;
+    if (streak <= 20) return 2;
+    if (streak <= 30) return 3;
+    return 4;
+}
+
+Uint32 tapPoints(const int &multiplier)
+{
+    return 50 * multiplier;
+}
+
+Uint32 holdPoints(const Uint32 &heldFor, const Uint32 &heldTime, const int &multiplier)
+{
+    // letting go late scores the full trail and no more
+    if (heldFor > heldTime) return heldTime / 10 * multiplier;
+    return heldFor / 10 * multiplier;
+}
+
+void scoreFrame(const int &streak, int &multiplier, int &star, const Uint32 &score, const Uint32 &noMultiplierScore)
+{
+    multiplier = multiplierForStreak(streak);
+    while (star < maxStars && score >= noMultiplierScore * starMultiplier[star]) star++;
+}
+
+int notePressHandle(const int &lane, activeNotes &onScreenNotes, Uint32 &score,
+                    const int &keyRepeat, const int &keyState, const Uint32 &passedTime, int &streak, const int &multiplier, int &accuracy,
+                    const int &speed, Sint32 &offset)
+{
+    int result = noJudgement;
+    offset = noTimingOffset;
+    int closestNote = -1;
+    for (int i = 0; i < onScreenNotes.count; i++)
+    {
+        if (onScreenNotes.lane[i] == lane)
+        {
+            closestNote = i;
+            break;
+        }
+    }
+    if (closestNote != -1)
+    {
+        if (keyState == SDL_KEYDOWN)
+        {
+            if (keyRepeat == 0)
+            {
+                // judged where the gem was when the key went down, not where it was last drawn
+                int posY = notePositionAt(onScreenNotes.entryTime[closestNote], passedTime, speed);
+                // ms from the gem crossing perfectY, hits and misses alike
+                offset = Sint32(passedTime - onScreenNotes.entryTime[closestNote]) - Sint32((perfectY + 99) / noteSpeed[speed] + 0.5f);
+                if (posY <= 594 && posY >= 594 - hitBox)
+                {
+                    accuracy++;
+                    onScreenNotes.pressed[closestNote] = flagSet;
+                    if (!onScreenNotes.isHeld[closestNote])
+                    {
+                        removeNote(onScreenNotes, closestNote);
+                        score += tapPoints(multiplier);
+                    }
+                    else
+                    {
+                        onScreenNotes.heldStartTime[closestNote] = passedTime;
+                    }
+                    streak++;
+                    result = noteHit;
+                }
+                else
+                {
+                    streak = 0;
+                    result = noteMiss;
+                }
+            }
+        }
+        else if (keyState == SDL_KEYUP && onScreenNotes.pressed[closestNote] && !onScreenNotes.released[closestNote])
+        {
+            score += holdPoints(passedTime - onScreenNotes.heldStartTime[closestNote], onScreenNotes.heldTime[closestNote], multiplier);
+            onScreenNotes.released[closestNote] = true;
+            result = holdRelease;
+        }
+    }
+    else if (keyState == SDL_KEYDOWN && keyRepeat == 0)
+    {
+        streak = 0;
+        result = noteMiss;
+    }
+    return result;
+}
+
+#endif // scoring_h
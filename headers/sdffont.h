@@ -0,0 +1,651 @@
+#ifndef sdffont_h
+#define sdffont_h
+
+#include <vector>
+
+// Signed distance field text. Every printable ASCII glyph is rasterized once at sdfBaseSize, turned
+// into a distance field and packed into one 8-bit atlas that is cached next to the font. Text at any
+// size is then sampled from the atlas on the CPU: the distance to the glyph edge gives a one pixel
+// antialiased ramp at whatever scale, so no size needs its own TTF_Font or its own rasterization.
+// SDL_Renderer has no pixel shaders, the CPU pass is what a threshold shader would do.
+// Text is UTF-8. Glyphs past ASCII are rasterized from the TTF font the first time a text on the
+// main thread needs them and kept in extra atlas pages, looked up by codepoint. A line is laid out
+// once into a run of glyphs and cell pointers, and drawing a run costs the same for any script.
+const int sdfBaseSize = 48;
+// how far, in base size pixels, distances are stored on either side of the edge
+const int sdfSpread = 6;
+const int sdfFirstGlyph = 32;
+const int sdfLastGlyph = 126;
+const int sdfGlyphCount = sdfLastGlyph - sdfFirstGlyph + 1;
+const int sdfAtlasWidth = 1024;
+// bump when the cache layout or the generation changes
+const int sdfCacheVersion = 1;
+// glyphs past ASCII a font can hold, a lyric file in Vietnamese uses around a hundred
+const int sdfMaxExtraGlyphs = 1024;
+// open addressing table of them by codepoint, a power of two with room to spare
+const int sdfExtraSlots = 2048;
+// extra glyphs go into pages this many cell rows tall, pages never move once made
+const int sdfPageRows = 4;
+const int sdfMaxPages = 32;
+
+struct sdfGlyph
+{
+    // cell in the atlas, the glyph's line box plus sdfSpread on every side
+    int x;
+    int y;
+    int w;
+    int h;
+    int advance;
+};
+
+struct sdfFont
+{
+    Uint8* atlas;
+    int atlasHeight;
+    int lineHeight;
+    sdfGlyph glyphs[sdfGlyphCount];
+
+    // glyphs past ASCII, only added on the main thread by cacheSdfGlyphs
+    std::string fontPath;
+    // opened the first time a glyph is added
+    TTF_Font* source;
+    Uint32 extraCodepoints[sdfMaxExtraGlyphs];
+    sdfGlyph extraGlyphs[sdfMaxExtraGlyphs];
+    int extraPages[sdfMaxExtraGlyphs];
+    int extraCount;
+    // index + 1 of a glyph, 0 for an empty slot. Set after the glyph is complete, so a worker
+    // looking glyphs up while one is added sees either nothing or the whole glyph
+    SDL_atomic_t extraSlots[sdfExtraSlots];
+    Uint8* pages[sdfMaxPages];
+    int pageCount;
+    int pageHeight;
+    // next free spot on the last page
+    int shelfX;
+    int shelfY;
+    // slot in the resource registry, the atlas and pages count as one font
+    int resourceSlot;
+
+    sdfFont();
+};
+
+// a glyph placed on a line, with the atlas pixels of its cell
+struct sdfRunGlyph
+{
+    const sdfGlyph* glyph;
+    const Uint8* cell;
+    int penX;
+};
+
+// a laid out line, kept by callers that draw the same text again
+struct sdfRun
+{
+    std::vector<sdfRunGlyph> glyphs;
+    // in base size pixels, to the furthest glyph box or the pen, whichever is further
+    int width;
+
+    sdfRun();
+};
+
+sdfFont ralewayLight;
+
+// read the atlas from cachePath, or build it from the TTF font and write the cache, false if neither worked
+bool loadSdfFont(sdfFont &font, const char* fontPath, const char* cachePath);
+
+void freeSdfFont(sdfFont &font);
+
+// the codepoint at c, which is moved past it. Broken UTF-8 comes back as U+FFFD a byte at a time
+Uint32 nextCodepoint(const char* &c);
+
+// rasterize every glyph of text the font does not have yet. Main thread only, the TTF font is not
+// thread safe, but workers may draw while it runs
+void cacheSdfGlyphs(sdfFont &font, const char* text);
+
+// lay text out with the glyphs the font has, safe to call from worker threads. Missing ones show as '?'
+void layoutSdfRun(const sdfFont &font, const char* text, sdfRun &run);
+
+// ARGB8888 surface of a laid out run at size pixels, safe to call from worker threads. NULL for an empty run
+SDL_Surface* renderSdfRun(const sdfRun &run, const sdfFont &font, const int &size, const SDL_Color &color);
+
+// layoutSdfRun and renderSdfRun in one, for text drawn once
+SDL_Surface* renderSdfSurface(const sdfFont &font, const char* text, const int &size, const SDL_Color &color);
+
+// SDF counterpart of textureE::loadFromRenderedText
+void loadSdfText(textureE &texture, const char* text, const SDL_Color &color, sdfFont &font, const int &size,
+                 SDL_Renderer* &renderer);
+
+// SDF counterpart of renderText
+void renderSdfText(const std::string &text, const SDL_Color &color, sdfFont &font, const int &size,
+                   SDL_Renderer* &renderer, textureE &texture, const int &posX, const int &posY);
+
+sdfFont::sdfFont()
+{
+    atlas = NULL;
+    atlasHeight = 0;
+    lineHeight = 0;
+    source = NULL;
+    extraCount = 0;
+    for (int i = 0; i < sdfExtraSlots; i++) extraSlots[i].value = 0;
+    pageCount = 0;
+    pageHeight = 0;
+    shelfX = 0;
+    shelfY = 0;
+    resourceSlot = -1;
+}
+
+sdfRun::sdfRun()
+{
+    width = 0;
+}
+
+// the cache is only valid for the font file it was made from
+Sint64 fontFileSize(const char* fontPath)
+{
+    SDL_RWops* file = openAsset(fontPath);
+    if (file == NULL) return -1;
+    Sint64 size = SDL_RWsize(file);
+    SDL_RWclose(file);
+    return size;
+}
+
+bool readSdfCache(sdfFont &font, const char* cachePath, const Sint64 &fontBytes)
+{
+    std::ifstream inFile(cachePath, std::ios::binary);
+    if (!inFile) return false;
+    char magic[6];
+    int version;
+    Sint64 cachedBytes;
+    int baseSize;
+    int spread;
+    int atlasWidth;
+    inFile.read(magic, 6);
+    inFile.read((char*) &version, sizeof(version));
+    inFile.read((char*) &cachedBytes, sizeof(cachedBytes));
+    inFile.read((char*) &baseSize, sizeof(baseSize));
+    inFile.read((char*) &spread, sizeof(spread));
+    inFile.read((char*) &atlasWidth, sizeof(atlasWidth));
+    inFile.read((char*) &font.atlasHeight, sizeof(font.atlasHeight));
+    inFile.read((char*) &font.lineHeight, sizeof(font.lineHeight));
+    if (!inFile || SDL_memcmp(magic, "KHSDF\n", 6) != 0 || version != sdfCacheVersion || cachedBytes != fontBytes
+        || baseSize != sdfBaseSize || spread != sdfSpread || atlasWidth != sdfAtlasWidth
+        || font.atlasHeight <= 0 || font.atlasHeight > 4096)
+    {
+        return false;
+    }
+    inFile.read((char*) font.glyphs, sizeof(font.glyphs));
+    font.atlas = (Uint8*) SDL_malloc(sdfAtlasWidth * font.atlasHeight);
+    if (font.atlas == NULL) return false;
+    inFile.read((char*) font.atlas, sdfAtlasWidth * font.atlasHeight);
+    if (!inFile)
+    {
+        freeSdfFont(font);
+        return false;
+    }
+    return true;
+}
+
+void writeSdfCache(const sdfFont &font, const char* cachePath, const Sint64 &fontBytes)
+{
+    std::ofstream outFile(cachePath, std::ios::binary);
+    if (!outFile)
+    {
+        logSDLError(std::cout, "Could not write the font atlas cache, it is rebuilt next launch", false, none);
+        return;
+    }
+    int version = sdfCacheVersion;
+    int baseSize = sdfBaseSize;
+    int spread = sdfSpread;
+    int atlasWidth = sdfAtlasWidth;
+    outFile.write("KHSDF\n", 6);
+    outFile.write((const char*) &version, sizeof(version));
+    outFile.write((const char*) &fontBytes, sizeof(fontBytes));
+    outFile.write((const char*) &baseSize, sizeof(baseSize));
+    outFile.write((const char*) &spread, sizeof(spread));
+    outFile.write((const char*) &atlasWidth, sizeof(atlasWidth));
+    outFile.write((const char*) &font.atlasHeight, sizeof(font.atlasHeight));
+    outFile.write((const char*) &font.lineHeight, sizeof(font.lineHeight));
+    outFile.write((const char*) font.glyphs, sizeof(font.glyphs));
+    outFile.write((const char*) font.atlas, sdfAtlasWidth * font.atlasHeight);
+}
+
+// distance field of one glyph into its atlas cell. coverage is the glyph's line box, the cell is
+// sdfSpread bigger on every side. Brute force over the spread window, it only runs when a glyph is first needed
+void buildGlyphField(Uint8* pixels, const sdfGlyph &glyph, const Uint8* coverage, const int &coverageW, const int &coverageH)
+{
+    for (int y = 0; y < glyph.h; y++)
+    {
+        for (int x = 0; x < glyph.w; x++)
+        {
+            int coverageX = x - sdfSpread;
+            int coverageY = y - sdfSpread;
+            bool isInside = coverageX >= 0 && coverageX < coverageW && coverageY >= 0 && coverageY < coverageH
+                            && coverage[coverageY * coverageW + coverageX] >= 128;
+            int nearest = (sdfSpread + 1) * (sdfSpread + 1);
+            for (int dy = -sdfSpread; dy <= sdfSpread; dy++)
+            {
+                for (int dx = -sdfSpread; dx <= sdfSpread; dx++)
+                {
+                    int otherX = coverageX + dx;
+                    int otherY = coverageY + dy;
+                    bool isOtherInside = otherX >= 0 && otherX < coverageW && otherY >= 0 && otherY < coverageH
+                                         && coverage[otherY * coverageW + otherX] >= 128;
+                    if (isOtherInside != isInside && dx * dx + dy * dy < nearest) nearest = dx * dx + dy * dy;
+                }
+            }
+            // the edge lies half way between the two pixel centres
+            double distance = SDL_sqrt(double(nearest)) - 0.5;
+            if (!isInside) distance = -distance;
+            double value = 128 + distance * 127 / sdfSpread;
+            if (value < 0) value = 0;
+            if (value > 255) value = 255;
+            pixels[(glyph.y + y) * sdfAtlasWidth + glyph.x + x] = Uint8(value);
+        }
+    }
+}
+
+// distance field of a glyph rendered white on black into its cell of pixels
+void buildGlyphFromSurface(Uint8* pixels, const sdfGlyph &glyph, SDL_Surface* surface, const int &lineHeight)
+{
+    // any channel is the coverage
+    int height = surface->h < lineHeight ? surface->h : lineHeight;
+    Uint8* coverage = (Uint8*) SDL_malloc(surface->w * height + 1);
+    if (coverage == NULL) return;
+    for (int y = 0; y < height; y++)
+    {
+        const Uint32* row = (const Uint32*) ((const Uint8*) surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++) coverage[y * surface->w + x] = Uint8((row[x] >> 8) & 0xFF);
+    }
+    buildGlyphField(pixels, glyph, coverage, surface->w, height);
+    SDL_free(coverage);
+}
+
+bool buildSdfFont(sdfFont &font, const char* fontPath)
+{
+    TTF_Font* baseFont = TTF_OpenFontRW(openAsset(fontPath), 1, sdfBaseSize);
+    if (baseFont == NULL)
+    {
+        logSDLError(std::cout, "Could not open font to build its atlas", false, TTF_Err);
+        return false;
+    }
+    font.lineHeight = TTF_FontHeight(baseFont);
+    SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+    SDL_Color black = {0, 0, 0, 0xFF};
+
+    // every glyph is rendered as a one character string, so it comes with its place in the line box
+    SDL_Surface* rendered[sdfGlyphCount];
+    int shelfX = 0;
+    int shelfY = 0;
+    for (int i = 0; i < sdfGlyphCount; i++)
+    {
+        char text[2] = {char(sdfFirstGlyph + i), 0};
+        sdfGlyph &glyph = font.glyphs[i];
+        int minX, maxX, minY, maxY;
+        glyph.advance = 0;
+        if (TTF_GlyphMetrics(baseFont, Uint16(sdfFirstGlyph + i), &minX, &maxX, &minY, &maxY, &glyph.advance) != 0) glyph.advance = 0;
+        rendered[i] = NULL;
+        SDL_Surface* shaded = TTF_RenderText_Shaded(baseFont, text, white, black);
+        if (shaded != NULL)
+        {
+            rendered[i] = SDL_ConvertSurfaceFormat(shaded, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(shaded);
+        }
+        int boxW = rendered[i] != NULL ? rendered[i]->w : 0;
+        glyph.w = boxW + 2 * sdfSpread;
+        glyph.h = font.lineHeight + 2 * sdfSpread;
+        // all cells are as tall as a line, so rows fill up left to right
+        if (shelfX + glyph.w > sdfAtlasWidth)
+        {
+            shelfX = 0;
+            shelfY += glyph.h;
+        }
+        glyph.x = shelfX;
+        glyph.y = shelfY;
+        shelfX += glyph.w;
+    }
+    font.atlasHeight = shelfY + font.lineHeight + 2 * sdfSpread;
+    font.atlas = (Uint8*) SDL_calloc(sdfAtlasWidth * font.atlasHeight, 1);
+
+    for (int i = 0; i < sdfGlyphCount; i++)
+    {
+        SDL_Surface* surface = rendered[i];
+        if (surface == NULL) continue;
+        if (font.atlas != NULL) buildGlyphFromSurface(font.atlas, font.glyphs[i], surface, font.lineHeight);
+        SDL_FreeSurface(surface);
+    }
+    TTF_CloseFont(baseFont);
+    if (font.atlas == NULL)
+    {
+        logSDLError(std::cout, "Out of memory building the font atlas", false, none);
+        return false;
+    }
+    return true;
+}
+
+// the atlas and every extra page
+Sint64 sdfFontBytes(const sdfFont &font)
+{
+    return Sint64(sdfAtlasWidth) * (font.atlasHeight + font.pageCount * font.pageHeight);
+}
+
+bool loadSdfFont(sdfFont &font, const char* fontPath, const char* cachePath)
+{
+    freeSdfFont(font);
+    font.fontPath = fontPath;
+    Sint64 fontBytes = fontFileSize(fontPath);
+    if (!readSdfCache(font, cachePath, fontBytes))
+    {
+        if (!buildSdfFont(font, fontPath)) return false;
+        writeSdfCache(font, cachePath, fontBytes);
+    }
+    font.resourceSlot = trackResource(&font, resourceFont, sdfFontBytes(font), fontPath);
+    return true;
+}
+
+void freeSdfFont(sdfFont &font)
+{
+    untrackResource(font.resourceSlot, &font);
+    if (font.atlas != NULL) SDL_free(font.atlas);
+    font.atlas = NULL;
+    font.atlasHeight = 0;
+    for (int i = 0; i < font.pageCount; i++) SDL_free(font.pages[i]);
+    font.pageCount = 0;
+    font.shelfX = 0;
+    font.shelfY = 0;
+    font.extraCount = 0;
+    for (int i = 0; i < sdfExtraSlots; i++) SDL_AtomicSet(&font.extraSlots[i], 0);
+    if (font.source != NULL) TTF_CloseFont(font.source);
+    font.source = NULL;
+}
+
+Uint32 nextCodepoint(const char* &c)
+{
+    const Uint8* bytes = (const Uint8*) c;
+    Uint32 codepoint;
+    int length;
+    if (bytes[0] < 0x80) return Uint32(*c++);
+    else if ((bytes[0] & 0xE0) == 0xC0)
+    {
+        codepoint = bytes[0] & 0x1F;
+        length = 2;
+    }
+    else if ((bytes[0] & 0xF0) == 0xE0)
+    {
+        codepoint = bytes[0] & 0x0F;
+        length = 3;
+    }
+    else if ((bytes[0] & 0xF8) == 0xF0)
+    {
+        codepoint = bytes[0] & 0x07;
+        length = 4;
+    }
+    else
+    {
+        c++;
+        return 0xFFFD;
+    }
+    for (int i = 1; i < length; i++)
+    {
+        // a missing continuation byte, the terminating zero included, ends the sequence early
+        if ((bytes[i] & 0xC0) != 0x80)
+        {
+            c++;
+            return 0xFFFD;
+        }
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+    c += length;
+    // overlong forms and surrogates are not text either
+    static const Uint32 shortest[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codepoint < shortest[length] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) return 0xFFFD;
+    return codepoint;
+}
+
+// first slot to look at for codepoint, the table is probed linearly from there
+int extraSlotOf(const Uint32 &codepoint)
+{
+    return int((codepoint * 2654435761u) >> 16) & (sdfExtraSlots - 1);
+}
+
+// index of codepoint's extra glyph, -1 if it was not added
+int findExtraGlyph(const sdfFont &font, const Uint32 &codepoint)
+{
+    for (int i = 0, slot = extraSlotOf(codepoint); i < sdfExtraSlots; i++, slot = (slot + 1) & (sdfExtraSlots - 1))
+    {
+        // read only, SDL_AtomicGet just does not take a const pointer
+        int entry = SDL_AtomicGet((SDL_atomic_t*) &font.extraSlots[slot]);
+        if (entry == 0) return -1;
+        if (font.extraCodepoints[entry - 1] == codepoint) return entry - 1;
+    }
+    return -1;
+}
+
+// make the glyph at index findable, after everything about it is written
+void publishExtraGlyph(sdfFont &font, const int &index)
+{
+    int slot = extraSlotOf(font.extraCodepoints[index]);
+    while (SDL_AtomicGet(&font.extraSlots[slot]) != 0) slot = (slot + 1) & (sdfExtraSlots - 1);
+    SDL_AtomicSet(&font.extraSlots[slot], index + 1);
+}
+
+// rasterize codepoint into the extra pages, or remember it as a question mark when the font can not show it
+void addSdfGlyph(sdfFont &font, const Uint32 &codepoint)
+{
+    int index = font.extraCount;
+    font.extraCodepoints[index] = codepoint;
+    font.extraGlyphs[index] = font.glyphs['?' - sdfFirstGlyph];
+    // -1 is the ASCII atlas
+    font.extraPages[index] = -1;
+    font.extraCount++;
+
+    if (font.source == NULL && !font.fontPath.empty())
+    {
+        font.source = TTF_OpenFontRW(openAsset(font.fontPath.c_str()), 1, sdfBaseSize);
+        if (font.source == NULL) logSDLError(std::cout, "Could not open font for glyphs past ASCII", false, TTF_Err);
+        // tried once, everything after shows as a question mark
+        font.fontPath.clear();
+    }
+    // the glyph functions SDL_ttf has everywhere take 16 bits, that covers every living script
+    SDL_Surface* surface = NULL;
+    sdfGlyph glyph;
+    glyph.advance = 0;
+    if (font.source != NULL && codepoint <= 0xFFFF && TTF_GlyphIsProvided(font.source, Uint16(codepoint)))
+    {
+        int minX, maxX, minY, maxY;
+        if (TTF_GlyphMetrics(font.source, Uint16(codepoint), &minX, &maxX, &minY, &maxY, &glyph.advance) != 0) glyph.advance = 0;
+        // a one character string like the ASCII glyphs, so it comes with its place in the line box
+        char text[4] = {char(0xE0 | (codepoint >> 12)), char(0x80 | ((codepoint >> 6) & 0x3F)), char(0x80 | (codepoint & 0x3F)), 0};
+        if (codepoint < 0x800)
+        {
+            text[0] = char(0xC0 | (codepoint >> 6));
+            text[1] = char(0x80 | (codepoint & 0x3F));
+            text[2] = 0;
+        }
+        SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+        SDL_Color black = {0, 0, 0, 0xFF};
+        SDL_Surface* shaded = TTF_RenderUTF8_Shaded(font.source, text, white, black);
+        if (shaded != NULL)
+        {
+            surface = SDL_ConvertSurfaceFormat(shaded, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(shaded);
+        }
+    }
+    if (surface != NULL)
+    {
+        glyph.w = surface->w + 2 * sdfSpread;
+        glyph.h = font.lineHeight + 2 * sdfSpread;
+        if (font.shelfX + glyph.w > sdfAtlasWidth)
+        {
+            font.shelfX = 0;
+            font.shelfY += glyph.h;
+        }
+        if (font.pageCount == 0 || font.shelfY + glyph.h > font.pageHeight)
+        {
+            font.pageHeight = sdfPageRows * glyph.h;
+            Uint8* page = font.pageCount < sdfMaxPages ? (Uint8*) SDL_calloc(sdfAtlasWidth * font.pageHeight, 1) : NULL;
+            if (page != NULL)
+            {
+                font.pages[font.pageCount++] = page;
+                font.shelfX = 0;
+                font.shelfY = 0;
+                resizeResource(font.resourceSlot, sdfFontBytes(font));
+            }
+        }
+        if (glyph.w <= sdfAtlasWidth && font.pageCount > 0 && font.shelfY + glyph.h <= font.pageHeight)
+        {
+            glyph.x = font.shelfX;
+            glyph.y = font.shelfY;
+            font.shelfX += glyph.w;
+            buildGlyphFromSurface(font.pages[font.pageCount - 1], glyph, surface, font.lineHeight);
+            font.extraGlyphs[index] = glyph;
+            font.extraPages[index] = font.pageCount - 1;
+        }
+        SDL_FreeSurface(surface);
+    }
+    publishExtraGlyph(font, index);
+}
+
+void cacheSdfGlyphs(sdfFont &font, const char* text)
+{
+    if (font.atlas == NULL || text == NULL) return;
+    for (const char* c = text; *c != 0;)
+    {
+        Uint32 codepoint = nextCodepoint(c);
+        // ASCII is in the atlas already, control characters show as a question mark
+        if (codepoint <= Uint32(sdfLastGlyph) || font.extraCount >= sdfMaxExtraGlyphs) continue;
+        if (findExtraGlyph(font, codepoint) == -1) addSdfGlyph(font, codepoint);
+    }
+}
+
+const sdfGlyph* findSdfGlyph(const sdfFont &font, const Uint32 &codepoint, const Uint8* &cell)
+{
+    const sdfGlyph* glyph;
+    int page = -1;
+    int extra = -1;
+    if (codepoint >= Uint32(sdfFirstGlyph) && codepoint <= Uint32(sdfLastGlyph)) glyph = &font.glyphs[codepoint - sdfFirstGlyph];
+    else if ((extra = findExtraGlyph(font, codepoint)) != -1)
+    {
+        glyph = &font.extraGlyphs[extra];
+        page = font.extraPages[extra];
+    }
+    // anything else shows as a question mark
+    else glyph = &font.glyphs['?' - sdfFirstGlyph];
+    cell = (page == -1 ? font.atlas : font.pages[page]) + glyph->y * sdfAtlasWidth + glyph->x;
+    return glyph;
+}
+
+void layoutSdfRun(const sdfFont &font, const char* text, sdfRun &run)
+{
+    run.glyphs.clear();
+    run.width = 0;
+    if (font.atlas == NULL || text == NULL) return;
+    // widest reach of any glyph box, in base pixels
+    int penX = 0;
+    for (const char* c = text; *c != 0;)
+    {
+        sdfRunGlyph placed;
+        placed.glyph = findSdfGlyph(font, nextCodepoint(c), placed.cell);
+        placed.penX = penX;
+        run.glyphs.push_back(placed);
+        int reach = penX + placed.glyph->w - 2 * sdfSpread;
+        if (reach > run.width) run.width = reach;
+        penX += placed.glyph->advance;
+    }
+    if (penX > run.width) run.width = penX;
+}
+
+SDL_Surface* renderSdfRun(const sdfRun &run, const sdfFont &font, const int &size, const SDL_Color &color)
+{
+    if (font.atlas == NULL || run.glyphs.empty() || size <= 0) return NULL;
+    float scale = float(size) / sdfBaseSize;
+    int width = int(SDL_ceil(run.width * scale));
+    int height = int(SDL_ceil(font.lineHeight * scale));
+    if (width <= 0 || height <= 0) return NULL;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == NULL)
+    {
+        logSDLError(std::cout, "Unable to create text surface!", false, SDL_Err);
+        return NULL;
+    }
+    SDL_memset(surface->pixels, 0, surface->pitch * height);
+
+    // distance in base pixels times scale is distance in output pixels, the ramp is one pixel wide
+    float rampScale = sdfSpread * scale / 127.0f;
+    Uint32 rgb = (Uint32(color.r) << 16) | (Uint32(color.g) << 8) | color.b;
+    for (size_t i = 0; i < run.glyphs.size(); i++)
+    {
+        const sdfGlyph* glyph = run.glyphs[i].glyph;
+        int penX = run.glyphs[i].penX;
+        // output pixels the glyph's box covers, the spread border is only needed for sampling
+        float boxLeft = penX * scale;
+        float boxRight = (penX + glyph->w - 2 * sdfSpread) * scale;
+        int startX = int(SDL_floor(boxLeft));
+        int endX = int(SDL_ceil(boxRight));
+        if (startX < 0) startX = 0;
+        if (endX > width) endX = width;
+        for (int y = 0; y < height; y++)
+        {
+            // centre of the output pixel in cell coordinates, minus half a texel for the bilinear sample
+            float cellY = (y + 0.5f) / scale + sdfSpread - 0.5f;
+            if (cellY < 0) cellY = 0;
+            if (cellY > glyph->h - 1) cellY = float(glyph->h - 1);
+            int y0 = int(cellY);
+            int y1 = y0 + 1 < glyph->h ? y0 + 1 : y0;
+            float fy = cellY - y0;
+            const Uint8* row0 = run.glyphs[i].cell + y0 * sdfAtlasWidth;
+            const Uint8* row1 = run.glyphs[i].cell + y1 * sdfAtlasWidth;
+            Uint32* out = (Uint32*) ((Uint8*) surface->pixels + y * surface->pitch);
+            for (int x = startX; x < endX; x++)
+            {
+                float cellX = (x + 0.5f) / scale - penX + sdfSpread - 0.5f;
+                if (cellX < 0) cellX = 0;
+                if (cellX > glyph->w - 1) cellX = float(glyph->w - 1);
+                int x0 = int(cellX);
+                int x1 = x0 + 1 < glyph->w ? x0 + 1 : x0;
+                float fx = cellX - x0;
+                float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+                float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+                float value = top + (bottom - top) * fy;
+                float coverage = 0.5f + (value - 128) * rampScale;
+                if (coverage <= 0) continue;
+                if (coverage > 1) coverage = 1;
+                Uint32 alpha = Uint32(coverage * color.a + 0.5f);
+                // neighbouring boxes can overlap, keep the stronger one
+                if (alpha > (out[x] >> 24)) out[x] = (alpha << 24) | rgb;
+            }
+        }
+    }
+    return surface;
+}
+
+SDL_Surface* renderSdfSurface(const sdfFont &font, const char* text, const int &size, const SDL_Color &color)
+{
+    sdfRun run;
+    layoutSdfRun(font, text, run);
+    return renderSdfRun(run, font, size, color);
+}
+
+void loadSdfText(textureE &texture, const char* text, const SDL_Color &color, sdfFont &font, const int &size,
+                 SDL_Renderer* &renderer)
+{
+    cacheSdfGlyphs(font, text);
+    SDL_Surface* surface = renderSdfSurface(font, text, size, color);
+    if (surface == NULL)
+    {
+        // nothing to show, keep an empty texture like an empty TTF render would
+        texture.free();
+        return;
+    }
+    texture.loadFromSurface(surface, renderer, text);
+    SDL_FreeSurface(surface);
+}
+
+void renderSdfText(const std::string &text, const SDL_Color &color, sdfFont &font, const int &size,
+                   SDL_Renderer* &renderer, textureE &texture, const int &posX, const int &posY)
+{
+    loadSdfText(texture, text.c_str(), color, font, size, renderer);
+    if (texture.texture == NULL) return;
+    texture.posX = posX;
+    texture.posY = posY;
+    texture.render(renderer);
+}
+
+#endif // sdffont_h
@@ -0,0 +1,166 @@
+#ifndef settings_h
+#define settings_h
+
+// runtime options read from assets/Settings.txt, one "key value" pair per line
+struct gameSettings
+{
+    // decode the level song to memory before it starts instead of streaming it
+    bool pcmPlayback;
+
+    // mixer output rate and buffer size in sample frames, 2048 frames at 44100 Hz is about 46 ms,
+    // low latency setups want 128 - 256
+    int audioFrequency;
+    int audioBufferSize;
+
+    // play a short preloaded sound on every hit and miss
+    bool hitSounds;
+
+    // measured by the calibration screen, in ms: how late the player taps to what they
+    // hear and to what they see
+    int audioOffset;
+    int visualOffset;
+
+    // vsync, adaptive (vsync that lets late frames tear), uncapped or capped to frameCap
+    int presentMode;
+
+    // gameplay frame rate limit for the capped mode and when vsync is unavailable, 0 for no limit
+    int frameCap;
+
+    // practice speed in percent of normal, 50 - 100, below 100 the song is decoded and time-stretched
+    int playbackRate;
+
+    // record gameplay to capture.y4m and capture.wav, at captureFps video frames per second
+    bool capture;
+    int captureFps;
+
+    // use the software renderer even when a GPU is there, gameplay then runs on the SIMD blitters
+    bool softwareRender;
+
+    // write every press's timing of the last song to timing.csv or timing.json, off, csv or json
+    int timingExport;
+
+    // watch the level's chart and lyrics while playing and take saved edits in without restarting
+    bool hotReload;
+
+    // players sharing the keyboard, 1 - 4, each gets their own highway
+    int players;
+
+    gameSettings();
+};
+
+gameSettings settings;
+
+void loadSettings(gameSettings &s, char* file);
+
+void saveSettings(const gameSettings &s, char* file);
+
+gameSettings::gameSettings()
+{
+    pcmPlayback = false;
+    audioFrequency = 44100;
+    audioBufferSize = 2048;
+    hitSounds = false;
+    audioOffset = 0;
+    visualOffset = 0;
+    presentMode = presentVsync;
+    frameCap = 120;
+    playbackRate = 100;
+    capture = false;
+    captureFps = 60;
+    softwareRender = false;
+    timingExport = timingExportOff;
+    hotReload = false;
+    players = 1;
+}
+
+const char* presentModeNames[4] = {"vsync", "adaptive", "uncapped", "capped"};
+
+const char* timingExportNames[3] = {"off", "csv", "json"};
+
+void loadSettings(gameSettings &s, char* file)
+{
+    std::ifstream inFile(file);
+    if (inFile)
+    {
+        std::string key;
+        while (inFile >> key)
+        {
+            if (key == "pcmPlayback") inFile >> s.pcmPlayback;
+            else if (key == "audioFrequency") inFile >> s.audioFrequency;
+            else if (key == "audioBufferSize") inFile >> s.audioBufferSize;
+            else if (key == "hitSounds") inFile >> s.hitSounds;
+            else if (key == "audioOffset") inFile >> s.audioOffset;
+            else if (key == "visualOffset") inFile >> s.visualOffset;
+            else if (key == "frameCap") inFile >> s.frameCap;
+            else if (key == "playbackRate") inFile >> s.playbackRate;
+            else if (key == "capture") inFile >> s.capture;
+            else if (key == "captureFps") inFile >> s.captureFps;
+            else if (key == "softwareRender") inFile >> s.softwareRender;
+            else if (key == "hotReload") inFile >> s.hotReload;
+            else if (key == "players") inFile >> s.players;
+            else if (key == "presentMode")
+            {
+                std::string mode;
+                inFile >> mode;
+                for (int i = 0; i < 4; i++) if (mode == presentModeNames[i]) s.presentMode = i;
+            }
+            else if (key == "timingExport")
+            {
+                std::string format;
+                inFile >> format;
+                for (int i = 0; i < 3; i++) if (format == timingExportNames[i]) s.timingExport = i;
+            }
+            else
+            {
+                // unknown key, skip the rest of the line
+                std::string rest;
+                getline(inFile, rest);
+            }
+        }
+        inFile.close();
+    }
+    else
+    {
+        logSDLError(std::cout, "Could not open Settings.txt, using defaults", false, none);
+    }
+
+    // SDL_mixer wants a power of two buffer
+    int bufferSize = 64;
+    while (bufferSize < s.audioBufferSize && bufferSize < 8192) bufferSize *= 2;
+    s.audioBufferSize = bufferSize;
+    if (s.audioFrequency < 8000 || s.audioFrequency > 192000) s.audioFrequency = 44100;
+    if (s.playbackRate < 50) s.playbackRate = 50;
+    if (s.playbackRate > 100) s.playbackRate = 100;
+    if (s.captureFps < 1 || s.captureFps > 240) s.captureFps = 60;
+    if (s.players < 1) s.players = 1;
+    if (s.players > 4) s.players = 4;
+}
+
+void saveSettings(const gameSettings &s, char* file)
+{
+    std::ofstream outFile(file);
+    if (outFile)
+    {
+        outFile << "pcmPlayback " << s.pcmPlayback << std::endl;
+        outFile << "audioFrequency " << s.audioFrequency << std::endl;
+        outFile << "audioBufferSize " << s.audioBufferSize << std::endl;
+        outFile << "hitSounds " << s.hitSounds << std::endl;
+        outFile << "audioOffset " << s.audioOffset << std::endl;
+        outFile << "visualOffset " << s.visualOffset << std::endl;
+        outFile << "presentMode " << presentModeNames[s.presentMode] << std::endl;
+        outFile << "frameCap " << s.frameCap << std::endl;
+        outFile << "playbackRate " << s.playbackRate << std::endl;
+        outFile << "capture " << s.capture << std::endl;
+        outFile << "captureFps " << s.captureFps << std::endl;
+        outFile << "softwareRender " << s.softwareRender << std::endl;
+        outFile << "timingExport " << timingExportNames[s.timingExport] << std::endl;
+        outFile << "hotReload " << s.hotReload << std::endl;
+        outFile << "players " << s.players << std::endl;
+    }
+    else
+    {
+        logSDLError(std::cout, "Could not save Settings.txt!", false, none);
+    }
+}
+
+#endif // settings_h
@@ -0,0 +1,41 @@
+#ifndef simd_h
+#define simd_h
+
+// SSE2 and AVX2 kernels are compiled into the same executable with per-function targets and
+// picked at runtime, so one build runs on old lab machines and makes use of newer ones
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    #include <immintrin.h>
+    #define SIMD_X86
+    #define TARGET_SSE2 __attribute__((target("sse2")))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <immintrin.h>
+    #define SIMD_X86
+    #define TARGET_SSE2
+    #define TARGET_AVX2
+#endif
+
+enum simdLevels
+{
+    simdScalar,
+    simdSSE2,
+    simdAVX2
+};
+
+int simdLevel = -1;
+
+// best instruction set both compiled in and supported by this CPU
+int detectSimd();
+
+int detectSimd()
+{
+    if (simdLevel != -1) return simdLevel;
+    simdLevel = simdScalar;
+#ifdef SIMD_X86
+    if (SDL_HasSSE2()) simdLevel = simdSSE2;
+    if (SDL_HasAVX2()) simdLevel = simdAVX2;
+#endif
+    return simdLevel;
+}
+
+#endif // simd_h
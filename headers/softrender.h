@@ -0,0 +1,464 @@
+#ifndef softrender_h
+#define softrender_h
+
+// Gameplay backend for software renderers. Draws are recorded instead of sent to SDL; at the end
+// of the frame they are compared with the last frame's and only rectangles where something
+// appeared, moved or went away are cleared and blitted again into a framebuffer kept between
+// frames, with SSE2/AVX2 colour key and alpha blitters. Those rectangles are uploaded to a
+// streaming texture that is copied to the window in one blit. On a hardware renderer every call
+// here falls through to textureE::render.
+const int maxSoftCommands = 4096;
+const int maxDirtyRects = 32;
+// rectangles closer than this are merged, a few overdrawn pixels are cheaper than another pass
+const int dirtyMergeGap = 16;
+// power of two, at least twice maxSoftCommands
+const int softHashSize = 8192;
+
+struct softCommand
+{
+    SDL_Surface* pixels;
+    Uint32 pixelsId;
+    int kind;
+    SDL_Rect source;
+    SDL_Rect target;
+};
+
+struct softwareFrame
+{
+    bool isActive;
+    int width;
+    int height;
+    Uint32* pixels;
+    SDL_Texture* texture;
+
+    // this frame's draws and the last frame's, swapped every frame
+    softCommand commands[2][maxSoftCommands];
+    int commandCount[2];
+    // index + 1 of each command by hash, 0 for empty
+    Uint16 commandHash[2][softHashSize];
+    int current;
+    bool isOverflowReported;
+    // everything is drawn on the first frame
+    bool isFullRedraw;
+
+    SDL_Rect dirty[maxDirtyRects];
+    int dirtyCount;
+
+    softwareFrame();
+};
+
+softwareFrame gameplayFrame;
+
+// allocate the framebuffer and streaming texture, the frame stays inactive on hardware renderers
+void startSoftwareFrame(softwareFrame &frame, SDL_Renderer* &renderer, const int &width, const int &height);
+
+void stopSoftwareFrame(softwareFrame &frame);
+
+// start recording a frame, replaces clearing the renderer
+void beginSoftwareFrame(softwareFrame &frame);
+
+// record texture at its position, or render it right away when the frame is not active
+void drawTexture(softwareFrame &frame, SDL_Renderer* &renderer, textureE &texture, SDL_Rect* clip = NULL);
+
+// record source of texture drawn unscaled at target, the frame must be active
+void recordSoftSprite(softwareFrame &frame, const textureE &texture, SDL_Rect source, const SDL_Rect &target);
+
+// redraw what changed and copy the framebuffer to the renderer. Anything rendered after this
+// goes on top, like the particles
+void finishSoftwareFrame(softwareFrame &frame, SDL_Renderer* &renderer);
+
+softwareFrame::softwareFrame()
+{
+    isActive = false;
+    width = 0;
+    height = 0;
+    pixels = NULL;
+    texture = NULL;
+    commandCount[0] = 0;
+    commandCount[1] = 0;
+    current = 0;
+    isOverflowReported = false;
+    isFullRedraw = true;
+    dirtyCount = 0;
+}
+
+void startSoftwareFrame(softwareFrame &frame, SDL_Renderer* &renderer, const int &width, const int &height)
+{
+    frame.isActive = false;
+    if (!isKeepingPixels) return;
+    frame.width = width;
+    frame.height = height;
+    frame.pixels = (Uint32*) SDL_malloc(width * height * sizeof(Uint32));
+    frame.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (frame.pixels == NULL || frame.texture == NULL)
+    {
+        logSDLError(std::cout, "Could not create the software framebuffer, drawing through SDL", false, SDL_Err);
+        stopSoftwareFrame(frame);
+        return;
+    }
+    SDL_SetTextureBlendMode(frame.texture, SDL_BLENDMODE_NONE);
+    // the streaming texture and the CPU framebuffer
+    trackResource(frame.texture, resourceTexture, Sint64(width) * height * 8, "software framebuffer");
+    frame.commandCount[0] = 0;
+    frame.commandCount[1] = 0;
+    SDL_memset(frame.commandHash, 0, sizeof(frame.commandHash));
+    frame.current = 0;
+    frame.isOverflowReported = false;
+    frame.isFullRedraw = true;
+    detectSimd();
+    frame.isActive = true;
+}
+
+void stopSoftwareFrame(softwareFrame &frame)
+{
+    untrackHandle(frame.texture);
+    if (frame.texture != NULL) SDL_DestroyTexture(frame.texture);
+    if (frame.pixels != NULL) SDL_free(frame.pixels);
+    frame.texture = NULL;
+    frame.pixels = NULL;
+    frame.isActive = false;
+}
+
+void beginSoftwareFrame(softwareFrame &frame)
+{
+    if (!frame.isActive) return;
+    frame.current ^= 1;
+    frame.commandCount[frame.current] = 0;
+}
+
+bool intersectRects(const SDL_Rect &a, const SDL_Rect &b, SDL_Rect &result)
+{
+    int left = a.x > b.x ? a.x : b.x;
+    int top = a.y > b.y ? a.y : b.y;
+    int right = a.x + a.w < b.x + b.w ? a.x + a.w : b.x + b.w;
+    int bottom = a.y + a.h < b.y + b.h ? a.y + a.h : b.y + b.h;
+    if (right <= left || bottom <= top) return false;
+    result.x = left;
+    result.y = top;
+    result.w = right - left;
+    result.h = bottom - top;
+    return true;
+}
+
+SDL_Rect uniteRects(const SDL_Rect &a, const SDL_Rect &b)
+{
+    int left = a.x < b.x ? a.x : b.x;
+    int top = a.y < b.y ? a.y : b.y;
+    int right = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+    int bottom = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+    SDL_Rect result = {left, top, right - left, bottom - top};
+    return result;
+}
+
+void drawTexture(softwareFrame &frame, SDL_Renderer* &renderer, textureE &texture, SDL_Rect* clip)
+{
+    if (!frame.isActive)
+    {
+        texture.render(renderer, clip);
+        return;
+    }
+    touchResource(texture.resourceSlot);
+    SDL_Rect source = {0, 0, texture.width, texture.height};
+    if (clip != NULL) source = *clip;
+    SDL_Rect target = {texture.posX, texture.posY, source.w, source.h};
+    recordSoftSprite(frame, texture, source, target);
+}
+
+void recordSoftSprite(softwareFrame &frame, const textureE &texture, SDL_Rect source, const SDL_Rect &target)
+{
+    if (texture.pixels == NULL) return;
+    // cut to the screen, moving the source along so no blit has to check bounds
+    SDL_Rect screen = {0, 0, frame.width, frame.height};
+    SDL_Rect visible;
+    if (!intersectRects(target, screen, visible)) return;
+    source.x += visible.x - target.x;
+    source.y += visible.y - target.y;
+    source.w = visible.w;
+    source.h = visible.h;
+
+    int &count = frame.commandCount[frame.current];
+    if (count == maxSoftCommands)
+    {
+        if (!frame.isOverflowReported) logSDLError(std::cout, "Too many software draws in a frame, some were dropped", false, none);
+        frame.isOverflowReported = true;
+        return;
+    }
+    softCommand &command = frame.commands[frame.current][count++];
+    command.pixels = texture.pixels;
+    command.pixelsId = texture.pixelsId;
+    command.kind = texture.pixelsKind;
+    command.source = source;
+    command.target = visible;
+}
+
+bool isSameCommand(const softCommand &a, const softCommand &b)
+{
+    return a.pixelsId == b.pixelsId && a.source.x == b.source.x && a.source.y == b.source.y
+           && a.target.x == b.target.x && a.target.y == b.target.y && a.target.w == b.target.w && a.target.h == b.target.h;
+}
+
+Uint32 hashCommand(const softCommand &command)
+{
+    Uint32 hash = command.pixelsId * 2654435761u;
+    hash = (hash ^ Uint32(command.target.x)) * 2246822519u;
+    hash = (hash ^ Uint32(command.target.y)) * 3266489917u;
+    hash = (hash ^ Uint32(command.source.x + (command.source.y << 16))) * 668265263u;
+    return hash ^ (hash >> 15);
+}
+
+void hashCommands(softwareFrame &frame, const int &list)
+{
+    Uint16* table = frame.commandHash[list];
+    SDL_memset(table, 0, softHashSize * sizeof(Uint16));
+    for (int i = 0; i < frame.commandCount[list]; i++)
+    {
+        Uint32 slot = hashCommand(frame.commands[list][i]) & (softHashSize - 1);
+        while (table[slot] != 0) slot = (slot + 1) & (softHashSize - 1);
+        table[slot] = Uint16(i + 1);
+    }
+}
+
+bool hasCommand(softwareFrame &frame, const int &list, const softCommand &command)
+{
+    const Uint16* table = frame.commandHash[list];
+    Uint32 slot = hashCommand(command) & (softHashSize - 1);
+    while (table[slot] != 0)
+    {
+        if (isSameCommand(frame.commands[list][table[slot] - 1], command)) return true;
+        slot = (slot + 1) & (softHashSize - 1);
+    }
+    return false;
+}
+
+void addDirtyRect(softwareFrame &frame, SDL_Rect rect)
+{
+    // grow it by the merge gap only for the overlap test
+    bool isMerged = true;
+    while (isMerged)
+    {
+        isMerged = false;
+        SDL_Rect grown = {rect.x - dirtyMergeGap, rect.y - dirtyMergeGap, rect.w + 2 * dirtyMergeGap, rect.h + 2 * dirtyMergeGap};
+        for (int i = 0; i < frame.dirtyCount; i++)
+        {
+            SDL_Rect overlap;
+            if (!intersectRects(grown, frame.dirty[i], overlap)) continue;
+            // take the old one out and try again with the union, it may now touch others
+            rect = uniteRects(rect, frame.dirty[i]);
+            frame.dirty[i] = frame.dirty[--frame.dirtyCount];
+            isMerged = true;
+            break;
+        }
+    }
+    if (frame.dirtyCount < maxDirtyRects)
+    {
+        frame.dirty[frame.dirtyCount++] = rect;
+        return;
+    }
+    // out of room, join the one that grows least
+    int best = 0;
+    Sint64 bestGrowth = -1;
+    for (int i = 0; i < frame.dirtyCount; i++)
+    {
+        SDL_Rect united = uniteRects(rect, frame.dirty[i]);
+        Sint64 growth = Sint64(united.w) * united.h - Sint64(frame.dirty[i].w) * frame.dirty[i].h;
+        if (bestGrowth < 0 || growth < bestGrowth)
+        {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    frame.dirty[best] = uniteRects(rect, frame.dirty[best]);
+}
+
+// blitters for one row, dst is the opaque framebuffer
+void blitColorKeyScalar(const Uint32* src, Uint32* dst, const int &count)
+{
+    for (int i = 0; i < count; i++) if (src[i] >> 24) dst[i] = src[i];
+}
+
+// straight alpha over an opaque background, x / 255 rounded as (x + 128 + ((x + 128) >> 8)) >> 8
+void blitAlphaScalar(const Uint32* src, Uint32* dst, const int &count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Uint32 alpha = src[i] >> 24;
+        if (alpha == 0) continue;
+        Uint32 result = 0xFF000000;
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            Uint32 mixed = ((src[i] >> shift) & 0xFF) * alpha + ((dst[i] >> shift) & 0xFF) * (255 - alpha) + 128;
+            result |= ((mixed + (mixed >> 8)) >> 8) << shift;
+        }
+        dst[i] = result;
+    }
+}
+
+#ifdef SIMD_X86
+TARGET_SSE2 void blitColorKeySSE2(const Uint32* src, Uint32* dst, const int &count)
+{
+    const __m128i alphaBits = _mm_set1_epi32(0xFF000000);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+        __m128i isClear = _mm_cmpeq_epi32(_mm_and_si128(s, alphaBits), zero);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_and_si128(isClear, d), _mm_andnot_si128(isClear, s)));
+    }
+    blitColorKeyScalar(src + i, dst + i, count - i);
+}
+
+// blend the four 16-bit channels of two pixels
+TARGET_SSE2 __m128i blendHalfSSE2(const __m128i &s, const __m128i &d)
+{
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m128i mixed = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, alpha), _mm_mullo_epi16(d, _mm_sub_epi16(full, alpha))), round);
+    return _mm_srli_epi16(_mm_add_epi16(mixed, _mm_srli_epi16(mixed, 8)), 8);
+}
+
+TARGET_SSE2 void blitAlphaSSE2(const Uint32* src, Uint32* dst, const int &count)
+{
+    const __m128i alphaBits = _mm_set1_epi32(0xFF000000);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+        __m128i low = blendHalfSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i high = blendHalfSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_packus_epi16(low, high), alphaBits));
+    }
+    blitAlphaScalar(src + i, dst + i, count - i);
+}
+
+TARGET_AVX2 void blitColorKeyAVX2(const Uint32* src, Uint32* dst, const int &count)
+{
+    const __m256i alphaBits = _mm256_set1_epi32(0xFF000000);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*) (dst + i));
+        __m256i isClear = _mm256_cmpeq_epi32(_mm256_and_si256(s, alphaBits), zero);
+        _mm256_storeu_si256((__m256i*) (dst + i), _mm256_blendv_epi8(s, d, isClear));
+    }
+    blitColorKeyScalar(src + i, dst + i, count - i);
+}
+
+TARGET_AVX2 __m256i blendHalfAVX2(const __m256i &s, const __m256i &d)
+{
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m256i mixed = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, alpha),
+                                                      _mm256_mullo_epi16(d, _mm256_sub_epi16(full, alpha))), round);
+    return _mm256_srli_epi16(_mm256_add_epi16(mixed, _mm256_srli_epi16(mixed, 8)), 8);
+}
+
+TARGET_AVX2 void blitAlphaAVX2(const Uint32* src, Uint32* dst, const int &count)
+{
+    const __m256i alphaBits = _mm256_set1_epi32(0xFF000000);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*) (dst + i));
+        // unpack and pack both work within 128-bit lanes, so the pixels come back in order
+        __m256i low = blendHalfAVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i high = blendHalfAVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256((__m256i*) (dst + i), _mm256_or_si256(_mm256_packus_epi16(low, high), alphaBits));
+    }
+    blitAlphaScalar(src + i, dst + i, count - i);
+}
+#endif
+
+void blitRow(const int &kind, const Uint32* src, Uint32* dst, const int &count)
+{
+    if (kind == pixelsOpaque)
+    {
+        SDL_memcpy(dst, src, count * sizeof(Uint32));
+        return;
+    }
+#ifdef SIMD_X86
+    switch (simdLevel)
+    {
+        case simdAVX2:
+            if (kind == pixelsColorKey) blitColorKeyAVX2(src, dst, count);
+            else blitAlphaAVX2(src, dst, count);
+            return;
+        case simdSSE2:
+            if (kind == pixelsColorKey) blitColorKeySSE2(src, dst, count);
+            else blitAlphaSSE2(src, dst, count);
+            return;
+    }
+#endif
+    if (kind == pixelsColorKey) blitColorKeyScalar(src, dst, count);
+    else blitAlphaScalar(src, dst, count);
+}
+
+// clear area to black and draw every command of this frame that reaches into it
+void redrawArea(softwareFrame &frame, const SDL_Rect &area)
+{
+    for (int y = area.y; y < area.y + area.h; y++) SDL_memset4(frame.pixels + y * frame.width + area.x, 0xFF000000, area.w);
+    const softCommand* commands = frame.commands[frame.current];
+    for (int i = 0; i < frame.commandCount[frame.current]; i++)
+    {
+        const softCommand &command = commands[i];
+        SDL_Rect part;
+        if (!intersectRects(command.target, area, part)) continue;
+        int sourceX = command.source.x + part.x - command.target.x;
+        int sourceY = command.source.y + part.y - command.target.y;
+        const Uint8* sourceRow = (const Uint8*) command.pixels->pixels + sourceY * command.pixels->pitch + sourceX * 4;
+        Uint32* targetRow = frame.pixels + part.y * frame.width + part.x;
+        for (int y = 0; y < part.h; y++)
+        {
+            blitRow(command.kind, (const Uint32*) sourceRow, targetRow, part.w);
+            sourceRow += command.pixels->pitch;
+            targetRow += frame.width;
+        }
+    }
+}
+
+void finishSoftwareFrame(softwareFrame &frame, SDL_Renderer* &renderer)
+{
+    if (!frame.isActive) return;
+    int current = frame.current;
+    int previous = current ^ 1;
+    hashCommands(frame, current);
+
+    // anything drawn now but not last frame, or last frame but not now, has to be redrawn
+    frame.dirtyCount = 0;
+    if (frame.isFullRedraw)
+    {
+        SDL_Rect screen = {0, 0, frame.width, frame.height};
+        addDirtyRect(frame, screen);
+        frame.isFullRedraw = false;
+    }
+    else
+    {
+        for (int i = 0; i < frame.commandCount[current]; i++)
+        {
+            if (!hasCommand(frame, previous, frame.commands[current][i])) addDirtyRect(frame, frame.commands[current][i].target);
+        }
+        for (int i = 0; i < frame.commandCount[previous]; i++)
+        {
+            if (!hasCommand(frame, current, frame.commands[previous][i])) addDirtyRect(frame, frame.commands[previous][i].target);
+        }
+    }
+
+    for (int i = 0; i < frame.dirtyCount; i++)
+    {
+        const SDL_Rect &area = frame.dirty[i];
+        redrawArea(frame, area);
+        SDL_UpdateTexture(frame.texture, &area, frame.pixels + area.y * frame.width + area.x, frame.width * sizeof(Uint32));
+    }
+    SDL_RenderCopy(renderer, frame.texture, NULL, NULL);
+}
+
+#endif // softrender_h
@@ -0,0 +1,230 @@
+#ifndef stretch_h
+#define stretch_h
+
+// WSOLA time-stretch for slowed down practice playback, pitch stays the same. Hann windowed segments
+// of the song overlap by half; each next segment is taken near where the slowed clock says it should
+// start, shifted to where it best continues the previous one so the splice does not click or phase.
+// Works on 16-bit interleaved samples, mono or stereo.
+const int stretchWindow = 1024;
+const int stretchHop = stretchWindow / 2;
+// how far a segment may move from its nominal position, searched coarsely then refined
+const int stretchSearch = 256;
+const int stretchCoarseStep = 4;
+const int maxStretchChannels = 2;
+
+const int minPlaybackRate = 50;
+const int maxPlaybackRate = 100;
+
+struct timeStretch
+{
+    // percent of normal speed, 100 plays the song untouched
+    int rate;
+    int channels;
+    float window[stretchWindow];
+    // second half of the last segment, added to the first half of the next one
+    float overlap[stretchHop * maxStretchChannels];
+    // last synthesized hop and how many of its frames the mixer has taken
+    Sint16 output[stretchHop * maxStretchChannels];
+    int outputUsed;
+
+    // input frame the hops are counted from, set on every reset so positions never drift
+    Sint64 baseInput;
+    Sint64 hops;
+    // where the last segment naturally continues, -1 right after a reset
+    Sint64 nextInput;
+    // output frame (since the song start) the next callback should ask for, anything else is a seek
+    Sint64 expectedFrame;
+
+    timeStretch();
+};
+
+// prepare the window for channels, false if the format cannot be stretched
+bool startStretch(timeStretch &stretch, const int &rate, const int &channels);
+
+// forget the last segment and continue from outputFrame of the stretched song
+void resetStretch(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames, const Sint64 &outputFrame);
+
+// write frames of stretched song into stream, returns false once the song has run out
+bool writeStretched(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames, Sint16* stream, const int &frames);
+
+timeStretch::timeStretch()
+{
+    rate = 100;
+    channels = 0;
+    outputUsed = stretchHop;
+    baseInput = 0;
+    hops = 0;
+    nextInput = -1;
+    expectedFrame = -1;
+}
+
+bool startStretch(timeStretch &stretch, const int &rate, const int &channels)
+{
+    stretch.rate = 100;
+    if (rate >= 100) return true;
+    if (channels < 1 || channels > maxStretchChannels) return false;
+    stretch.channels = channels;
+    // periodic Hann, two windows half a window apart add up to exactly one
+    for (int i = 0; i < stretchWindow; i++) stretch.window[i] = float(0.5 - 0.5 * SDL_cos(2 * M_PI * i / stretchWindow));
+    stretch.rate = rate < minPlaybackRate ? minPlaybackRate : rate;
+    stretch.expectedFrame = -1;
+    // the search kernels are picked from the audio thread, detect here so it only reads the result
+    detectSimd();
+    return true;
+}
+
+// correlation of two runs of interleaved samples, halved first so madd can not overflow
+float correlateScalar(const Sint16* a, const Sint16* b, const int &samples)
+{
+    Sint64 sum = 0;
+    for (int i = 0; i < samples; i++) sum += (a[i] >> 1) * (b[i] >> 1);
+    return float(sum);
+}
+
+#ifdef SIMD_X86
+TARGET_SSE2 float correlateSSE2(const Sint16* a, const Sint16* b, const int &samples)
+{
+    __m128 sum = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i x = _mm_srai_epi16(_mm_loadu_si128((const __m128i*) (a + i)), 1);
+        __m128i y = _mm_srai_epi16(_mm_loadu_si128((const __m128i*) (b + i)), 1);
+        sum = _mm_add_ps(sum, _mm_cvtepi32_ps(_mm_madd_epi16(x, y)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    float result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < samples; i++) result += float((a[i] >> 1) * (b[i] >> 1));
+    return result;
+}
+
+TARGET_AVX2 float correlateAVX2(const Sint16* a, const Sint16* b, const int &samples)
+{
+    __m256 sum = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= samples; i += 16)
+    {
+        __m256i x = _mm256_srai_epi16(_mm256_loadu_si256((const __m256i*) (a + i)), 1);
+        __m256i y = _mm256_srai_epi16(_mm256_loadu_si256((const __m256i*) (b + i)), 1);
+        sum = _mm256_add_ps(sum, _mm256_cvtepi32_ps(_mm256_madd_epi16(x, y)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, sum);
+    float result = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    for (; i < samples; i++) result += float((a[i] >> 1) * (b[i] >> 1));
+    return result;
+}
+#endif
+
+float correlate(const Sint16* a, const Sint16* b, const int &samples)
+{
+#ifdef SIMD_X86
+    switch (simdLevel)
+    {
+        case simdAVX2:
+            return correlateAVX2(a, b, samples);
+        case simdSSE2:
+            return correlateSSE2(a, b, samples);
+    }
+#endif
+    return correlateScalar(a, b, samples);
+}
+
+// start of the segment near nominal that best continues the last one
+Sint64 bestSegment(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames, const Sint64 &nominal)
+{
+    if (stretch.nextInput < 0 || stretch.nextInput + stretchHop > songFrames) return nominal;
+    Sint64 low = nominal - stretchSearch;
+    Sint64 high = nominal + stretchSearch;
+    if (low < 0) low = 0;
+    if (high > songFrames - stretchWindow) high = songFrames - stretchWindow;
+    if (high < low) return nominal;
+
+    const Sint16* target = song + stretch.nextInput * stretch.channels;
+    int samples = stretchHop * stretch.channels;
+    Sint64 best = low;
+    float bestScore = -1e30f;
+    for (Sint64 candidate = low; candidate <= high; candidate += stretchCoarseStep)
+    {
+        float score = correlate(song + candidate * stretch.channels, target, samples);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+    Sint64 coarse = best;
+    for (Sint64 candidate = coarse - stretchCoarseStep + 1; candidate < coarse + stretchCoarseStep; candidate++)
+    {
+        if (candidate < low || candidate > high || candidate == coarse) continue;
+        float score = correlate(song + candidate * stretch.channels, target, samples);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+// overlap-add the next segment, false when the song has no full segment left
+bool synthesizeHop(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames)
+{
+    Sint64 nominal = stretch.baseInput + stretch.hops * stretchHop * stretch.rate / 100;
+    if (nominal + stretchWindow > songFrames) return false;
+    Sint64 start = bestSegment(stretch, song, songFrames, nominal);
+    int channels = stretch.channels;
+    const Sint16* segment = song + start * channels;
+    for (int i = 0; i < stretchHop; i++)
+    {
+        float rise = stretch.window[i];
+        float fall = stretch.window[i + stretchHop];
+        for (int c = 0; c < channels; c++)
+        {
+            int sample = i * channels + c;
+            float value = stretch.overlap[sample] + rise * segment[sample];
+            if (value > 32767) value = 32767;
+            if (value < -32768) value = -32768;
+            stretch.output[sample] = Sint16(value);
+            stretch.overlap[sample] = fall * segment[stretchHop * channels + sample];
+        }
+    }
+    stretch.nextInput = start + stretchHop;
+    stretch.hops++;
+    stretch.outputUsed = 0;
+    return true;
+}
+
+void resetStretch(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames, const Sint64 &outputFrame)
+{
+    // hops start on multiples of stretchHop, synthesize the one outputFrame falls in and skip its beginning
+    Sint64 hop = outputFrame / stretchHop;
+    stretch.baseInput = hop * stretchHop * stretch.rate / 100;
+    stretch.hops = 0;
+    stretch.nextInput = -1;
+    for (int i = 0; i < stretchHop * stretch.channels; i++) stretch.overlap[i] = 0;
+    stretch.outputUsed = stretchHop;
+    stretch.expectedFrame = outputFrame;
+    int skip = int(outputFrame - hop * stretchHop);
+    if (skip > 0 && synthesizeHop(stretch, song, songFrames)) stretch.outputUsed = skip;
+}
+
+bool writeStretched(timeStretch &stretch, const Sint16* song, const Sint64 &songFrames, Sint16* stream, const int &frames)
+{
+    int channels = stretch.channels;
+    int written = 0;
+    while (written < frames)
+    {
+        if (stretch.outputUsed == stretchHop && !synthesizeHop(stretch, song, songFrames)) return false;
+        int count = stretchHop - stretch.outputUsed;
+        if (count > frames - written) count = frames - written;
+        SDL_memcpy(stream + written * channels, stretch.output + stretch.outputUsed * channels, count * channels * sizeof(Sint16));
+        stretch.outputUsed += count;
+        written += count;
+    }
+    stretch.expectedFrame += frames;
+    return true;
+}
+
+#endif // stretch_h
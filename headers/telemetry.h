@@ -0,0 +1,247 @@
+#ifndef telemetry_h
+#define telemetry_h
+
+// Signed timing of every judged key press, negative is early and positive late, in ms from where
+// the gem crosses perfectY. Samples go into a fixed buffer during play and are only summed up on
+// the results screen, so recording one is a few stores.
+const int maxTimingSamples = 8192;
+// histogram bars across the hit window
+const int timingBuckets = 24;
+
+struct timingSample
+{
+    Sint16 offset;
+    Uint8 lane;
+    Uint8 result;
+};
+
+struct timingTelemetry
+{
+    timingSample samples[maxTimingSamples];
+    int count;
+    // presses that found no note in their lane, and samples that did not fit
+    int ghostPresses;
+    int dropped;
+
+    timingTelemetry();
+};
+
+struct timingStats
+{
+    int hits;
+    int misses;
+    int early;
+    int late;
+    float mean;
+    float deviation;
+};
+
+struct timingSummary
+{
+    // index 5 is every lane together
+    timingStats lanes[6];
+    int histogram[timingBuckets];
+    int histogramPeak;
+    // half the hit window at the level's speed, the histogram spans -window to +window
+    int window;
+};
+
+timingTelemetry levelTiming;
+
+// forget the last level's samples
+void clearTelemetry(timingTelemetry &t);
+
+// keep the judgement of a key press in lane, offset is noTimingOffset when there was no note to time
+void recordTiming(timingTelemetry &t, const int &lane, const int &result, const Sint32 &offset);
+
+// per lane mean, standard deviation and early/late split of the hits, and the histogram of all hits
+void summarizeTiming(const timingTelemetry &t, const int &speed, timingSummary &summary);
+
+// write samples and summary to file as CSV or JSON, format is one of timingExports
+void exportTiming(const timingTelemetry &t, const timingSummary &summary, const int &format, const char* file);
+
+// histogram bars with perfect timing marked, in the box at x, y
+void renderTimingHistogram(const timingSummary &summary, SDL_Renderer* &renderer, const int &x, const int &y,
+                           const int &width, const int &height);
+
+timingTelemetry::timingTelemetry()
+{
+    count = 0;
+    ghostPresses = 0;
+    dropped = 0;
+}
+
+void clearTelemetry(timingTelemetry &t)
+{
+    t.count = 0;
+    t.ghostPresses = 0;
+    t.dropped = 0;
+}
+
+void recordTiming(timingTelemetry &t, const int &lane, const int &result, const Sint32 &offset)
+{
+    if (offset == noTimingOffset)
+    {
+        t.ghostPresses++;
+        return;
+    }
+    if (t.count == maxTimingSamples)
+    {
+        t.dropped++;
+        return;
+    }
+    timingSample &sample = t.samples[t.count++];
+    // an early miss can be a whole note fall off, that still fits
+    sample.offset = Sint16(offset < -32768 ? -32768 : (offset > 32767 ? 32767 : offset));
+    sample.lane = Uint8(lane);
+    sample.result = Uint8(result);
+}
+
+void addTimingSample(timingStats &stats, double &sum, double &square, const timingSample &sample)
+{
+    if (sample.result != noteHit)
+    {
+        stats.misses++;
+        return;
+    }
+    stats.hits++;
+    if (sample.offset < 0) stats.early++;
+    if (sample.offset > 0) stats.late++;
+    sum += sample.offset;
+    square += double(sample.offset) * sample.offset;
+}
+
+void summarizeTiming(const timingTelemetry &t, const int &speed, timingSummary &summary)
+{
+    // sums in double, a long song has thousands of samples
+    double sums[6];
+    double squares[6];
+    for (int i = 0; i < 6; i++)
+    {
+        timingStats &stats = summary.lanes[i];
+        stats.hits = 0;
+        stats.misses = 0;
+        stats.early = 0;
+        stats.late = 0;
+        stats.mean = 0;
+        stats.deviation = 0;
+        sums[i] = 0;
+        squares[i] = 0;
+    }
+    for (int b = 0; b < timingBuckets; b++) summary.histogram[b] = 0;
+    summary.histogramPeak = 0;
+    summary.window = int(hitBox / 2 / noteSpeed[speed] + 0.5f);
+    if (summary.window < 1) summary.window = 1;
+
+    for (int i = 0; i < t.count; i++)
+    {
+        const timingSample &sample = t.samples[i];
+        int lane = sample.lane < 5 ? sample.lane : 5;
+        addTimingSample(summary.lanes[lane], sums[lane], squares[lane], sample);
+        if (lane != 5) addTimingSample(summary.lanes[5], sums[5], squares[5], sample);
+        if (sample.result == noteHit)
+        {
+            int bucket = (sample.offset + summary.window) * timingBuckets / (2 * summary.window);
+            if (bucket < 0) bucket = 0;
+            if (bucket >= timingBuckets) bucket = timingBuckets - 1;
+            summary.histogram[bucket]++;
+            if (summary.histogram[bucket] > summary.histogramPeak) summary.histogramPeak = summary.histogram[bucket];
+        }
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        timingStats &stats = summary.lanes[i];
+        if (stats.hits == 0) continue;
+        double mean = sums[i] / stats.hits;
+        double variance = squares[i] / stats.hits - mean * mean;
+        stats.mean = float(mean);
+        stats.deviation = float(variance > 0 ? SDL_sqrt(variance) : 0);
+    }
+}
+
+const char* timingLaneNames[6] = {"green", "red", "yellow", "blue", "orange", "all"};
+
+void exportTiming(const timingTelemetry &t, const timingSummary &summary, const int &format, const char* file)
+{
+    if (format == timingExportOff) return;
+    std::ofstream outFile(file);
+    if (!outFile)
+    {
+        logSDLError(std::cout, "Could not write the timing export!", false, none);
+        return;
+    }
+    if (format == timingExportCsv)
+    {
+        // samples first, one per line, the summary follows as its own table
+        outFile << "index,lane,result,offset" << std::endl;
+        for (int i = 0; i < t.count; i++)
+        {
+            const timingSample &sample = t.samples[i];
+            outFile << i << ',' << timingLaneNames[sample.lane < 5 ? sample.lane : 5] << ','
+                    << (sample.result == noteHit ? "hit" : "miss") << ',' << sample.offset << std::endl;
+        }
+        outFile << std::endl << "lane,hits,misses,early,late,mean,deviation" << std::endl;
+        for (int i = 0; i < 6; i++)
+        {
+            const timingStats &stats = summary.lanes[i];
+            outFile << timingLaneNames[i] << ',' << stats.hits << ',' << stats.misses << ',' << stats.early << ','
+                    << stats.late << ',' << stats.mean << ',' << stats.deviation << std::endl;
+        }
+    }
+    else
+    {
+        outFile << "{" << std::endl << "  \"window\": " << summary.window << ',' << std::endl;
+        outFile << "  \"ghostPresses\": " << t.ghostPresses << ',' << std::endl;
+        outFile << "  \"dropped\": " << t.dropped << ',' << std::endl;
+        outFile << "  \"histogram\": [";
+        for (int b = 0; b < timingBuckets; b++) outFile << (b > 0 ? ", " : "") << summary.histogram[b];
+        outFile << "]," << std::endl << "  \"lanes\": {" << std::endl;
+        for (int i = 0; i < 6; i++)
+        {
+            const timingStats &stats = summary.lanes[i];
+            outFile << "    \"" << timingLaneNames[i] << "\": {\"hits\": " << stats.hits << ", \"misses\": " << stats.misses
+                    << ", \"early\": " << stats.early << ", \"late\": " << stats.late << ", \"mean\": " << stats.mean
+                    << ", \"deviation\": " << stats.deviation << '}' << (i < 5 ? "," : "") << std::endl;
+        }
+        outFile << "  }," << std::endl << "  \"samples\": [";
+        for (int i = 0; i < t.count; i++)
+        {
+            const timingSample &sample = t.samples[i];
+            outFile << (i > 0 ? "," : "") << std::endl << "    {\"lane\": " << int(sample.lane) << ", \"hit\": "
+                    << (sample.result == noteHit ? "true" : "false") << ", \"offset\": " << sample.offset << '}';
+        }
+        outFile << std::endl << "  ]" << std::endl << "}" << std::endl;
+    }
+    std::cout << "Timing of " << t.count << " presses written to " << file << std::endl;
+}
+
+void renderTimingHistogram(const timingSummary &summary, SDL_Renderer* &renderer, const int &x, const int &y,
+                           const int &width, const int &height)
+{
+    SDL_Rect bars[timingBuckets];
+    int barCount = 0;
+    int barWidth = width / timingBuckets;
+    if (summary.histogramPeak > 0)
+    {
+        for (int b = 0; b < timingBuckets; b++)
+        {
+            if (summary.histogram[b] == 0) continue;
+            SDL_Rect &bar = bars[barCount++];
+            bar.w = barWidth - 2;
+            bar.h = summary.histogram[b] * height / summary.histogramPeak;
+            if (bar.h < 1) bar.h = 1;
+            bar.x = x + b * barWidth + 1;
+            bar.y = y + height - bar.h;
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderFillRects(renderer, bars, barCount);
+    // baseline, and perfect timing in the middle
+    SDL_Rect baseline = {x, y + height, barWidth * timingBuckets, 2};
+    SDL_Rect perfect = {x + barWidth * timingBuckets / 2 - 1, y, 2, height};
+    SDL_RenderFillRect(renderer, &baseline);
+    SDL_SetRenderDrawColor(renderer, 0x40, 0xC0, 0x40, 0xFF);
+    SDL_RenderFillRect(renderer, &perfect);
+}
+
+#endif // telemetry_h
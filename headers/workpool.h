@@ -0,0 +1,107 @@
+#ifndef workpool_h
+#define workpool_h
+
+// Work stealing thread pool of the offline tools, also used by the game to rate its charts at
+// startup. Jobs are indices into whatever the tool has
+// to get through. Every worker starts with an even slice and takes indices from the front of
+// it one at a time, as jobs can differ a lot in length. A worker that runs dry steals the back
+// half of what another worker has left, so long jobs bunched in one slice get spread out
+// without anyone handing out work centrally.
+const int maxWorkers = 64;
+
+struct workRange
+{
+    SDL_SpinLock lock;
+    int next;
+    int end;
+};
+
+struct workPool
+{
+    workRange ranges[maxWorkers];
+    int workerCount;
+    void (*job)(const int &index, const int &worker);
+};
+
+struct workerStart
+{
+    workPool* pool;
+    int worker;
+};
+
+// one worker per CPU, capped at maxWorkers
+void startWorkPool(workPool &pool);
+
+// run job on every index in [0, count) on all workers, the calling thread is worker 0
+void runParallel(workPool &pool, const int &count, void (*job)(const int &index, const int &worker));
+
+void startWorkPool(workPool &pool)
+{
+    pool.workerCount = SDL_GetCPUCount();
+    if (pool.workerCount < 1) pool.workerCount = 1;
+    if (pool.workerCount > maxWorkers) pool.workerCount = maxWorkers;
+}
+
+bool takeWork(workPool &pool, const int &worker, int &index)
+{
+    workRange &own = pool.ranges[worker];
+    SDL_AtomicLock(&own.lock);
+    bool isTaken = own.next < own.end;
+    if (isTaken) index = own.next++;
+    SDL_AtomicUnlock(&own.lock);
+    if (isTaken) return true;
+
+    for (int step = 1; step < pool.workerCount; step++)
+    {
+        workRange &victim = pool.ranges[(worker + step) % pool.workerCount];
+        SDL_AtomicLock(&victim.lock);
+        int left = victim.end - victim.next;
+        int stolenEnd = victim.end;
+        int stolenBegin = stolenEnd - (left + 1) / 2;
+        if (left > 0) victim.end = stolenBegin;
+        SDL_AtomicUnlock(&victim.lock);
+        if (left <= 0) continue;
+        // the first stolen index is run right away, the rest can be stolen from us in turn
+        SDL_AtomicLock(&own.lock);
+        own.next = stolenBegin + 1;
+        own.end = stolenEnd;
+        SDL_AtomicUnlock(&own.lock);
+        index = stolenBegin;
+        return true;
+    }
+    // work only ever moves between ranges, whatever is left is already being run
+    return false;
+}
+
+int workerThread(void* data)
+{
+    workerStart* start = (workerStart*) data;
+    int index;
+    while (takeWork(*start->pool, start->worker, index)) start->pool->job(index, start->worker);
+    return 0;
+}
+
+void runParallel(workPool &pool, const int &count, void (*job)(const int &index, const int &worker))
+{
+    pool.job = job;
+    for (int w = 0; w < pool.workerCount; w++)
+    {
+        pool.ranges[w].lock = 0;
+        pool.ranges[w].next = int(Sint64(count) * w / pool.workerCount);
+        pool.ranges[w].end = int(Sint64(count) * (w + 1) / pool.workerCount);
+    }
+    workerStart starts[maxWorkers];
+    SDL_Thread* threads[maxWorkers];
+    for (int w = 0; w < pool.workerCount; w++)
+    {
+        starts[w].pool = &pool;
+        starts[w].worker = w;
+        threads[w] = NULL;
+        if (w > 0) threads[w] = SDL_CreateThread(workerThread, "worker", &starts[w]);
+    }
+    // a worker that could not start leaves its slice to be stolen
+    workerThread(&starts[0]);
+    for (int w = 1; w < pool.workerCount; w++) if (threads[w] != NULL) SDL_WaitThread(threads[w], NULL);
+}
+
+#endif // workpool_h
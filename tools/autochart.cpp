@@ -0,0 +1,642 @@
+// Drafts a chart from a song: onsets are found with a spectral flux detector, the tempo and beat
+// phase from the onset curve, then the onsets are snapped to the beat grid, sustained ones turned
+// into holds and spread over the lanes by how bright they sound. Run from anywhere:
+//     autochart [-s speed] [-l lanes] [-d subdivision] song...
+// Each song's draft is written next to it as Chart.draft.txt in the Chart.txt format, rename it
+// to Chart.txt to play it. Build with SDL2 and SDL2_mixer, e.g.
+//     g++ -O2 tools/autochart.cpp -Iheaders $(sdl2-config --cflags --libs) -lSDL2_mixer -o autochart
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include "game.h"
+#include "simd.h"
+#include "workpool.h"
+
+// songs are analysed as 44.1 kHz mono, 2048 sample frames every 10 ms
+const int analysisRate = 44100;
+const int fftSize = 2048;
+const int fftBins = fftSize / 2 + 1;
+const int hopSize = 441;
+const float msPerFrame = 1000.0f * hopSize / analysisRate;
+// frames per job, each job runs one extra transform for the frame before its first
+const int blockFrames = 256;
+
+// onset picking, in frames: a peak has to be the largest within peakRadius and stand above
+// the mean within meanRadius by thresholdScale deviations of the whole song
+const int peakRadius = 3;
+const int meanRadius = 20;
+const float thresholdScale = 0.5f;
+// tempo search range in beats per minute, and the tempo preferred when two fit equally well
+const float minTempo = 70;
+const float maxTempo = 180;
+const float preferredTempo = 120;
+// a note becomes a hold when the sound keeps this much of its onset energy for at least a beat
+const float sustainRatio = 0.6f;
+
+struct songFeatures
+{
+    std::vector<float> samples;
+    int frameCount;
+    // spectral flux of the compressed magnitudes, summed magnitude and brightness per frame
+    std::vector<float> flux;
+    std::vector<float> energy;
+    std::vector<float> centroid;
+};
+
+struct draftNote
+{
+    float time;
+    int frame;
+    float strength;
+    int lane;
+    Uint32 heldTime;
+};
+
+// the song being analysed, the jobs are blocks of its frames
+songFeatures song;
+
+float hannWindow[fftSize];
+// twiddles of the stage with half size h are at [h, 2h)
+float twiddleRe[fftSize];
+float twiddleIm[fftSize];
+int bitReverse[fftSize];
+
+struct fftScratch
+{
+    float re[fftSize];
+    float im[fftSize];
+    float magnitude[2][fftBins];
+};
+
+fftScratch workerScratch[maxWorkers];
+
+void prepareFft()
+{
+    for (int i = 0; i < fftSize; i++)
+    {
+        hannWindow[i] = float(0.5 - 0.5 * SDL_cos(2 * M_PI * i / fftSize));
+        int reversed = 0;
+        for (int bit = 1, high = fftSize >> 1; bit < fftSize; bit <<= 1, high >>= 1) if (i & bit) reversed |= high;
+        bitReverse[i] = reversed;
+    }
+    for (int half = 1; half < fftSize; half <<= 1)
+    {
+        for (int j = 0; j < half; j++)
+        {
+            twiddleRe[half + j] = float(SDL_cos(-M_PI * j / half));
+            twiddleIm[half + j] = float(SDL_sin(-M_PI * j / half));
+        }
+    }
+}
+
+// butterflies of one stage for j in [first, half) of every block
+void fftStageScalar(float* re, float* im, const int &half, const int &first)
+{
+    for (int block = 0; block < fftSize; block += 2 * half)
+    {
+        for (int j = first; j < half; j++)
+        {
+            float wr = twiddleRe[half + j];
+            float wi = twiddleIm[half + j];
+            int a = block + j;
+            int b = a + half;
+            float tr = re[b] * wr - im[b] * wi;
+            float ti = re[b] * wi + im[b] * wr;
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+// windowed magnitudes, compressed to the fourth root of the power, their rise over previous
+// summed into flux, and the plain and bin weighted sums for energy and brightness
+void spectrumScalar(const float* re, const float* im, float* magnitude, const float* previous, int i,
+                    float &flux, float &sum, float &weighted)
+{
+    for (; i < fftBins; i++)
+    {
+        float value = SDL_sqrtf(SDL_sqrtf(re[i] * re[i] + im[i] * im[i]));
+        magnitude[i] = value;
+        float rise = value - previous[i];
+        if (rise > 0) flux += rise;
+        sum += value;
+        weighted += value * i;
+    }
+}
+
+#ifdef SIMD_X86
+TARGET_SSE2 int fftStageSSE2(float* re, float* im, const int &half)
+{
+    for (int block = 0; block < fftSize; block += 2 * half)
+    {
+        for (int j = 0; j < half; j += 4)
+        {
+            __m128 wr = _mm_loadu_ps(twiddleRe + half + j);
+            __m128 wi = _mm_loadu_ps(twiddleIm + half + j);
+            float* aRe = re + block + j;
+            float* aIm = im + block + j;
+            __m128 br = _mm_loadu_ps(aRe + half);
+            __m128 bi = _mm_loadu_ps(aIm + half);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+            __m128 ar = _mm_loadu_ps(aRe);
+            __m128 ai = _mm_loadu_ps(aIm);
+            _mm_storeu_ps(aRe + half, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(aIm + half, _mm_sub_ps(ai, ti));
+            _mm_storeu_ps(aRe, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(aIm, _mm_add_ps(ai, ti));
+        }
+    }
+    return half;
+}
+
+TARGET_AVX2 int fftStageAVX2(float* re, float* im, const int &half)
+{
+    for (int block = 0; block < fftSize; block += 2 * half)
+    {
+        for (int j = 0; j < half; j += 8)
+        {
+            __m256 wr = _mm256_loadu_ps(twiddleRe + half + j);
+            __m256 wi = _mm256_loadu_ps(twiddleIm + half + j);
+            float* aRe = re + block + j;
+            float* aIm = im + block + j;
+            __m256 br = _mm256_loadu_ps(aRe + half);
+            __m256 bi = _mm256_loadu_ps(aIm + half);
+            __m256 tr = _mm256_sub_ps(_mm256_mul_ps(br, wr), _mm256_mul_ps(bi, wi));
+            __m256 ti = _mm256_add_ps(_mm256_mul_ps(br, wi), _mm256_mul_ps(bi, wr));
+            __m256 ar = _mm256_loadu_ps(aRe);
+            __m256 ai = _mm256_loadu_ps(aIm);
+            _mm256_storeu_ps(aRe + half, _mm256_sub_ps(ar, tr));
+            _mm256_storeu_ps(aIm + half, _mm256_sub_ps(ai, ti));
+            _mm256_storeu_ps(aRe, _mm256_add_ps(ar, tr));
+            _mm256_storeu_ps(aIm, _mm256_add_ps(ai, ti));
+        }
+    }
+    return half;
+}
+
+// sum of the four lanes of a vector
+TARGET_SSE2 float sumSSE2(const __m128 &v)
+{
+    __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+TARGET_SSE2 int spectrumSSE2(const float* re, const float* im, float* magnitude, const float* previous,
+                             float &flux, float &sum, float &weighted)
+{
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vStep = _mm_set1_ps(4);
+    __m128 vIndex = _mm_setr_ps(0, 1, 2, 3);
+    __m128 vFlux = vZero;
+    __m128 vSum = vZero;
+    __m128 vWeighted = vZero;
+    int i = 0;
+    for (; i + 4 <= fftBins; i += 4)
+    {
+        __m128 r = _mm_loadu_ps(re + i);
+        __m128 m = _mm_loadu_ps(im + i);
+        __m128 value = _mm_sqrt_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m))));
+        _mm_storeu_ps(magnitude + i, value);
+        vFlux = _mm_add_ps(vFlux, _mm_max_ps(_mm_sub_ps(value, _mm_loadu_ps(previous + i)), vZero));
+        vSum = _mm_add_ps(vSum, value);
+        vWeighted = _mm_add_ps(vWeighted, _mm_mul_ps(value, vIndex));
+        vIndex = _mm_add_ps(vIndex, vStep);
+    }
+    flux += sumSSE2(vFlux);
+    sum += sumSSE2(vSum);
+    weighted += sumSSE2(vWeighted);
+    return i;
+}
+
+TARGET_AVX2 int spectrumAVX2(const float* re, const float* im, float* magnitude, const float* previous,
+                             float &flux, float &sum, float &weighted)
+{
+    const __m256 vZero = _mm256_setzero_ps();
+    const __m256 vStep = _mm256_set1_ps(8);
+    __m256 vIndex = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 vFlux = vZero;
+    __m256 vSum = vZero;
+    __m256 vWeighted = vZero;
+    int i = 0;
+    for (; i + 8 <= fftBins; i += 8)
+    {
+        __m256 r = _mm256_loadu_ps(re + i);
+        __m256 m = _mm256_loadu_ps(im + i);
+        __m256 value = _mm256_sqrt_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m))));
+        _mm256_storeu_ps(magnitude + i, value);
+        vFlux = _mm256_add_ps(vFlux, _mm256_max_ps(_mm256_sub_ps(value, _mm256_loadu_ps(previous + i)), vZero));
+        vSum = _mm256_add_ps(vSum, value);
+        vWeighted = _mm256_add_ps(vWeighted, _mm256_mul_ps(value, vIndex));
+        vIndex = _mm256_add_ps(vIndex, vStep);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, vFlux);
+    for (int l = 0; l < 8; l++) flux += lanes[l];
+    _mm256_storeu_ps(lanes, vSum);
+    for (int l = 0; l < 8; l++) sum += lanes[l];
+    _mm256_storeu_ps(lanes, vWeighted);
+    for (int l = 0; l < 8; l++) weighted += lanes[l];
+    return i;
+}
+#endif
+
+// in place, split real and imaginary parts so every stage from four wide runs in vectors
+void fft(float* re, float* im)
+{
+    for (int i = 0; i < fftSize; i++)
+    {
+        int j = bitReverse[i];
+        if (j > i)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (int half = 1; half < fftSize; half <<= 1)
+    {
+        int first = 0;
+#ifdef SIMD_X86
+        switch (simdLevel)
+        {
+            case simdAVX2:
+                if (half >= 8) first = fftStageAVX2(re, im, half);
+                else if (half >= 4) first = fftStageSSE2(re, im, half);
+                break;
+            case simdSSE2:
+                if (half >= 4) first = fftStageSSE2(re, im, half);
+                break;
+        }
+#endif
+        if (first < half) fftStageScalar(re, im, half, first);
+    }
+}
+
+void spectrum(const float* re, const float* im, float* magnitude, const float* previous, float &flux, float &sum,
+              float &weighted)
+{
+    flux = 0;
+    sum = 0;
+    weighted = 0;
+    int i = 0;
+#ifdef SIMD_X86
+    switch (simdLevel)
+    {
+        case simdAVX2:
+            i = spectrumAVX2(re, im, magnitude, previous, flux, sum, weighted);
+            break;
+        case simdSSE2:
+            i = spectrumSSE2(re, im, magnitude, previous, flux, sum, weighted);
+            break;
+    }
+#endif
+    spectrumScalar(re, im, magnitude, previous, i, flux, sum, weighted);
+}
+
+// frame centred on sample frame * hopSize, silence past either end of the song
+void transformFrame(fftScratch &scratch, const int &frame)
+{
+    Sint64 start = Sint64(frame) * hopSize - fftSize / 2;
+    Sint64 count = song.samples.size();
+    for (int i = 0; i < fftSize; i++)
+    {
+        Sint64 at = start + i;
+        scratch.re[i] = at >= 0 && at < count ? song.samples[at] * hannWindow[i] : 0;
+        scratch.im[i] = 0;
+    }
+    fft(scratch.re, scratch.im);
+}
+
+void analyseBlock(const int &index, const int &worker)
+{
+    fftScratch &scratch = workerScratch[worker];
+    int first = index * blockFrames;
+    int last = std::min(first + blockFrames, song.frameCount);
+    int current = 0;
+    // the frame before the block only gives the magnitudes the first flux is taken against
+    float flux;
+    float sum;
+    float weighted;
+    if (first > 0)
+    {
+        transformFrame(scratch, first - 1);
+        spectrum(scratch.re, scratch.im, scratch.magnitude[current], scratch.magnitude[1 - current], flux, sum, weighted);
+    }
+    else std::fill(scratch.magnitude[current], scratch.magnitude[current] + fftBins, 0.0f);
+    for (int frame = first; frame < last; frame++)
+    {
+        transformFrame(scratch, frame);
+        spectrum(scratch.re, scratch.im, scratch.magnitude[1 - current], scratch.magnitude[current], flux, sum, weighted);
+        current = 1 - current;
+        song.flux[frame] = flux;
+        song.energy[frame] = sum;
+        song.centroid[frame] = sum > 0 ? weighted / sum : 0;
+    }
+}
+
+// song as 44.1 kHz mono floats, the mixer's decoders are run against a device that is never heard
+bool decodeSong(const char* path, std::vector<float> &samples)
+{
+    Mix_Chunk* chunk = Mix_LoadWAV(path);
+    if (chunk == NULL)
+    {
+        std::cout << "Could not decode " << path << ": " << Mix_GetError() << std::endl;
+        return false;
+    }
+    const Sint16* pcm = (const Sint16*) chunk->abuf;
+    samples.resize(chunk->alen / sizeof(Sint16));
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = pcm[i] * (1.0f / 32768);
+    Mix_FreeChunk(chunk);
+    return true;
+}
+
+// frames where the flux peaks well above its surroundings
+void pickOnsets(std::vector<draftNote> &onsets)
+{
+    const std::vector<float> &flux = song.flux;
+    int count = song.frameCount;
+    double total = 0;
+    double squares = 0;
+    for (int t = 0; t < count; t++)
+    {
+        total += flux[t];
+        squares += double(flux[t]) * flux[t];
+    }
+    double mean = count > 0 ? total / count : 0;
+    float deviation = float(SDL_sqrt(std::max(0.0, squares / std::max(count, 1) - mean * mean)));
+
+    // running sum for the local means
+    std::vector<double> prefix(count + 1, 0.0);
+    for (int t = 0; t < count; t++) prefix[t + 1] = prefix[t] + flux[t];
+    for (int t = 0; t < count; t++)
+    {
+        bool isPeak = true;
+        for (int d = -peakRadius; d <= peakRadius && isPeak; d++)
+        {
+            int u = t + d;
+            if (u >= 0 && u < count && u != t && (flux[u] > flux[t] || (flux[u] == flux[t] && u < t))) isPeak = false;
+        }
+        if (!isPeak) continue;
+        int low = std::max(0, t - meanRadius);
+        int high = std::min(count, t + meanRadius + 1);
+        float localMean = float((prefix[high] - prefix[low]) / (high - low));
+        if (flux[t] < localMean + thresholdScale * deviation) continue;
+        draftNote onset;
+        onset.time = t * msPerFrame;
+        onset.frame = t;
+        onset.strength = flux[t] - localMean;
+        onset.lane = 0;
+        onset.heldTime = 0;
+        onsets.push_back(onset);
+    }
+}
+
+// beat length in ms and the time of one beat, from the autocorrelation of the onset curve
+void findBeat(float &beat, float &phase)
+{
+    const std::vector<float> &flux = song.flux;
+    int count = song.frameCount;
+    // only the rises above the local level matter, the loudness of a passage does not
+    std::vector<float> curve(count, 0.0f);
+    for (int t = 0; t < count; t++)
+    {
+        float level = 0;
+        int low = std::max(0, t - meanRadius);
+        int high = std::min(count, t + meanRadius + 1);
+        for (int u = low; u < high; u++) level += flux[u];
+        curve[t] = std::max(0.0f, flux[t] - level / (high - low));
+    }
+    int shortest = int(60000 / maxTempo / msPerFrame);
+    int longest = int(60000 / minTempo / msPerFrame) + 1;
+    std::vector<double> scores(longest + 2, 0.0);
+    int best = shortest;
+    for (int lag = shortest - 1; lag <= longest + 1; lag++)
+    {
+        double score = 0;
+        for (int t = lag; t < count; t++) score += double(curve[t]) * curve[t - lag];
+        // a log-normal weight around the preferred tempo settles double and half tempo ties
+        double octaves = SDL_log(60000 / (lag * msPerFrame) / preferredTempo) / SDL_log(2.0);
+        scores[lag] = score * SDL_exp(-0.5 * octaves * octaves);
+        if (lag >= shortest && lag <= longest && scores[lag] > scores[best]) best = lag;
+    }
+    // between frames by fitting a parabola through the best lag and its neighbours
+    double left = scores[best - 1];
+    double middle = scores[best];
+    double right = scores[best + 1];
+    double curvature = left - 2 * middle + right;
+    double shift = curvature < 0 ? 0.5 * (left - right) / curvature : 0;
+    beat = float((best + shift) * msPerFrame);
+
+    // the phase that puts the most onset weight on beats
+    float bestScore = -1;
+    phase = 0;
+    for (float candidate = 0; candidate < beat; candidate += msPerFrame)
+    {
+        float score = 0;
+        // the loop ends on the frame index, a float bound can round up to one past the curve
+        for (float time = candidate; int(time / msPerFrame) < count; time += beat) score += curve[int(time / msPerFrame)];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            phase = candidate;
+        }
+    }
+}
+
+bool isEarlier(const draftNote &a, const draftNote &b)
+{
+    return a.time < b.time;
+}
+
+bool isDarker(const draftNote* a, const draftNote* b)
+{
+    return song.centroid[a->frame] < song.centroid[b->frame];
+}
+
+// onsets onto the grid of subdivision steps per beat, the strongest one wins a grid point. The
+// grid is fitted to the onsets first, a beat a tenth of a ms off is 20 ms off by the end of a song
+void snapOnsets(std::vector<draftNote> &notes, float &beat, float &phase, const int &subdivision)
+{
+    for (int pass = 0; pass < 2 && notes.size() > 1; pass++)
+    {
+        float step = beat / subdivision;
+        double count = 0;
+        double sumSteps = 0;
+        double sumTimes = 0;
+        double sumSquares = 0;
+        double sumProducts = 0;
+        for (size_t i = 0; i < notes.size(); i++)
+        {
+            double steps = SDL_floor((notes[i].time - phase) / step + 0.5);
+            // onsets far off the grid would only pull it away
+            if (SDL_fabs(notes[i].time - phase - steps * step) > step / 4) continue;
+            count++;
+            sumSteps += steps;
+            sumTimes += notes[i].time;
+            sumSquares += steps * steps;
+            sumProducts += steps * notes[i].time;
+        }
+        double spread = count * sumSquares - sumSteps * sumSteps;
+        if (count < 2 || spread <= 0) break;
+        double fitted = (count * sumProducts - sumSteps * sumTimes) / spread;
+        phase = float((sumTimes - fitted * sumSteps) / count);
+        beat = float(fitted * subdivision);
+    }
+    float step = beat / subdivision;
+    std::vector<draftNote> snapped;
+    for (size_t i = 0; i < notes.size(); i++)
+    {
+        draftNote note = notes[i];
+        float steps = SDL_floor((note.time - phase) / step + 0.5f);
+        note.time = phase + steps * step;
+        if (!snapped.empty() && snapped.back().time == note.time)
+        {
+            if (note.strength > snapped.back().strength) snapped.back() = note;
+        }
+        else snapped.push_back(note);
+    }
+    notes.swap(snapped);
+}
+
+// a note whose sound holds on until well into the gap before the next note is held
+void findHolds(std::vector<draftNote> &notes, const float &beat, const int &subdivision)
+{
+    float step = beat / subdivision;
+    for (size_t i = 0; i < notes.size(); i++)
+    {
+        draftNote &note = notes[i];
+        float gapEnd = i + 1 < notes.size() ? notes[i + 1].time : song.frameCount * msPerFrame;
+        // leave a step to let go before the next note
+        float longest = gapEnd - note.time - step;
+        if (longest < beat) continue;
+        float onsetEnergy = 0;
+        for (int t = note.frame; t < std::min(note.frame + peakRadius + 1, song.frameCount); t++) onsetEnergy = std::max(onsetEnergy, song.energy[t]);
+        float held = 0;
+        int frame = note.frame;
+        while (held < longest && frame < song.frameCount && song.energy[frame] >= sustainRatio * onsetEnergy)
+        {
+            held += msPerFrame;
+            frame++;
+        }
+        // whole steps, at least a beat
+        held = SDL_floor(held / step) * step;
+        if (held >= beat) note.heldTime = Uint32(held);
+    }
+}
+
+// darker sounds on the left, brighter on the right, each lane gets a similar share
+void assignLanes(std::vector<draftNote> &notes, const int &lanes)
+{
+    std::vector<draftNote*> order;
+    for (size_t i = 0; i < notes.size(); i++) order.push_back(&notes[i]);
+    std::stable_sort(order.begin(), order.end(), isDarker);
+    for (size_t i = 0; i < order.size(); i++) order[i]->lane = int(i * lanes / order.size());
+}
+
+bool writeChart(const std::string &path, const std::vector<draftNote> &notes, const int &speed)
+{
+    // loadChart's entryTime is when the gem enters the hit window, the onset is where it is perfect
+    float lead = float(hitBox / 2) / noteSpeed[speed];
+    std::ostringstream lines;
+    Uint32 noMultiplierScore = 0;
+    for (size_t i = 0; i < notes.size(); i++)
+    {
+        const draftNote &note = notes[i];
+        float entryTime = note.time - lead;
+        if (entryTime < 0) continue;
+        // the game keeps reading until the end of the file, so there is no newline after the last note
+        lines << "\r\n" << Uint32(entryTime + 0.5f) << ' ' << note.lane << ' ' << note.heldTime;
+        noMultiplierScore += note.heldTime == 0 ? 50 : note.heldTime / 10;
+    }
+    std::ofstream outFile(path.c_str(), std::ios::binary);
+    if (!outFile) return false;
+    outFile << speed << ' ' << noMultiplierScore << lines.str();
+    return bool(outFile);
+}
+
+int main(int argc, char* argv[])
+{
+    int speed = 1;
+    int lanes = 5;
+    int subdivision = 2;
+    std::vector<const char*> songs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "-s" && i + 1 < argc) speed = std::atoi(argv[++i]);
+        else if (argument == "-l" && i + 1 < argc) lanes = std::atoi(argv[++i]);
+        else if (argument == "-d" && i + 1 < argc) subdivision = std::atoi(argv[++i]);
+        else songs.push_back(argv[i]);
+    }
+    if (songs.empty() || speed < 0 || speed > 9 || lanes < 1 || lanes > 5 || subdivision < 1 || subdivision > 8)
+    {
+        std::cout << "Usage: autochart [-s speed 0-9] [-l lanes 1-5] [-d steps per beat 1-8] song..." << std::endl;
+        return 1;
+    }
+
+    // decoding needs an open mixer, one nobody hears is enough. No changes allowed to the format,
+    // so every song comes out of Mix_LoadWAV at the analysis rate in one channel
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_AUDIO) != 0 || Mix_OpenAudioDevice(analysisRate, AUDIO_S16SYS, 1, 4096, NULL, 0) != 0)
+    {
+        std::cout << "Could not start the mixer: " << Mix_GetError() << std::endl;
+        return 1;
+    }
+    detectSimd();
+    prepareFft();
+    workPool pool;
+    startWorkPool(pool);
+
+    int failed = 0;
+    for (size_t s = 0; s < songs.size(); s++)
+    {
+        const char* path = songs[s];
+        Uint64 startCounter = SDL_GetPerformanceCounter();
+        if (!decodeSong(path, song.samples))
+        {
+            failed++;
+            continue;
+        }
+        song.frameCount = int(song.samples.size() / hopSize) + 1;
+        song.flux.assign(song.frameCount, 0.0f);
+        song.energy.assign(song.frameCount, 0.0f);
+        song.centroid.assign(song.frameCount, 0.0f);
+        runParallel(pool, (song.frameCount + blockFrames - 1) / blockFrames, analyseBlock);
+
+        std::vector<draftNote> notes;
+        pickOnsets(notes);
+        float beat;
+        float phase;
+        findBeat(beat, phase);
+        snapOnsets(notes, beat, phase, subdivision);
+        findHolds(notes, beat, subdivision);
+        assignLanes(notes, lanes);
+
+        std::string chartPath = path;
+        size_t slash = chartPath.find_last_of("/\\");
+        chartPath = (slash == std::string::npos ? std::string() : chartPath.substr(0, slash + 1)) + "Chart.draft.txt";
+        if (!writeChart(chartPath, notes, speed))
+        {
+            std::cout << "Could not write " << chartPath << std::endl;
+            failed++;
+            continue;
+        }
+        double elapsed = double(SDL_GetPerformanceCounter() - startCounter) / SDL_GetPerformanceFrequency();
+        std::cout << path << ": " << notes.size() << " notes at " << int(60000 / beat + 0.5f) << " bpm, "
+                  << song.samples.size() / analysisRate << " s of audio in " << elapsed << " s, written to "
+                  << chartPath << std::endl;
+    }
+
+    Mix_CloseAudio();
+    SDL_Quit();
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+// Packs the game's assets into one file the game maps into memory at startup, see headers/packformat.h.
+// Run from the folder with assets/ in it:
+//     packassets [output]            (default assets.pack)
+// Build with SDL2 and SDL2_image, e.g.
+//     g++ tools/packassets.cpp -Iheaders $(sdl2-config --cflags --libs) -lSDL2_image -o packassets
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <SDL.h>
+#include <SDL_image.h>
+#include "packformat.h"
+
+enum packKinds
+{
+    kindFile,
+    kindImage,
+    // white is transparent, as loadTexture(..., true) does it
+    kindColorKeyImage
+};
+
+struct packSource
+{
+    const char* path;
+    int kind;
+};
+
+// everything loadMedia and playLevel read. Settings.txt and the high scores are written by the game
+// and stay loose files
+const packSource packSources[] = {
+    {"assets/Raleway-Light.ttf", kindFile},
+    {"assets/scoreAndStar.png", kindColorKeyImage},
+    {"assets/comingSoon.png", kindImage},
+    {"assets/bigBlackRectangle.png", kindColorKeyImage},
+    {"assets/bigBlackRectangle2.png", kindColorKeyImage},
+    {"assets/background.png", kindImage},
+    {"assets/playScreen.png", kindImage},
+    {"assets/pause.png", kindImage},
+    {"assets/guitar.png", kindColorKeyImage},
+    {"assets/note.png", kindColorKeyImage},
+    {"assets/holdNotes.png", kindColorKeyImage},
+    {"assets/pressedButton.png", kindColorKeyImage},
+    {"assets/hit.wav", kindFile},
+    {"assets/miss.wav", kindFile},
+    {"assets/LevelOne/album.png", kindImage},
+    {"assets/LevelOne/song.mp3", kindFile},
+    {"assets/LevelOne/Chart.txt", kindFile},
+    {"assets/LevelOne/Lyrics.txt", kindFile},
+    {"assets/LevelTwo/album.png", kindImage},
+    {"assets/LevelTwo/song.mp3", kindFile},
+    {"assets/LevelTwo/Chart.txt", kindFile},
+    {"assets/LevelTwo/Lyrics.txt", kindFile},
+    {"assets/LevelThree/album.png", kindImage},
+    {"assets/LevelThree/song.mp3", kindFile},
+    {"assets/LevelThree/Chart.txt", kindFile},
+    {"assets/LevelThree/Lyrics.txt", kindFile},
+};
+const int packSourceCount = sizeof(packSources) / sizeof(packSources[0]);
+
+struct packedData
+{
+    packEntry entry;
+    std::string bytes;
+};
+
+bool entryNameLess(const packedData &a, const packedData &b)
+{
+    return std::strcmp(a.entry.name, b.entry.name) < 0;
+}
+
+bool readFile(const char* path, std::string &bytes)
+{
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile) return false;
+    bytes.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// decode to ARGB8888 with the colour key baked into alpha
+bool readImage(const char* path, const bool &isColorKey, packEntry &entry, std::string &bytes)
+{
+    SDL_Surface* loaded = IMG_Load(path);
+    if (loaded == NULL)
+    {
+        std::cout << "Could not decode " << path << ": " << IMG_GetError() << std::endl;
+        return false;
+    }
+    if (isColorKey) SDL_SetColorKey(loaded, SDL_TRUE, SDL_MapRGB(loaded->format, 0xFF, 0xFF, 0xFF));
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded);
+    if (converted == NULL)
+    {
+        std::cout << "Could not convert " << path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    entry.type = packImage;
+    entry.width = converted->w;
+    entry.height = converted->h;
+    bytes.resize(converted->w * converted->h * 4);
+    bool isOpaque = true;
+    for (int y = 0; y < converted->h; y++)
+    {
+        const Uint32* row = (const Uint32*) ((const Uint8*) converted->pixels + y * converted->pitch);
+        std::memcpy(&bytes[y * converted->w * 4], row, converted->w * 4);
+        for (int x = 0; x < converted->w; x++) if ((row[x] >> 24) != 0xFF) isOpaque = false;
+    }
+    if (isOpaque) entry.flags |= packOpaque;
+    SDL_FreeSurface(converted);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* outputPath = argc > 1 ? argv[1] : "assets.pack";
+    if (SDL_Init(0) != 0 || !(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
+    {
+        std::cout << "Could not start SDL: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    packedData packed[packSourceCount];
+    int count = 0;
+    for (int i = 0; i < packSourceCount; i++)
+    {
+        const packSource &source = packSources[i];
+        packedData &data = packed[count];
+        std::memset(&data.entry, 0, sizeof(data.entry));
+        if (std::strlen(source.path) >= (size_t) packNameLength)
+        {
+            std::cout << "Name too long for the pack: " << source.path << std::endl;
+            return 1;
+        }
+        std::strcpy(data.entry.name, source.path);
+        bool isRead;
+        if (source.kind == kindFile)
+        {
+            data.entry.type = packFile;
+            isRead = readFile(source.path, data.bytes);
+        }
+        else isRead = readImage(source.path, source.kind == kindColorKeyImage, data.entry, data.bytes);
+        // songs are not shipped with every checkout, the game falls back to loose files for anything missing
+        if (!isRead)
+        {
+            std::cout << "Skipped " << source.path << std::endl;
+            continue;
+        }
+        data.entry.size = data.bytes.size();
+        count++;
+    }
+    std::sort(packed, packed + count, entryNameLess);
+
+    // data starts after the table, every entry on an aligned offset
+    Uint64 offset = sizeof(packHeader) + count * sizeof(packEntry);
+    for (int i = 0; i < count; i++)
+    {
+        offset = (offset + packAlignment - 1) / packAlignment * packAlignment;
+        packed[i].entry.offset = offset;
+        offset += packed[i].entry.size;
+    }
+
+    std::ofstream outFile(outputPath, std::ios::binary);
+    if (!outFile)
+    {
+        std::cout << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+    packHeader header;
+    std::memcpy(header.magic, packMagic, sizeof(header.magic));
+    header.version = packVersion;
+    header.entryCount = count;
+    outFile.write((const char*) &header, sizeof(header));
+    for (int i = 0; i < count; i++) outFile.write((const char*) &packed[i].entry, sizeof(packEntry));
+    Uint64 written = sizeof(packHeader) + count * sizeof(packEntry);
+    for (int i = 0; i < count; i++)
+    {
+        static const char padding[packAlignment] = {0};
+        outFile.write(padding, packed[i].entry.offset - written);
+        outFile.write(packed[i].bytes.data(), packed[i].bytes.size());
+        written = packed[i].entry.offset + packed[i].entry.size;
+    }
+    outFile.close();
+    std::cout << "Packed " << count << " assets, " << written << " bytes into " << outputPath << std::endl;
+
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}
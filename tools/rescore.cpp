@@ -0,0 +1,311 @@
+// Scores every replay the game saved again with the scoring rules as they are now, see
+// headers/replayformat.h, and writes the new results into the game's score database. Run from the
+// folder with assets/ in it while the game is closed:
+//     rescore [replay folder] [report]       (default replays and rescore-report.txt)
+// Each replay replaces the solo play it was saved with in scores.db, or is added back if that play
+// is not there, and the high score tables follow from the database. The report lists every replay
+// that scores differently than when it was played. Build with SDL2, e.g.
+//     g++ -O2 tools/rescore.cpp -Iheaders $(sdl2-config --cflags --libs) -o rescore
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <SDL.h>
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+#include "game.h"
+#include "simd.h"
+#include "notes.h"
+#include "scoring.h"
+#include "replayformat.h"
+#include "workpool.h"
+
+// scorejournal.h reports through the game's logger, the tool only has the console
+enum errorType
+{
+    none
+};
+
+void logSDLError(std::ostream& os, const std::string &msg, bool fatal, int)
+{
+    os << msg << std::endl;
+    if (fatal) exit(1);
+}
+
+#include "scorejournal.h"
+
+enum replayStatus
+{
+    replayOk,
+    replayUnreadable,
+    replayDamaged,
+    replayChartMissing,
+    replayChartChanged
+};
+
+const char* replayStatusNames[5] = {"ok", "could not be read", "damaged", "chart missing", "chart changed since it was played"};
+
+struct replayJob
+{
+    std::string path;
+    replayHeader header;
+    int chart;
+    int status;
+    replayResult result;
+};
+
+struct loadedChart
+{
+    std::string path;
+    bool isLoaded;
+    Uint64 hash;
+    gameNote notes[2000];
+    int noteCount;
+    Uint32 noMultiplierScore;
+    int speed;
+};
+
+std::vector<replayJob> jobs;
+std::vector<loadedChart*> charts;
+// simulation scratch, one per worker, replays are read one at a time into it
+activeNotes workerNotes[maxWorkers];
+std::string workerBytes[maxWorkers];
+
+bool hasSuffix(const std::string &name, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+// every .khr file in folder, sorted so reports come out the same on every run
+void listReplays(const std::string &folder, std::vector<std::string> &paths)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((folder + "\\*.khr").c_str(), &found);
+    if (search != INVALID_HANDLE_VALUE)
+    {
+        do paths.push_back(folder + '/' + found.cFileName);
+        while (FindNextFileA(search, &found));
+        FindClose(search);
+    }
+#else
+    DIR* directory = opendir(folder.c_str());
+    if (directory != NULL)
+    {
+        while (dirent* entry = readdir(directory))
+        {
+            std::string name = entry->d_name;
+            if (hasSuffix(name, ".khr")) paths.push_back(folder + '/' + name);
+        }
+        closedir(directory);
+    }
+#endif
+    std::sort(paths.begin(), paths.end());
+}
+
+// in one read, there are a lot of these
+bool readFile(const char* path, std::string &bytes)
+{
+    std::ifstream inFile(path, std::ios::binary | std::ios::ate);
+    if (!inFile) return false;
+    bytes.resize(size_t(inFile.tellg()));
+    inFile.seekg(0);
+    if (!bytes.empty()) inFile.read(&bytes[0], bytes.size());
+    return bool(inFile);
+}
+
+// only the header, the records are read when the replay is scored. Needs no scratch, so the
+// worker runParallel passes goes unnamed
+void loadReplay(const int &index, const int &)
+{
+    replayJob &job = jobs[index];
+    job.chart = -1;
+    std::ifstream inFile(job.path.c_str(), std::ios::binary | std::ios::ate);
+    if (!inFile)
+    {
+        job.status = replayUnreadable;
+        return;
+    }
+    Uint64 fileSize = inFile.tellg();
+    inFile.seekg(0);
+    job.status = replayDamaged;
+    if (!inFile.read((char*) &job.header, sizeof(replayHeader))) return;
+    if (std::memcmp(job.header.magic, replayMagic, sizeof(job.header.magic)) != 0 || job.header.version != replayVersion
+        || job.header.dataSize != fileSize - sizeof(replayHeader) || job.header.chartPath[replayPathLength - 1] != 0)
+    {
+        return;
+    }
+    job.status = replayOk;
+}
+
+void rescoreReplay(const int &index, const int &worker)
+{
+    replayJob &job = jobs[index];
+    if (job.status != replayOk) return;
+    const loadedChart &chart = *charts[job.chart];
+    std::string &bytes = workerBytes[worker];
+    if (!readFile(job.path.c_str(), bytes) || bytes.size() != sizeof(replayHeader) + job.header.dataSize)
+    {
+        job.status = replayUnreadable;
+        return;
+    }
+    const Uint8* data = (const Uint8*) bytes.data() + sizeof(replayHeader);
+    if (!simulateReplay(chart.notes, chart.noteCount, chart.noMultiplierScore, chart.speed, data, job.header.dataSize,
+                        job.header.flags, workerNotes[worker], job.result))
+    {
+        job.status = replayDamaged;
+    }
+}
+
+// the chart a replay was played on, loaded once however many replays use it
+int findChart(const char* path)
+{
+    for (size_t i = 0; i < charts.size(); i++) if (charts[i]->path == path) return int(i);
+    loadedChart* chart = new loadedChart;
+    chart->path = path;
+    std::string bytes;
+    std::string text;
+    chart->isLoaded = readFile(path, bytes);
+    // the game reads charts with carriage returns dropped, and hashes them that way
+    for (size_t i = 0; i < bytes.size(); i++) if (bytes[i] != '\r') text += bytes[i];
+    Uint32 musicStart;
+    chart->isLoaded = chart->isLoaded && parseChart(chart->notes, text, musicStart, chart->noteCount,
+                                                    chart->noMultiplierScore, chart->speed);
+    chart->hash = hashChart(text);
+    charts.push_back(chart);
+    return int(charts.size() - 1);
+}
+
+// put every rescored replay into the score database. The game adds a solo play's record a moment
+// before it saves the replay, so the record is the one play of the song by player 0 from the second
+// before recordedAt up to it. Records are changed in place, which leaves the indexes stale, so the
+// journal is compacted and closed right after and the game builds them again when it starts
+void updateScores(scoreJournal &scores, int &updatedCount, int &addedCount)
+{
+    updatedCount = 0;
+    addedCount = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const replayJob &job = jobs[i];
+        if (job.status != replayOk) continue;
+        const loadedChart &chart = *charts[job.chart];
+        Uint64 song = songKey(job.header.chartPath);
+        Uint32 playedAt = Uint32(job.header.recordedAt);
+        const journalRecord* found;
+        bool isFound = scoreHistory(scores, song, 0, playedAt - 1, &found, 1) == 1 && found->playedAt <= playedAt;
+        journalRecord record;
+        if (isFound) record = *found;
+        else
+        {
+            SDL_memset(&record, 0, sizeof(record));
+            record.song = song;
+            record.playedAt = playedAt;
+        }
+        record.score = job.result.score;
+        record.hits = Uint16(job.result.accuracy);
+        record.noteCount = Uint16(chart.noteCount);
+        record.highestStreak = Uint16(job.result.highestStreak);
+        record.star = Uint8(job.result.star);
+        if (isFound)
+        {
+            record.checksum = recordChecksum(record);
+            scores.records[found - &scores.records[0]] = record;
+            updatedCount++;
+        }
+        else
+        {
+            appendRecord(scores, record);
+            addedCount++;
+        }
+    }
+    compactScoreJournal(scores);
+    closeScoreJournal(scores);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string replayFolder = argc > 1 ? argv[1] : "replays";
+    const char* reportPath = argc > 2 ? argv[2] : "rescore-report.txt";
+    Uint64 startCounter = SDL_GetPerformanceCounter();
+    // picked once here, the workers only read it
+    detectSimd();
+
+    std::vector<std::string> paths;
+    listReplays(replayFolder, paths);
+    if (paths.empty())
+    {
+        std::cout << "No replays in " << replayFolder << std::endl;
+        return 1;
+    }
+    jobs.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) jobs[i].path = paths[i];
+
+    workPool pool;
+    startWorkPool(pool);
+    runParallel(pool, int(jobs.size()), loadReplay);
+
+    // a handful of charts for all the replays, loaded on this thread
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        replayJob &job = jobs[i];
+        if (job.status != replayOk) continue;
+        job.chart = findChart(job.header.chartPath);
+        const loadedChart &chart = *charts[job.chart];
+        if (!chart.isLoaded) job.status = replayChartMissing;
+        else if (chart.hash != job.header.chartHash) job.status = replayChartChanged;
+    }
+    runParallel(pool, int(jobs.size()), rescoreReplay);
+
+    std::ofstream report(reportPath);
+    if (!report)
+    {
+        std::cout << "Could not write " << reportPath << std::endl;
+        return 1;
+    }
+    int rescoredCount = 0;
+    int changedCount = 0;
+    int skippedCount = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const replayJob &job = jobs[i];
+        if (job.status != replayOk)
+        {
+            report << job.path << ": skipped, " << replayStatusNames[job.status] << std::endl;
+            skippedCount++;
+            continue;
+        }
+        rescoredCount++;
+        const replayHeader &before = job.header;
+        const replayResult &after = job.result;
+        if (before.score == after.score && before.star == after.star && before.accuracy == after.accuracy
+            && before.highestStreak == after.highestStreak)
+        {
+            continue;
+        }
+        changedCount++;
+        report << job.path << ": score " << before.score << " -> " << after.score << ", stars " << before.star << " -> "
+               << after.star << ", hits " << before.accuracy << " -> " << after.accuracy << ", highest streak "
+               << before.highestStreak << " -> " << after.highestStreak << std::endl;
+    }
+    int updatedCount;
+    int addedCount;
+    openScoreJournal(levelScores, "scores.db", "scores.journal");
+    updateScores(levelScores, updatedCount, addedCount);
+
+    double elapsed = double(SDL_GetPerformanceCounter() - startCounter) * 1000 / SDL_GetPerformanceFrequency();
+    report << rescoredCount << " rescored, " << changedCount << " changed, " << skippedCount << " skipped" << std::endl;
+    std::cout << "Rescored " << rescoredCount << " replays on " << pool.workerCount << " threads in " << elapsed << " ms, "
+              << changedCount << " changed, " << skippedCount << " skipped, see " << reportPath << std::endl;
+    std::cout << "Score database: " << updatedCount << " plays rescored, " << addedCount << " added back" << std::endl;
+    for (size_t c = 0; c < charts.size(); c++) delete charts[c];
+    return 0;
+}